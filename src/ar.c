@@ -620,6 +620,8 @@ void REGPARAM2 chipmem_lput_actionreplay1 (uaecptr addr, uae_u32 l)
 		action_replay_chipwrite ();
 	m = (uae_u32 *)(chipmem_bank.baseaddr + addr);
 	do_put_mem_long (m, l);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 3);
 }
 void REGPARAM2 chipmem_wput_actionreplay1 (uaecptr addr, uae_u32 w)
 {
@@ -631,6 +633,8 @@ void REGPARAM2 chipmem_wput_actionreplay1 (uaecptr addr, uae_u32 w)
 		action_replay_chipwrite ();
 	m = (uae_u16 *)(chipmem_bank.baseaddr + addr);
 	do_put_mem_word (m, w);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 1);
 }
 void REGPARAM2 chipmem_bput_actionreplay1 (uaecptr addr, uae_u32 b)
 {
@@ -639,6 +643,7 @@ void REGPARAM2 chipmem_bput_actionreplay1 (uaecptr addr, uae_u32 b)
 	if (addr >= 0x60 && addr <= 0x63 && !is_ar_pc_in_rom())
 		action_replay_chipwrite();
 	chipmem_bank.baseaddr[addr] = b;
+	memory_dirty (&chipmem_bank, addr);
 }
 void REGPARAM2 chipmem_lput_actionreplay23 (uaecptr addr, uae_u32 l)
 {
@@ -647,6 +652,8 @@ void REGPARAM2 chipmem_lput_actionreplay23 (uaecptr addr, uae_u32 l)
 	addr &= chipmem_bank.mask;
 	m = (uae_u32 *)(chipmem_bank.baseaddr + addr);
 	do_put_mem_long (m, l);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 3);
 	if (addr == 8 && action_replay_flag == ACTION_REPLAY_WAITRESET)
 		action_replay_chipwrite();
 }
@@ -658,6 +665,8 @@ void REGPARAM2 chipmem_wput_actionreplay23 (uaecptr addr, uae_u32 w)
 	addr &= chipmem_bank.mask;
 	m = (uae_u16 *)(chipmem_bank.baseaddr + addr);
 	do_put_mem_word (m, w);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 1);
 	if (addr == 8 && action_replay_flag == ACTION_REPLAY_WAITRESET)
 		action_replay_chipwrite();
 }
@@ -1469,6 +1478,7 @@ static void action_replay_setbanks (void)
 			chipmem_bank.lput = chipmem_lput_actionreplay1;
 			break;
 		}
+		memory_direct_refresh ();
 	}
 }
 
@@ -1477,6 +1487,7 @@ static void action_replay_unsetbanks (void)
 	chipmem_bank.bput = chipmem_bput;
 	chipmem_bank.wput = chipmem_wput;
 	chipmem_bank.lput = chipmem_lput;
+	memory_direct_refresh ();
 }
 
 /* param to allow us to unload the cart. Currently we know it is safe if we are doing a reset to unload it.*/
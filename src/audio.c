@@ -41,6 +41,7 @@
 #include "ahidsound_new.h"
 #endif
 #include "threaddep/thread.h"
+#include "benchmark.h"
 
 #include <math.h>
 
@@ -304,7 +305,7 @@ void (*sample_handler) (void);
 static void (*sample_prehandler) (unsigned long best_evtime);
 
 // REMOVEME: static float sample_evtime;
-float scaled_sample_evtime;
+float scaled_sample_evtime, scaled_sample_evtime_orig;
 
 static unsigned long last_cycles;
 static float next_sample_evtime;
@@ -1156,7 +1157,8 @@ void update_sound (double clk)
 	if (!have_sound)
 		return;
 
-	scaled_sample_evtime = clk * CYCLE_UNIT * sound_sync_multiplier / (double)obtainedfreq;
+	scaled_sample_evtime_orig = clk * CYCLE_UNIT * sound_sync_multiplier / (double)obtainedfreq;
+	scaled_sample_evtime = scaled_sample_evtime_orig;
 #ifdef SAMPLER
 	sampler_evtime = clk * CYCLE_UNIT * sound_sync_multiplier;
 #endif
@@ -1715,6 +1717,7 @@ void update_audio (void)
 	if (!is_audio_active ())
 		goto end;
 
+	BENCH_ENTER (BENCH_AUDIO);
 	n_cycles = get_cycles () - last_cycles;
 	while (n_cycles > 0) {
 		unsigned long int best_evtime = n_cycles + 1;
@@ -1793,6 +1796,7 @@ void update_audio (void)
 			}
 		}
 	}
+	BENCH_LEAVE ();
 end:
 	last_cycles = get_cycles () - n_cycles;
 }
@@ -0,0 +1,184 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Headless benchmark mode
+  *
+  * -benchmark=<frames> runs the configured machine (or a -statefile=
+  * savestate, or a -playback= input recording) in warp mode without
+  * presenting frames or playing sound, and quits after <frames> emulated
+  * frames. The report has emulated frames per second, MIPS of the
+  * interpreter and wall time split between the emulator subsystems.
+  * Each subsystem brackets its work with BENCH_ENTER ()/BENCH_LEAVE (),
+  * the time stamps are read_processor_time () ticks.
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <sys/time.h>
+
+#include "options.h"
+#include "uae.h"
+#include "events.h"
+#include "custom.h"
+#include "xwin.h"
+#include "drawing.h"
+#include "inputdevice.h"
+#include "memory_uae.h"
+#include "newcpu.h"
+#include "cpummu.h"
+#include "benchmark.h"
+
+bool bench_running;
+uae_u64 bench_insns;
+
+static int bench_frames, bench_frame;
+static TCHAR bench_json[MAX_DPATH];
+
+static double bench_wallstart;
+static uae_u64 bench_insnstart;
+static uae_u64 bench_tlbhitstart, bench_tlbmissstart;
+static frame_time_t bench_last;
+static uae_u64 bench_ticks[BENCH_SECTIONS];
+#define MAX_BENCH_DEPTH 16
+static int bench_stack[MAX_BENCH_DEPTH];
+static int bench_depth;
+
+static const char *bench_names[BENCH_SECTIONS] = {
+	"cpu", "events", "copper", "blitter", "drawing", "audio"
+};
+
+static double bench_now (void)
+{
+	struct timeval tv;
+
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+void bench_setup (int frames)
+{
+	bench_frames = frames > 0 ? frames : 0;
+}
+
+/* JSON report goes to jsonfile, "-" is stdout */
+void bench_set_output (const TCHAR *jsonfile)
+{
+	_tcsncpy (bench_json, jsonfile, MAX_DPATH - 1);
+}
+
+void bench_enter (int section)
+{
+	frame_time_t now = read_processor_time ();
+
+	bench_ticks[bench_stack[bench_depth]] += now - bench_last;
+	bench_last = now;
+	if (bench_depth < MAX_BENCH_DEPTH - 1)
+		bench_depth++;
+	bench_stack[bench_depth] = section;
+}
+
+void bench_leave (void)
+{
+	frame_time_t now = read_processor_time ();
+
+	bench_ticks[bench_stack[bench_depth]] += now - bench_last;
+	bench_last = now;
+	/* sections that were entered before the benchmark started end here */
+	if (bench_depth > 0)
+		bench_depth--;
+}
+
+static void bench_start (void)
+{
+	/* warp mode without frameskip: no frame pacing, sound output paused,
+	 * every frame is still drawn */
+	warpmode (1);
+	changed_prefs.gfx_framerate = currprefs.gfx_framerate = 1;
+	drawing_dummy_flush (true);
+
+	memset (bench_ticks, 0, sizeof bench_ticks);
+	bench_depth = 0;
+	bench_stack[0] = BENCH_CPU;
+	bench_frame = 0;
+	bench_insnstart = bench_insns;
+	bench_tlbhitstart = mmu_tlb_hits;
+	bench_tlbmissstart = mmu_tlb_misses;
+	bench_wallstart = bench_now ();
+	bench_last = read_processor_time ();
+	bench_running = true;
+	write_log (_T("BENCH: running %d frames\n"), bench_frames);
+}
+
+static void bench_report (double wall)
+{
+	uae_u64 insns = bench_insns - bench_insnstart;
+	uae_u64 total = 0;
+	uae_u64 tlbhits = mmu_tlb_hits - bench_tlbhitstart;
+	uae_u64 tlbtotal = tlbhits + mmu_tlb_misses - bench_tlbmissstart;
+	double tlbrate = tlbtotal ? tlbhits * 100.0 / tlbtotal : 0;
+	double fps = bench_frame / wall;
+	double mips = insns / wall / 1000000.0;
+	double speed = vblank_hz > 0 ? fps * 100.0 / vblank_hz : 0;
+	FILE *f = NULL;
+	int i;
+
+	for (i = 0; i < BENCH_SECTIONS; i++)
+		total += bench_ticks[i];
+
+	write_log (_T("BENCH: %d frames in %.3f s, %.1f frames/s (%.0f%%), %.2f MIPS\n"),
+		bench_frame, wall, fps, speed, mips);
+	for (i = 0; i < BENCH_SECTIONS; i++) {
+		double part = total ? (double)bench_ticks[i] / total : 0;
+		write_log (_T("BENCH: %-8s %8.3f s %5.1f%%\n"), bench_names[i], part * wall, part * 100.0);
+	}
+	if (tlbtotal)
+		write_log (_T("BENCH: MMU TLB %.1f%% hits of %llu translated accesses\n"), tlbrate, (unsigned long long)tlbtotal);
+
+	if (!bench_json[0])
+		return;
+	if (!_tcscmp (bench_json, _T("-")))
+		f = stdout;
+	else
+		f = fopen (bench_json, "w");
+	if (!f) {
+		write_log (_T("BENCH: can't create '%s'\n"), bench_json);
+		return;
+	}
+	fprintf (f, "{\n");
+	fprintf (f, "  \"frames\": %d,\n", bench_frame);
+	fprintf (f, "  \"wall_seconds\": %.6f,\n", wall);
+	fprintf (f, "  \"frames_per_second\": %.3f,\n", fps);
+	fprintf (f, "  \"speed_percent\": %.2f,\n", speed);
+	fprintf (f, "  \"instructions\": %llu,\n", (unsigned long long)insns);
+	fprintf (f, "  \"mips\": %.3f,\n", mips);
+	fprintf (f, "  \"jit\": %s,\n", currprefs.cachesize ? "true" : "false");
+	fprintf (f, "  \"mmu_tlb_hit_percent\": %.2f,\n", tlbrate);
+	fprintf (f, "  \"sections\": {\n");
+	for (i = 0; i < BENCH_SECTIONS; i++) {
+		double part = total ? (double)bench_ticks[i] / total : 0;
+		fprintf (f, "    \"%s\": { \"seconds\": %.6f, \"percent\": %.2f }%s\n",
+			bench_names[i], part * wall, part * 100.0, i < BENCH_SECTIONS - 1 ? "," : "");
+	}
+	fprintf (f, "  }\n");
+	fprintf (f, "}\n");
+	if (f != stdout)
+		fclose (f);
+}
+
+/* Called once per emulated frame */
+void bench_vsync (void)
+{
+	if (!bench_frames)
+		return;
+	if (!bench_running) {
+		bench_start ();
+		return;
+	}
+	if (++bench_frame < bench_frames)
+		return;
+	bench_running = false;
+	bench_report (bench_now () - bench_wallstart);
+	bench_frames = 0;
+	uae_quit ();
+}
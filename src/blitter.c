@@ -8,6 +8,7 @@
  */
 
 #define SPEEDUP 1
+#define BLITTER_SIMD 1
 #undef BLITTER_DEBUG
 
 #include "sysconfig.h"
@@ -23,6 +24,7 @@
 #include "blit.h"
 #include "savestate.h"
 #include "debug.h"
+#include "benchmark.h"
 
 // 1 = logging
 // 2 = no wait detection
@@ -446,6 +448,36 @@ STATIC_INLINE void chipmem_agnus_wput2 (uaecptr addr, uae_u32 w)
 #endif
 }
 
+/* vectorized version of the loops below, false if blit can't use it */
+static bool blitter_dofast_simd (uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd, uae_u8 mt, int desc)
+{
+#if BLITTER_SIMD
+	uae_u8 *mem;
+	uae_u32 size;
+	int fc = !!(bltcon1 & 0x4);
+
+#ifdef DEBUGGER
+	if (memwatch_enabled)
+		return false;
+#endif
+	mem = chipmem_agnus_direct (&size);
+	if (!mem)
+		return false;
+	if (!blitter_simd_blit (mem, size, pta, ptb, ptc, ptd, &blt_info, mt, desc, blitfill ? (blitife ? 2 : 0) : -1, &fc, blit_filltable))
+		return false;
+	if (ptd) {
+		/* D was written straight to chip RAM, bypassing the put handlers */
+		uae_s64 lo, hi;
+		blitter_simd_range (ptd, blt_info.bltdmod, blt_info.hblitsize, blt_info.vblitsize, desc, &lo, &hi);
+		memory_dirty_address ((uaecptr)lo, (uae_u32)(hi - lo + 1));
+	}
+	blitfc = fc;
+	return true;
+#else
+	return false;
+#endif
+}
+
 static void blitter_dofast (void)
 {
 	int i,j;
@@ -472,6 +504,9 @@ static void blitter_dofast (void)
 		bltdpt += (blt_info.hblitsize * 2 + blt_info.bltdmod) * blt_info.vblitsize;
 	}
 
+	if (blitter_dofast_simd (bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, mt, 0)) {
+		;
+	} else
 #if SPEEDUP
 	if (blitfunc_dofast[mt] && !blitfill) {
 		(*blitfunc_dofast[mt])(bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, &blt_info);
@@ -571,6 +606,9 @@ static void blitter_dofast_desc (void)
 		bltddatptr = bltdpt;
 		bltdpt -= (blt_info.hblitsize * 2 + blt_info.bltdmod) * blt_info.vblitsize;
 	}
+	if (blitter_dofast_simd (bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, mt, 1)) {
+		;
+	} else
 #if SPEEDUP
 	if (blitfunc_dofast_desc[mt] && !blitfill) {
 		(*blitfunc_dofast_desc[mt])(bltadatptr, bltbdatptr, bltcdatptr, bltddatptr, &blt_info);
@@ -857,6 +895,7 @@ static void decide_blitter_line (int hsync, int hpos)
 
 static void actually_do_blit (void)
 {
+	BENCH_ENTER (BENCH_BLITTER);
 	if (blitline) {
 		do {
 			blitter_read ();
@@ -881,6 +920,7 @@ static void actually_do_blit (void)
 			blitter_dofast ();
 		bltstate = BLT_done;
 	}
+	BENCH_LEAVE ();
 }
 
 static void blitter_doit (void)
@@ -1104,7 +1144,7 @@ static void do_startcycles (int hpos)
 	}
 }
 
-void decide_blitter (int hpos)
+static void decide_blitter_2 (int hpos)
 {
 	int hsync = hpos < 0;
 
@@ -1231,6 +1271,13 @@ void decide_blitter (int hpos)
 	if (hsync)
 		last_blitter_hpos = 0;
 }
+
+void decide_blitter (int hpos)
+{
+	BENCH_ENTER (BENCH_BLITTER);
+	decide_blitter_2 (hpos);
+	BENCH_LEAVE ();
+}
 #else
 void decide_blitter (int hpos) { }
 #endif
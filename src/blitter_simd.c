@@ -0,0 +1,534 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Vectorized immediate blitter
+  *
+  * Used by blitter_dofast ()/blitter_dofast_desc () when the whole blit
+  * is inside chip ram and channels don't overlap in ways where the order
+  * of individual word accesses matters. Each line is processed in stages
+  * over word buffers: load (+ byteswap), A mask, A/B shift, minterm, fill,
+  * store. Results and final register state are identical to the scalar
+  * path.
+  *
+  * Kernels exist in portable C, SSE2 and AVX2 (selected at runtime).
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include "options.h"
+#include "memory_uae.h"
+#include "blitter.h"
+
+#if defined (__x86_64__) || (defined (__i386__) && defined (__SSE2__))
+#define BLITSIMD_SSE2 1
+#include <emmintrin.h>
+#if defined (__GNUC__) && (__GNUC__ >= 5 || defined (__clang__))
+#define BLITSIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+struct blitsimd_kernels {
+	const TCHAR *name;
+	void (*load)(uae_u16 *dst, const uae_u8 *src, int n, int desc);
+	void (*store)(uae_u8 *dst, const uae_u16 *src, int n, int desc);
+	void (*shift)(uae_u16 *dst, const uae_u16 *src, int n, int r, int desc);
+	int (*minterm)(uae_u16 *d, const uae_u16 *a, const uae_u16 *b, const uae_u16 *c, int n, uae_u8 mt);
+};
+
+/* word i of a line is at src + 2 * i, or src - 2 * i when descending */
+
+static void load_c (uae_u16 *dst, const uae_u8 *src, int n, int desc)
+{
+	int i;
+	if (desc) {
+		for (i = 0; i < n; i++)
+			dst[i] = do_get_mem_word ((uae_u16*)(src - 2 * i));
+	} else {
+		for (i = 0; i < n; i++)
+			dst[i] = do_get_mem_word ((uae_u16*)(src + 2 * i));
+	}
+}
+
+static void store_c (uae_u8 *dst, const uae_u16 *src, int n, int desc)
+{
+	int i;
+	if (desc) {
+		for (i = 0; i < n; i++)
+			do_put_mem_word ((uae_u16*)(dst - 2 * i), src[i]);
+	} else {
+		for (i = 0; i < n; i++)
+			do_put_mem_word ((uae_u16*)(dst + 2 * i), src[i]);
+	}
+}
+
+/* ascending: ((prev << 16) | cur) >> r, descending: ((cur << 16) | prev) >> r
+ * src[-1] is the previous word */
+static void shift_c (uae_u16 *dst, const uae_u16 *src, int n, int r, int desc)
+{
+	int i;
+	if (desc) {
+		for (i = 0; i < n; i++)
+			dst[i] = (uae_u16)((((uae_u32)src[i] << 16) | src[i - 1]) >> r);
+	} else {
+		for (i = 0; i < n; i++)
+			dst[i] = (uae_u16)((((uae_u32)src[i - 1] << 16) | src[i]) >> r);
+	}
+}
+
+STATIC_INLINE uae_u16 minterm_word (uae_u16 a, uae_u16 b, uae_u16 c, uae_u8 mt)
+{
+	uae_u16 d = 0;
+	int k;
+	for (k = 0; k < 8; k++) {
+		if (mt & (1 << k))
+			d |= ((k & 4) ? a : ~a) & ((k & 2) ? b : ~b) & ((k & 1) ? c : ~c);
+	}
+	return d;
+}
+
+static int minterm_c (uae_u16 *d, const uae_u16 *a, const uae_u16 *b, const uae_u16 *c, int n, uae_u8 mt)
+{
+	uae_u16 total = 0;
+	int i;
+
+	switch (mt)
+	{
+	case 0x00:
+		memset (d, 0, n * 2);
+		return 0;
+	case 0xf0:
+		for (i = 0; i < n; i++)
+			total |= d[i] = a[i];
+		break;
+	case 0xcc:
+		for (i = 0; i < n; i++)
+			total |= d[i] = b[i];
+		break;
+	case 0xca:
+		for (i = 0; i < n; i++)
+			total |= d[i] = (a[i] & b[i]) | (~a[i] & c[i]);
+		break;
+	default:
+		for (i = 0; i < n; i++)
+			total |= d[i] = minterm_word (a[i], b[i], c[i], mt);
+		break;
+	}
+	return total != 0;
+}
+
+static const struct blitsimd_kernels kernels_c = {
+	_T("C"), load_c, store_c, shift_c, minterm_c
+};
+
+#ifdef BLITSIMD_SSE2
+
+STATIC_INLINE __m128i bswap_sse2 (__m128i x)
+{
+	return _mm_or_si128 (_mm_slli_epi16 (x, 8), _mm_srli_epi16 (x, 8));
+}
+
+STATIC_INLINE __m128i reverse_sse2 (__m128i x)
+{
+	x = _mm_shuffle_epi32 (x, 0x1b);
+	x = _mm_shufflelo_epi16 (x, 0xb1);
+	return _mm_shufflehi_epi16 (x, 0xb1);
+}
+
+static void load_sse2 (uae_u16 *dst, const uae_u8 *src, int n, int desc)
+{
+	int i = 0;
+	if (desc) {
+		for (; i + 8 <= n; i += 8) {
+			__m128i x = _mm_loadu_si128 ((const __m128i*)(src - 2 * i - 14));
+			_mm_storeu_si128 ((__m128i*)(dst + i), bswap_sse2 (reverse_sse2 (x)));
+		}
+	} else {
+		for (; i + 8 <= n; i += 8) {
+			__m128i x = _mm_loadu_si128 ((const __m128i*)(src + 2 * i));
+			_mm_storeu_si128 ((__m128i*)(dst + i), bswap_sse2 (x));
+		}
+	}
+	if (i < n)
+		load_c (dst + i, desc ? src - 2 * i : src + 2 * i, n - i, desc);
+}
+
+static void store_sse2 (uae_u8 *dst, const uae_u16 *src, int n, int desc)
+{
+	int i = 0;
+	if (desc) {
+		for (; i + 8 <= n; i += 8) {
+			__m128i x = _mm_loadu_si128 ((const __m128i*)(src + i));
+			_mm_storeu_si128 ((__m128i*)(dst - 2 * i - 14), reverse_sse2 (bswap_sse2 (x)));
+		}
+	} else {
+		for (; i + 8 <= n; i += 8) {
+			__m128i x = _mm_loadu_si128 ((const __m128i*)(src + i));
+			_mm_storeu_si128 ((__m128i*)(dst + 2 * i), bswap_sse2 (x));
+		}
+	}
+	if (i < n)
+		store_c (desc ? dst - 2 * i : dst + 2 * i, src + i, n - i, desc);
+}
+
+static void shift_sse2 (uae_u16 *dst, const uae_u16 *src, int n, int r, int desc)
+{
+	__m128i rs = _mm_cvtsi32_si128 (r);
+	__m128i ls = _mm_cvtsi32_si128 (16 - r);
+	int i = 0;
+
+	for (; i + 8 <= n; i += 8) {
+		__m128i cur = _mm_loadu_si128 ((const __m128i*)(src + i));
+		__m128i prev = _mm_loadu_si128 ((const __m128i*)(src + i - 1));
+		__m128i x;
+		if (desc)
+			x = _mm_or_si128 (_mm_srl_epi16 (prev, rs), _mm_sll_epi16 (cur, ls));
+		else
+			x = _mm_or_si128 (_mm_srl_epi16 (cur, rs), _mm_sll_epi16 (prev, ls));
+		_mm_storeu_si128 ((__m128i*)(dst + i), x);
+	}
+	if (i < n)
+		shift_c (dst + i, src + i, n - i, r, desc);
+}
+
+static int minterm_sse2 (uae_u16 *d, const uae_u16 *a, const uae_u16 *b, const uae_u16 *c, int n, uae_u8 mt)
+{
+	__m128i total = _mm_setzero_si128 ();
+	__m128i ones = _mm_set1_epi16 (-1);
+	int i = 0, k;
+
+	for (; i + 8 <= n; i += 8) {
+		__m128i va = _mm_loadu_si128 ((const __m128i*)(a + i));
+		__m128i vb = _mm_loadu_si128 ((const __m128i*)(b + i));
+		__m128i vc = _mm_loadu_si128 ((const __m128i*)(c + i));
+		__m128i vd;
+		switch (mt)
+		{
+		case 0x00:
+			vd = _mm_setzero_si128 ();
+			break;
+		case 0xf0:
+			vd = va;
+			break;
+		case 0xcc:
+			vd = vb;
+			break;
+		case 0xca:
+			vd = _mm_or_si128 (_mm_and_si128 (va, vb), _mm_andnot_si128 (va, vc));
+			break;
+		default:
+			vd = _mm_setzero_si128 ();
+			for (k = 0; k < 8; k++) {
+				if (mt & (1 << k)) {
+					__m128i t = (k & 4) ? va : _mm_xor_si128 (va, ones);
+					t = _mm_and_si128 (t, (k & 2) ? vb : _mm_xor_si128 (vb, ones));
+					t = _mm_and_si128 (t, (k & 1) ? vc : _mm_xor_si128 (vc, ones));
+					vd = _mm_or_si128 (vd, t);
+				}
+			}
+			break;
+		}
+		total = _mm_or_si128 (total, vd);
+		_mm_storeu_si128 ((__m128i*)(d + i), vd);
+	}
+	k = _mm_movemask_epi8 (_mm_cmpeq_epi8 (total, _mm_setzero_si128 ())) != 0xffff;
+	if (i < n)
+		k |= minterm_c (d + i, a + i, b + i, c + i, n - i, mt);
+	return k;
+}
+
+static const struct blitsimd_kernels kernels_sse2 = {
+	_T("SSE2"), load_sse2, store_sse2, shift_sse2, minterm_sse2
+};
+
+#endif
+
+#ifdef BLITSIMD_AVX2
+
+#define AVX2 __attribute__ ((target ("avx2")))
+
+AVX2 STATIC_INLINE __m256i bswap_avx2 (__m256i x)
+{
+	const __m256i m = _mm256_setr_epi8 (1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+		1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	return _mm256_shuffle_epi8 (x, m);
+}
+
+/* reverse word order and swap bytes in one go */
+AVX2 STATIC_INLINE __m256i reverse_bswap_avx2 (__m256i x)
+{
+	const __m256i m = _mm256_setr_epi8 (15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+		15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	return _mm256_shuffle_epi8 (_mm256_permute4x64_epi64 (x, 0x4e), m);
+}
+
+AVX2 static void load_avx2 (uae_u16 *dst, const uae_u8 *src, int n, int desc)
+{
+	int i = 0;
+	if (desc) {
+		for (; i + 16 <= n; i += 16) {
+			__m256i x = _mm256_loadu_si256 ((const __m256i*)(src - 2 * i - 30));
+			_mm256_storeu_si256 ((__m256i*)(dst + i), reverse_bswap_avx2 (x));
+		}
+	} else {
+		for (; i + 16 <= n; i += 16) {
+			__m256i x = _mm256_loadu_si256 ((const __m256i*)(src + 2 * i));
+			_mm256_storeu_si256 ((__m256i*)(dst + i), bswap_avx2 (x));
+		}
+	}
+	if (i < n)
+		load_sse2 (dst + i, desc ? src - 2 * i : src + 2 * i, n - i, desc);
+}
+
+AVX2 static void store_avx2 (uae_u8 *dst, const uae_u16 *src, int n, int desc)
+{
+	int i = 0;
+	if (desc) {
+		for (; i + 16 <= n; i += 16) {
+			__m256i x = _mm256_loadu_si256 ((const __m256i*)(src + i));
+			_mm256_storeu_si256 ((__m256i*)(dst - 2 * i - 30), reverse_bswap_avx2 (x));
+		}
+	} else {
+		for (; i + 16 <= n; i += 16) {
+			__m256i x = _mm256_loadu_si256 ((const __m256i*)(src + i));
+			_mm256_storeu_si256 ((__m256i*)(dst + 2 * i), bswap_avx2 (x));
+		}
+	}
+	if (i < n)
+		store_sse2 (desc ? dst - 2 * i : dst + 2 * i, src + i, n - i, desc);
+}
+
+AVX2 static void shift_avx2 (uae_u16 *dst, const uae_u16 *src, int n, int r, int desc)
+{
+	__m128i rs = _mm_cvtsi32_si128 (r);
+	__m128i ls = _mm_cvtsi32_si128 (16 - r);
+	int i = 0;
+
+	for (; i + 16 <= n; i += 16) {
+		__m256i cur = _mm256_loadu_si256 ((const __m256i*)(src + i));
+		__m256i prev = _mm256_loadu_si256 ((const __m256i*)(src + i - 1));
+		__m256i x;
+		if (desc)
+			x = _mm256_or_si256 (_mm256_srl_epi16 (prev, rs), _mm256_sll_epi16 (cur, ls));
+		else
+			x = _mm256_or_si256 (_mm256_srl_epi16 (cur, rs), _mm256_sll_epi16 (prev, ls));
+		_mm256_storeu_si256 ((__m256i*)(dst + i), x);
+	}
+	if (i < n)
+		shift_sse2 (dst + i, src + i, n - i, r, desc);
+}
+
+AVX2 static int minterm_avx2 (uae_u16 *d, const uae_u16 *a, const uae_u16 *b, const uae_u16 *c, int n, uae_u8 mt)
+{
+	__m256i total = _mm256_setzero_si256 ();
+	__m256i ones = _mm256_set1_epi16 (-1);
+	int i = 0, k;
+
+	for (; i + 16 <= n; i += 16) {
+		__m256i va = _mm256_loadu_si256 ((const __m256i*)(a + i));
+		__m256i vb = _mm256_loadu_si256 ((const __m256i*)(b + i));
+		__m256i vc = _mm256_loadu_si256 ((const __m256i*)(c + i));
+		__m256i vd;
+		switch (mt)
+		{
+		case 0x00:
+			vd = _mm256_setzero_si256 ();
+			break;
+		case 0xf0:
+			vd = va;
+			break;
+		case 0xcc:
+			vd = vb;
+			break;
+		case 0xca:
+			vd = _mm256_or_si256 (_mm256_and_si256 (va, vb), _mm256_andnot_si256 (va, vc));
+			break;
+		default:
+			vd = _mm256_setzero_si256 ();
+			for (k = 0; k < 8; k++) {
+				if (mt & (1 << k)) {
+					__m256i t = (k & 4) ? va : _mm256_xor_si256 (va, ones);
+					t = _mm256_and_si256 (t, (k & 2) ? vb : _mm256_xor_si256 (vb, ones));
+					t = _mm256_and_si256 (t, (k & 1) ? vc : _mm256_xor_si256 (vc, ones));
+					vd = _mm256_or_si256 (vd, t);
+				}
+			}
+			break;
+		}
+		total = _mm256_or_si256 (total, vd);
+		_mm256_storeu_si256 ((__m256i*)(d + i), vd);
+	}
+	k = !_mm256_testz_si256 (total, total);
+	if (i < n)
+		k |= minterm_sse2 (d + i, a + i, b + i, c + i, n - i, mt);
+	return k;
+}
+
+static const struct blitsimd_kernels kernels_avx2 = {
+	_T("AVX2"), load_avx2, store_avx2, shift_avx2, minterm_avx2
+};
+
+#endif
+
+static const struct blitsimd_kernels *kernels;
+
+void blitter_simd_init (int level)
+{
+	kernels = &kernels_c;
+#ifdef BLITSIMD_SSE2
+	if (level > 0)
+		kernels = &kernels_sse2;
+#endif
+#ifdef BLITSIMD_AVX2
+	if (level > 1) {
+		__builtin_cpu_init ();
+		if (__builtin_cpu_supports ("avx2"))
+			kernels = &kernels_avx2;
+	}
+#endif
+	write_log (_T("Blitter: %s kernels\n"), kernels->name);
+}
+
+/* lowest and highest byte touched by a channel */
+void blitter_simd_range (uaecptr pt, int mod, int w, int h, int desc, uae_s64 *lo, uae_s64 *hi)
+{
+	uae_s64 stride = w * 2 + mod;
+	uae_s64 first = pt, last;
+
+	if (desc) {
+		last = first - (h - 1) * stride;
+		*lo = (first < last ? first : last) - (w - 1) * 2;
+		*hi = (first > last ? first : last) + 1;
+	} else {
+		last = first + (h - 1) * stride;
+		*lo = first < last ? first : last;
+		*hi = (first > last ? first : last) + (w - 1) * 2 + 1;
+	}
+}
+
+/* Source read after D line was written? Only safe if disjoint or
+ * exactly the same words in the same order as D */
+static bool blitter_simd_check (uaecptr pt, int mod, uaecptr ptd, int dmod, int w, int h, int desc, uae_u32 memsize)
+{
+	uae_s64 lo, hi, dlo, dhi;
+
+	blitter_simd_range (pt, mod, w, h, desc, &lo, &hi);
+	if (lo < 0 || hi >= memsize)
+		return false;
+	if (!ptd || pt == ptd)
+		return pt != ptd || (mod == dmod && mod >= 0);
+	blitter_simd_range (ptd, dmod, w, h, desc, &dlo, &dhi);
+	return hi < dlo || lo > dhi;
+}
+
+static uae_u16 blitbuf[5][BLITTER_MAX_WORDS + 16];
+
+int blitter_simd_blit (uae_u8 *mem, uae_u32 memsize, uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd,
+	struct bltinfo *b, uae_u8 mt, int desc, int fillmode, int *fcp, uae_u8 (*filltable)[4][2])
+{
+	int w = b->hblitsize, h = b->vblitsize;
+	int dir = desc ? -1 : 1;
+	uae_u16 *abuf = blitbuf[0] + 8, *bbuf = blitbuf[1] + 8, *cbuf = blitbuf[2] + 8;
+	uae_u16 *sa = blitbuf[3] + 8, *sb = blitbuf[4] + 8, *dbuf = sa;
+	uae_u16 preva = 0, prevb = 0, rawa = 0, rawb = 0;
+	uae_u16 amask0, amask1;
+	int ashift, bshift, j, i, nonzero = 0, fc = *fcp;
+
+	if (!kernels || w <= 0 || h <= 0 || w > BLITTER_MAX_WORDS)
+		return 0;
+	if (pta && !blitter_simd_check (pta, b->bltamod, ptd, b->bltdmod, w, h, desc, memsize))
+		return 0;
+	if (ptb && !blitter_simd_check (ptb, b->bltbmod, ptd, b->bltdmod, w, h, desc, memsize))
+		return 0;
+	if (ptc && !blitter_simd_check (ptc, b->bltcmod, ptd, b->bltdmod, w, h, desc, memsize))
+		return 0;
+	if (ptd && !blitter_simd_check (ptd, b->bltdmod, 0, 0, w, h, desc, memsize))
+		return 0;
+
+	ashift = desc ? b->blitdownashift : b->blitashift;
+	bshift = desc ? b->blitdownbshift : b->blitbshift;
+	amask0 = b->bltafwm;
+	amask1 = b->bltalwm;
+	if (w == 1)
+		amask0 &= amask1;
+	if (!pta) {
+		for (i = 0; i < w; i++)
+			abuf[i] = b->bltadat;
+	}
+	if (!ptb) {
+		for (i = 0; i < w; i++)
+			sb[i] = b->bltbhold;
+	}
+	if (!ptc) {
+		for (i = 0; i < w; i++)
+			cbuf[i] = b->bltcdat;
+	}
+
+	for (j = 0; j < h; j++) {
+		if (pta) {
+			kernels->load (abuf, mem + pta, w, desc);
+			rawa = abuf[w - 1];
+			pta += dir * (w * 2 + b->bltamod);
+		} else if (j > 0) {
+			abuf[0] = abuf[w - 1] = b->bltadat;
+		}
+		abuf[0] &= amask0;
+		if (w > 1)
+			abuf[w - 1] &= amask1;
+		abuf[-1] = preva;
+		kernels->shift (sa, abuf, w, ashift, desc);
+		preva = abuf[w - 1];
+
+		if (ptb) {
+			kernels->load (bbuf, mem + ptb, w, desc);
+			bbuf[-1] = prevb;
+			kernels->shift (sb, bbuf, w, bshift, desc);
+			rawb = prevb = bbuf[w - 1];
+			ptb += dir * (w * 2 + b->bltbmod);
+		}
+		if (ptc) {
+			kernels->load (cbuf, mem + ptc, w, desc);
+			ptc += dir * (w * 2 + b->bltcmod);
+		}
+
+		i = kernels->minterm (dbuf, sa, sb, cbuf, w, mt);
+		if (fillmode < 0) {
+			nonzero |= i;
+		} else {
+			// fill carry runs through the whole line, no way around doing it serially
+			uae_u16 total = 0;
+			fc = *fcp;
+			for (i = 0; i < w; i++) {
+				uae_u16 d = dbuf[i];
+				int fc1 = filltable[d & 255][fillmode + fc][1];
+				dbuf[i] = filltable[d & 255][fillmode + fc][0] + (filltable[d >> 8][fillmode + fc1][0] << 8);
+				fc = filltable[d >> 8][fillmode + fc1][1];
+				total |= dbuf[i];
+			}
+			nonzero |= total != 0;
+		}
+
+		if (ptd) {
+			kernels->store (mem + ptd, dbuf, w, desc);
+			ptd += dir * (w * 2 + b->bltdmod);
+		}
+	}
+
+	if (pta)
+		b->bltadat = rawa;
+	if (ptb) {
+		b->bltbdat = rawb;
+		b->bltbhold = sb[w - 1];
+	}
+	if (ptc) {
+		b->bltcdat = cbuf[w - 1];
+		if (desc)
+			b->bltbdat = cbuf[w - 1];
+	}
+	b->bltddat = dbuf[w - 1];
+	if (nonzero)
+		b->blitzero = 0;
+	*fcp = fc;
+	return 1;
+}
@@ -2125,6 +2125,8 @@ int sys_command_scsi_direct (int unitnum, int type, uaecptr acmd)
 	as.sense_len = get_word (acmd + 26);
 
 	ret = sys_command_scsi_direct_native (unitnum, type, &as);
+	if (as.flags & 1) // SCSIF_READ
+		memory_dirty_address (get_long (acmd + 0), as.actual);
 
 	put_long (acmd + 8, as.actual);
 	put_word (acmd + 18, as.cmdactual);
@@ -1003,6 +1003,8 @@ void host_recvfrom (TrapContext *context, SB, uae_u32 sd, uae_u32 msg, uae_u32 l
     uae_sem_post (&sb->sem);
 
     WAITSIGNAL;
+    if ((uae_s32)sb->resultval > 0)
+	memory_dirty_address (msg, sb->resultval);
 }
 
 void host_setsockopt (SB, uae_u32 sd, uae_u32 level, uae_u32 optname, uae_u32 optval, uae_u32 optlen)
@@ -228,7 +228,7 @@ static const TCHAR *obsolete[] = {
 	_T("gfx_immediate_blits"), _T("gfx_ntsc"), _T("win32"), _T("gfx_filter_bits"),
 	_T("sound_pri_cutoff"), _T("sound_pri_time"), _T("sound_min_buff"), _T("sound_bits"),
 	_T("gfx_test_speed"), _T("gfxlib_replacement"), _T("enforcer"), _T("catweasel_io"),
-	_T("kickstart_key_file"), _T("fast_copper"), _T("sound_adjust"), _T("sound_latency"),
+	_T("kickstart_key_file"), _T("fast_copper"), _T("sound_adjust"),
 	_T("serial_hardware_dtrdsr"), _T("gfx_filter_upscale"),
 	_T("gfx_correct_aspect"), _T("gfx_autoscale"), _T("parallel_sampler"), _T("parallel_ascii_emulation"),
 	_T("avoid_vid"), _T("avoid_dga"), _T("z3chipmem_size"), _T("state_replay_buffer"), _T("state_replay"),
@@ -1046,6 +1046,8 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_write (f, _T("nr_floppies"), _T("%d"), p->nr_floppies);
 	cfgfile_dwrite_bool (f, _T("floppy_write_protect"), p->floppy_read_only);
 	cfgfile_write (f, _T("floppy_speed"), _T("%d"), p->floppy_speed);
+	cfgfile_dwrite (f, _T("floppy_track_cache"), _T("%d"), p->floppy_track_cache);
+	cfgfile_dwrite_bool (f, _T("floppy_track_cache_preload"), p->floppy_track_cache_preload);
 #ifdef DRIVESOUND
 	cfgfile_write (f, _T("floppy_volume"), _T("%d"), p->dfxclickvolume);
 	cfgfile_dwrite (f, _T("floppy_channel_mask"), _T("0x%x"), p->dfxclickchannelmask);
@@ -1064,6 +1066,7 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_write (f, _T("sound_stereo_separation"), _T("%d"), p->sound_stereo_separation);
 	cfgfile_write (f, _T("sound_stereo_mixing_delay"), _T("%d"), p->sound_mixed_stereo_delay >= 0 ? p->sound_mixed_stereo_delay : 0);
 	cfgfile_write (f, _T("sound_max_buff"), _T("%d"), p->sound_maxbsiz);
+	cfgfile_write (f, _T("sound_latency"), _T("%d"), p->sound_latency);
 	cfgfile_write (f, _T("sound_frequency"), _T("%d"), p->sound_freq);
 	cfgfile_write_str (f, _T("sound_interpol"), interpolmode[p->sound_interpol]);
 	cfgfile_write_str (f, _T("sound_filter"), soundfiltermode1[p->sound_filter]);
@@ -1202,6 +1205,7 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_write_str (f, _T("gfx_display_name_rtg"), target_get_display_name (p->gfx_apmode[APMODE_RTG].gfx_display, false));
 
 	cfgfile_write (f, _T("gfx_framerate"), _T("%d"), p->gfx_framerate);
+	cfgfile_dwrite (f, _T("gfx_render_threads"), _T("%d"), p->gfx_render_threads);
 	write_resolution (f, _T("gfx_width"), _T("gfx_height"), &p->gfx_size_win); /* compatibility with old versions */
 	cfgfile_write (f, _T("gfx_top_windowed"), _T("%d"), p->gfx_size_win.x);
 	cfgfile_write (f, _T("gfx_left_windowed"), _T("%d"), p->gfx_size_win.y);
@@ -1486,6 +1490,7 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_write_bool (f, _T("blitter_cycle_exact"), p->blitter_cycle_exact);
 	cfgfile_write_bool (f, _T("cycle_exact"), p->cpu_cycle_exact && p->blitter_cycle_exact ? 1 : 0);
 	cfgfile_dwrite_bool (f, _T("fpu_no_unimplemented"), p->fpu_no_unimplemented);
+	cfgfile_dwrite_bool (f, _T("fpu_fast"), p->fpu_fast);
 	cfgfile_dwrite_bool (f, _T("cpu_no_unimplemented"), p->int_no_unimplemented);
 
 	cfgfile_write_bool (f, _T("rtg_nocustom"), p->picasso96_nocustom);
@@ -1511,6 +1516,8 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 #ifdef SAVESTATE
 	cfgfile_dwrite (f, _T("state_replay_rate"), _T("%d"), p->statecapturerate);
 	cfgfile_dwrite (f, _T("state_replay_buffers"), _T("%d"), p->statecapturebuffersize);
+	cfgfile_dwrite (f, _T("state_replay_keyframe"), _T("%d"), p->statecapturekeyframe);
+	cfgfile_dwrite (f, _T("state_replay_memory"), _T("%d"), p->statecapturememory);
 	cfgfile_dwrite_bool (f, _T("state_replay_autoplay"), p->inprec_autoplay);
 #endif
 	cfgfile_dwrite_bool (f, _T("warp"), p->turbo_emulation);
@@ -1522,6 +1529,10 @@ void cfgfile_save_options (struct zfile *f, struct uae_prefs *p, int type)
 	cfgfile_dwrite (f, _T("filesys_max_size"), _T("%d"), p->filesys_limit);
 	cfgfile_dwrite (f, _T("filesys_max_name_length"), _T("%d"), p->filesys_max_name);
 	cfgfile_dwrite (f, _T("filesys_max_file_size"), _T("%d"), p->filesys_max_file_size);
+	cfgfile_dwrite (f, _T("hardfile_cache"), _T("%d"), p->hardfile_cache);
+	cfgfile_dwrite (f, _T("hardfile_readahead"), _T("%d"), p->hardfile_readahead);
+	cfgfile_dwrite (f, _T("hardfile_writeback"), _T("%d"), p->hardfile_writeback);
+	cfgfile_dwrite_bool (f, _T("hardfile_mmap"), p->hardfile_mmap);
 #endif
 	write_inputdevice_config (p, f);
 }
@@ -2008,9 +2019,13 @@ static int cfgfile_parse_host (struct uae_prefs *p, TCHAR *option, TCHAR *value)
 
 	if (cfgfile_intval (option, value, _T("sound_frequency"), &p->sound_freq, 1)
 		|| cfgfile_intval (option, value, _T("sound_max_buff"), &p->sound_maxbsiz, 1)
+		|| cfgfile_intval (option, value, _T("sound_latency"), &p->sound_latency, 1)
 		|| cfgfile_intval (option, value, _T("state_replay_rate"), &p->statecapturerate, 1)
 		|| cfgfile_intval (option, value, _T("state_replay_buffers"), &p->statecapturebuffersize, 1)
+		|| cfgfile_intval (option, value, _T("state_replay_keyframe"), &p->statecapturekeyframe, 1)
+		|| cfgfile_intval (option, value, _T("state_replay_memory"), &p->statecapturememory, 1)
 		|| cfgfile_yesno (option, value, _T("state_replay_autoplay"), &p->inprec_autoplay)
+		|| cfgfile_yesno (option, value, _T("hardfile_mmap"), &p->hardfile_mmap)
 		|| cfgfile_intval (option, value, _T("sound_frequency"), &p->sound_freq, 1)
 		|| cfgfile_intval (option, value, _T("sound_volume"), &p->sound_volume, 1)
 		|| cfgfile_intval (option, value, _T("sound_volume_cd"), &p->sound_volume_cd, 1)
@@ -2020,6 +2035,7 @@ static int cfgfile_parse_host (struct uae_prefs *p, TCHAR *option, TCHAR *value)
 		|| cfgfile_intval (option, value, _T("sampler_buffer"), &p->sampler_buffer, 1)
 
 		|| cfgfile_intval (option, value, _T("gfx_framerate"), &p->gfx_framerate, 1)
+		|| cfgfile_intval (option, value, _T("gfx_render_threads"), &p->gfx_render_threads, 1)
 		|| cfgfile_intval (option, value, _T("gfx_top_windowed"), &p->gfx_size_win.x, 1)
 		|| cfgfile_intval (option, value, _T("gfx_left_windowed"), &p->gfx_size_win.y, 1)
 		|| cfgfile_intval (option, value, _T("gfx_refreshrate"), &p->gfx_apmode[APMODE_NATIVE].gfx_refreshrate, 1)
@@ -2038,6 +2054,9 @@ static int cfgfile_parse_host (struct uae_prefs *p, TCHAR *option, TCHAR *value)
 		|| cfgfile_intval (option, value, _T("filesys_max_size"), &p->filesys_limit, 1)
 		|| cfgfile_intval (option, value, _T("filesys_max_name_length"), &p->filesys_max_name, 1)
 		|| cfgfile_intval (option, value, _T("filesys_max_file_size"), &p->filesys_max_file_size, 1)
+		|| cfgfile_intval (option, value, _T("hardfile_cache"), &p->hardfile_cache, 1)
+		|| cfgfile_intval (option, value, _T("hardfile_readahead"), &p->hardfile_readahead, 1)
+		|| cfgfile_intval (option, value, _T("hardfile_writeback"), &p->hardfile_writeback, 1)
 
 		|| cfgfile_intval (option, value, _T("gfx_luminance"), &p->gfx_luminance, 1)
 		|| cfgfile_intval (option, value, _T("gfx_contrast"), &p->gfx_contrast, 1)
@@ -3494,6 +3513,7 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 
 	if (cfgfile_yesno (option, value, _T("immediate_blits"), &p->immediate_blits)
 		|| cfgfile_yesno (option, value, _T("fpu_no_unimplemented"), &p->fpu_no_unimplemented)
+		|| cfgfile_yesno (option, value, _T("fpu_fast"), &p->fpu_fast)
 		|| cfgfile_yesno (option, value, _T("cpu_no_unimplemented"), &p->int_no_unimplemented)
 		|| cfgfile_yesno (option, value, _T("cd32cd"), &p->cs_cd32cd)
 		|| cfgfile_yesno (option, value, _T("cd32c2p"), &p->cs_cd32c2p)
@@ -3548,6 +3568,7 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 #endif
 		|| cfgfile_yesno (option, value, _T("rtg_nocustom"), &p->picasso96_nocustom)
 		|| cfgfile_yesno (option, value, _T("floppy_write_protect"), &p->floppy_read_only)
+		|| cfgfile_yesno (option, value, _T("floppy_track_cache_preload"), &p->floppy_track_cache_preload)
 		|| cfgfile_yesno (option, value, _T("uae_hide_autoconfig"), &p->uae_hide_autoconfig)
 		|| cfgfile_yesno (option, value, _T("uaeserial"), &p->uaeserial))
 		return 1;
@@ -3577,6 +3598,7 @@ static int cfgfile_parse_hardware (struct uae_prefs *p, const TCHAR *option, TCH
 		|| cfgfile_intval (option, value, _T("floppy_write_length"), &p->floppy_write_length, 1)
 		|| cfgfile_intval (option, value, _T("floppy_random_bits_min"), &p->floppy_random_bits_min, 1)
 		|| cfgfile_intval (option, value, _T("floppy_random_bits_max"), &p->floppy_random_bits_max, 1)
+		|| cfgfile_intval (option, value, _T("floppy_track_cache"), &p->floppy_track_cache, 1)
 		|| cfgfile_intval (option, value, _T("nr_floppies"), &p->nr_floppies, 1)
 		|| cfgfile_intval (option, value, _T("floppy0type"), &p->floppyslots[0].dfxtype, 1)
 		|| cfgfile_intval (option, value, _T("floppy1type"), &p->floppyslots[1].dfxtype, 1)
@@ -5224,6 +5246,7 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->sound_mixed_stereo_delay = 0;
 	p->sound_freq = DEFAULT_SOUND_FREQ;
 	p->sound_maxbsiz = DEFAULT_SOUND_MAXB;
+	p->sound_latency = 100;
 	p->sound_interpol = 1;
 	p->sound_filter = FILTER_SOUND_EMUL;
 	p->sound_filter_type = 0;
@@ -5266,6 +5289,7 @@ void default_prefs (struct uae_prefs *p, int type)
 #endif
 	p->gfx_framerate = 1;
 	p->gfx_autoframerate = 50;
+	p->gfx_render_threads = 0;
 	p->gfx_size_fs.width = 800;
 	p->gfx_size_fs.height = 600;
 	p->gfx_size_win.width = 720;
@@ -5415,6 +5439,7 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->cpu060_revision = 6;
 	p->fpu_revision = 0;
 	p->fpu_no_unimplemented = false;
+	p->fpu_fast = false;
 	p->int_no_unimplemented = false;
 	p->m68k_speed = 0;
 	p->cpu_compatible = 1;
@@ -5427,6 +5452,10 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->filesys_limit = 0;
 	p->filesys_max_name = 107;
 	p->filesys_max_file_size = 0x7fffffff;
+	p->hardfile_cache = 32;
+	p->hardfile_readahead = 2;
+	p->hardfile_writeback = 0;
+	p->hardfile_mmap = false;
 
 	p->fastmem_size = 0x00000000;
 	p->fastmem2_size = 0x00000000;
@@ -5455,6 +5484,8 @@ void default_prefs (struct uae_prefs *p, int type)
 	p->floppy_write_length = 0;
 	p->floppy_random_bits_min = 1;
 	p->floppy_random_bits_max = 3;
+	p->floppy_track_cache = 32;
+	p->floppy_track_cache_preload = false;
 #ifdef DRIVESOUND
 	p->dfxclickvolume = 33;
 	p->dfxclickchannelmask = 0xffff;
@@ -5463,6 +5494,8 @@ void default_prefs (struct uae_prefs *p, int type)
 #ifdef SAVESTATE
 	p->statecapturebuffersize = 100;
 	p->statecapturerate = 5 * 50;
+	p->statecapturekeyframe = 0;
+	p->statecapturememory = 0;
 	p->inprec_autoplay = true;
 #endif
 
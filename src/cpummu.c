@@ -51,6 +51,9 @@ static bool ismoves;
 bool mmu_ttr_enabled;
 int mmu_atc_ways;
 
+struct mmu_tlb_entry mmu_tlb[MMU_TLB_TYPES][MMU_TLB_SIZE];
+uae_u64 mmu_tlb_hits, mmu_tlb_misses;
+
 int mmu040_movem;
 uaecptr mmu040_movem_ea;
 uae_u32 mmu040_move16[4];
@@ -101,6 +104,35 @@ void mmu_make_transparent_region(uaecptr baseaddr, uae_u32 size, int datamode)
 void mmu_tt_modified (void)
 {
 	mmu_ttr_enabled = ((regs.dtt0 | regs.dtt1 | regs.itt0 | regs.itt1) & MMU_TTR_BIT_ENABLED) != 0;
+	mmu_tlb_flush ();
+}
+
+void mmu_tlb_flush (void)
+{
+	memset (mmu_tlb, 0, sizeof mmu_tlb);
+}
+
+/* drop addr's page, both halves of an 8k page, all access types */
+void mmu_tlb_flush_page (uaecptr addr)
+{
+	int type, i;
+
+	addr &= ~mmu_pagemask;
+	for (type = 0; type < MMU_TLB_TYPES; type++) {
+		for (i = 0; i <= (int)(mmu_pagemask >> 12); i++)
+			mmu_tlb[type][((addr >> 12) + i) & (MMU_TLB_SIZE - 1)].tag = 0;
+	}
+}
+
+/* ATC line l in slot index is about to be reused for another page */
+void mmu_tlb_evict (struct mmu_atc_line *l, int index)
+{
+	int shift = mmu_pagesize_8k ? 13 : 12;
+
+	if (!l->valid)
+		return;
+	/* tag is (S | addr >> 1) & mmu_tagmask, the slot index holds the bits below it */
+	mmu_tlb_flush_page (((l->tag << 1) & ~((ATC_SLOTS << shift) - 1)) | (index << shift));
 }
 
 
@@ -402,6 +434,8 @@ static uaecptr mmu_fill_atc(uaecptr addr, bool super, bool data, bool write, str
 {
 	uae_u32 desc;
 
+	/* the translation may change, stop using any cached copy of it */
+	mmu_tlb_flush_page(addr);
 	*status = 0;
 	SAVE_EXCEPTION;
 	TRY(prb) {
@@ -711,6 +745,8 @@ uae_u8 REGPARAM2 mmu_get_byte_slow(uaecptr addr, bool super, bool data,
 		mmu_bus_error(addr, mmu_get_fc(super, data), 0, size, rmw, status);
 		return 0;
 	}
+	if (super == (mmu_is_super != 0))
+		mmu_tlb_fill(addr, data ? MMU_TLB_DREAD : MMU_TLB_IREAD, cl);
 	return phys_get_byte(mmu_get_real_address(addr, cl));
 }
 
@@ -722,6 +758,8 @@ uae_u16 REGPARAM2 mmu_get_word_slow(uaecptr addr, bool super, bool data,
 		mmu_bus_error(addr, mmu_get_fc(super, data), 0, size, rmw, status);
 		return 0;
 	}
+	if (super == (mmu_is_super != 0))
+		mmu_tlb_fill(addr, data ? MMU_TLB_DREAD : MMU_TLB_IREAD, cl);
 	return phys_get_word(mmu_get_real_address(addr, cl));
 }
 
@@ -733,6 +771,8 @@ uae_u32 REGPARAM2 mmu_get_long_slow(uaecptr addr, bool super, bool data,
 		mmu_bus_error(addr, mmu_get_fc(super, data), 0, size, rmw, status);
 		return 0;
 	}
+	if (super == (mmu_is_super != 0))
+		mmu_tlb_fill(addr, data ? MMU_TLB_DREAD : MMU_TLB_IREAD, cl);
 	return phys_get_long(mmu_get_real_address(addr, cl));
 }
 
@@ -784,6 +824,8 @@ void REGPARAM2 mmu_put_byte_slow(uaecptr addr, uae_u8 val, bool super, bool data
 		mmu_bus_error(addr, mmu_get_fc(super, data), 1, size, rmw, status);
 		return;
 	}
+	if (data && super == (mmu_is_super != 0))
+		mmu_tlb_fill(addr, MMU_TLB_DWRITE, cl);
 	phys_put_byte(mmu_get_real_address(addr, cl), val);
 }
 
@@ -796,6 +838,8 @@ void REGPARAM2 mmu_put_word_slow(uaecptr addr, uae_u16 val, bool super, bool dat
 		mmu_bus_error(addr, mmu_get_fc(super, data), 1, size, rmw, status);
 		return;
 	}
+	if (data && super == (mmu_is_super != 0))
+		mmu_tlb_fill(addr, MMU_TLB_DWRITE, cl);
 	phys_put_word(mmu_get_real_address(addr, cl), val);
 }
 
@@ -808,6 +852,8 @@ void REGPARAM2 mmu_put_long_slow(uaecptr addr, uae_u32 val, bool super, bool dat
 		mmu_bus_error(addr, mmu_get_fc(super, data), 1, size, rmw, status);
 		return;
 	}
+	if (data && super == (mmu_is_super != 0))
+		mmu_tlb_fill(addr, MMU_TLB_DWRITE, cl);
 	phys_put_long(mmu_get_real_address(addr, cl), val);
 }
 
@@ -1093,6 +1139,7 @@ void REGPARAM2 mmu_flush_atc(uaecptr addr, bool super, bool global)
 {
 	int way,type,index;
 
+	mmu_tlb_flush_page(addr);
 	uaecptr tag = ((super ? 0x80000000 : 0) | (addr >> 1)) & mmu_tagmask;
 	if (mmu_pagesize_8k)
 		index=(addr & 0x0001E000)>>13;
@@ -1113,6 +1160,8 @@ void REGPARAM2 mmu_flush_atc(uaecptr addr, bool super, bool global)
 void REGPARAM2 mmu_flush_atc_all(bool global)
 {
 	unsigned int way,slot,type;
+
+	mmu_tlb_flush();
 	for (type=0;type<ATC_TYPE;type++) {
 		for (way=0;way<ATC_WAYS;way++) {
 			for (slot=0;slot<ATC_SLOTS;slot++) {
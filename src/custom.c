@@ -58,6 +58,7 @@
 #include "sampler.h"
 #include "hrtimer.h"
 #include "sleep.h"
+#include "benchmark.h"
 #include "misc.h"
 
 #define CUSTOM_DEBUG 0
@@ -564,7 +565,7 @@ static void docols (struct color_entry *colentry)
 #endif
 }
 
-extern struct color_entry colors_for_drawing;
+extern RENDER_TLS struct color_entry colors_for_drawing;
 
 void notice_new_xcolors (void)
 {
@@ -5727,6 +5728,7 @@ static void update_copper (int until_hpos)
 	if (until_hpos <= last_copper_hpos)
 		return;
 
+	BENCH_ENTER (BENCH_COPPER);
 	if (until_hpos > (maxhpos & ~1))
 		until_hpos = maxhpos & ~1;
 
@@ -6063,6 +6065,7 @@ static void update_copper (int until_hpos)
 out:
 	cop_state.hpos = c_hpos;
 	last_copper_hpos = until_hpos;
+	BENCH_LEAVE ();
 }
 
 static void compute_spcflag_copper (int hpos)
@@ -6937,16 +6940,19 @@ static void vsync_handler_pre (void)
 
 	if (!vsync_rendered) {
 		frame_time_t start, end;
+		BENCH_ENTER (BENCH_DRAWING);
 		start = read_processor_time ();
 		vsync_handle_redraw (lof_store, lof_changed, bplcon0, bplcon3);
 		vsync_rendered = true;
 		end = read_processor_time ();
 		frameskiptime += end - start;
+		BENCH_LEAVE ();
 	}
 
 	bool frameok = framewait ();
 
-	if (!picasso_on) {
+	/* benchmark frames are drawn but not presented */
+	if (!picasso_on && !bench_running) {
 		if (!frame_rendered && vblank_hz_state) {
 			frame_rendered = render_screen (false);
 		}
@@ -6968,6 +6974,7 @@ static void vsync_handler_pre (void)
 
 	vsync_handle_check ();
 	//checklacecount (bplcon0_interlace_seen || lof_lace);
+	bench_vsync ();
 }
 
 // emulated hardware vsync
@@ -7768,9 +7775,7 @@ void init_eventtab (void)
 		eventtab[i].active = 0;
 		eventtab[i].oldcycles = get_cycles ();
 	}
-	for (i = 0; i < ev2_max; i++) {
-		eventtab2[i].active = 0;
-	}
+	event2_reset ();
 
 	eventtab[ev_cia].handler = CIA_handler;
 	eventtab[ev_hsync].handler = hsync_handler;
@@ -8084,6 +8089,7 @@ int custom_init (void)
 
 	gen_custom_tables ();
 	build_blitfilltable ();
+	blitter_simd_init (2);
 
 	drawing_init ();
 
@@ -8587,14 +8593,7 @@ static void REGPARAM2 custom_lput (uaecptr addr, uae_u32 value)
 
 void custom_prepare_savestate (void)
 {
-	int i;
-
-	for (i = 0; i < ev2_max; i++) {
-		if (eventtab2[i].active) {
-			eventtab2[i].active = 0;
-			eventtab2[i].handler (eventtab2[i].data);
-		}
-	}
+	event2_flush ();
 }
 
 #define RB restore_u8 ()
@@ -9121,27 +9120,29 @@ uae_u8 *restore_custom_event_delay (uae_u8 *src)
 uae_u8 *save_custom_event_delay (int *len, uae_u8 *dstptr)
 {
 	uae_u8 *dstbak, *dst;
+	struct ev2 *e;
 	int cnt = 0;
 
-	for (int i = ev2_misc; i < ev2_max; i++) {
-		struct ev2 *e = &eventtab2[i];
-		if (e->active && e->handler == send_interrupt_do) {
+	for (int i = 0; (e = event2_get (i)); i++) {
+		if (e->handler == send_interrupt_do) {
 			cnt++;
 		}
 	}
 	if (cnt == 0)
 		return NULL;
+	if (cnt > 255)
+		cnt = 255;
 
 	if (dstptr)
 		dstbak = dst = dstptr;
 	else
-		dstbak = dst = xmalloc (uae_u8, 1000);
+		dstbak = dst = xmalloc (uae_u8, 1000 + cnt * 13);
 
 	save_u32 (1);
 	save_u8 (cnt);
-	for (int i = ev2_misc; i < ev2_max; i++) {
-		struct ev2 *e = &eventtab2[i];
-		if (e->active && e->handler == send_interrupt_do) {
+	for (int i = 0; cnt > 0 && (e = event2_get (i)); i++) {
+		if (e->handler == send_interrupt_do) {
+			cnt--;
 			save_u8 (1);
 			save_u64 (e->evtime - get_cycles ());
 			save_u32 (e->data);
@@ -9188,6 +9189,7 @@ void check_prefs_changed_custom (void)
 	if (!config_changed)
 		return;
 	currprefs.gfx_framerate = changed_prefs.gfx_framerate;
+	currprefs.gfx_render_threads = changed_prefs.gfx_render_threads;
 	if (currprefs.turbo_emulation != changed_prefs.turbo_emulation)
 		warpmode (changed_prefs.turbo_emulation);
 	if (inputdevice_config_change_test ())
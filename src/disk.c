@@ -145,6 +145,16 @@ typedef struct {
 
 #define MAX_TRACKS (2 * 83)
 
+/* MFM encoded copy of one track, see drive_track_cache_get () */
+struct trackcache {
+	int tr;
+	unsigned int used;
+	int tracklen, indexoffset, skipoffset, revolutions;
+	int mfmsize, timingsize;
+	uae_u16 *mfm;
+	uae_u16 *timing;
+};
+
 /* We have three kinds of Amiga floppy drives
  * - internal A500/A2000 drive:
  *   ID is always DRIVE_ID_NONE (S.T.A.G expects this)
@@ -217,6 +227,10 @@ typedef struct {
 	int lastrev;
 	bool track_access_done;
 #endif
+	struct trackcache *tcache;
+	int tcache_size, tcache_writelen;
+	unsigned int tcache_used, tcache_hits, tcache_misses;
+	short tcache_slot[MAX_TRACKS];
 } drive;
 
 #define MIN_STEPLIMIT_CYCLE (CYCLE_UNIT * 140)
@@ -623,6 +637,8 @@ static void drive_settype_id (drive *drv)
 #endif
 }
 
+static void drive_track_cache_free (drive *drv);
+
 static void drive_image_free (drive *drv)
 {
 	switch (drv->filetype)
@@ -654,6 +670,7 @@ static void drive_image_free (drive *drv)
 		break;
 	}
 	drv->filetype = ADF_NONE;
+	drive_track_cache_free (drv);
 	zfile_fclose (drv->diskfile);
 	drv->diskfile = 0;
 	zfile_fclose (drv->writediskfile);
@@ -751,6 +768,7 @@ static void update_drive_gui (int num, bool force)
 }
 
 static void drive_fill_bigbuf (drive * drv,int);
+static void drive_track_cache_preload (drive *drv);
 
 int DISK_validate_filename (struct uae_prefs *p, const TCHAR *fname, int leave_open, bool *wrprot, uae_u32 *crc32, struct zfile **zf)
 {
@@ -1262,6 +1280,7 @@ static int drive_insert (drive * drv, struct uae_prefs *p, int dnum, const TCHAR
 	}
 	openwritefile (p, drv, 0);
 	drive_settype_id (drv); /* Set DD or HD drive */
+	drive_track_cache_preload (drv);
 	drive_fill_bigbuf (drv, 1);
 	drv->mfmpos = uaerand ();
 	drv->mfmpos |= (uaerand () << 16);
@@ -1760,6 +1779,132 @@ static void decode_diskspare (drive *drv)
 		write_log (_T("diskspare read track %d\n"), tr);
 }
 
+/* Tracks are kept MFM encoded per drive so seeking back to a track does
+ * not decode it again. Multi revolution (weak bit) tracks are never
+ * cached, every read of them must produce fresh data.
+ */
+static void drive_track_cache_free (drive *drv)
+{
+	int i;
+
+	for (i = 0; i < drv->tcache_size; i++) {
+		xfree (drv->tcache[i].mfm);
+		xfree (drv->tcache[i].timing);
+	}
+	xfree (drv->tcache);
+	drv->tcache = NULL;
+	drv->tcache_size = 0;
+	drv->tcache_hits = drv->tcache_misses = 0;
+}
+
+static bool drive_track_cache_check (drive *drv)
+{
+	int size = currprefs.floppy_track_cache;
+	int i;
+
+	if (size > MAX_TRACKS)
+		size = MAX_TRACKS;
+	if (size < 0)
+		size = 0;
+	if (drv->tcache && (drv->tcache_size != size || drv->tcache_writelen != FLOPPY_WRITE_LEN))
+		drive_track_cache_free (drv);
+	if (!size || drv->filetype == ADF_CATWEASEL)
+		return false;
+	if (!drv->tcache) {
+		drv->tcache = xcalloc (struct trackcache, size);
+		for (i = 0; i < size; i++)
+			drv->tcache[i].tr = -1;
+		for (i = 0; i < MAX_TRACKS; i++)
+			drv->tcache_slot[i] = -1;
+		drv->tcache_size = size;
+		drv->tcache_writelen = FLOPPY_WRITE_LEN;
+	}
+	return true;
+}
+
+static bool drive_track_cache_get (drive *drv, int tr)
+{
+	struct trackcache *tc;
+	int n;
+
+	if (!drive_track_cache_check (drv))
+		return false;
+	n = drv->tcache_slot[tr];
+	if (n < 0) {
+		drv->tcache_misses++;
+		return false;
+	}
+	tc = &drv->tcache[n];
+	tc->used = ++drv->tcache_used;
+	drv->tracklen = tc->tracklen;
+	drv->indexoffset = tc->indexoffset;
+	drv->skipoffset = tc->skipoffset;
+	drv->revolutions = tc->revolutions;
+	memcpy (drv->bigmfmbuf, tc->mfm, tc->mfmsize * sizeof (uae_u16));
+	if (tc->timingsize)
+		memcpy (drv->tracktiming, tc->timing, tc->timingsize * sizeof (uae_u16));
+	drv->tcache_hits++;
+	return true;
+}
+
+static void drive_track_cache_put (drive *drv, int tr)
+{
+	struct trackcache *tc;
+	int i, mfmsize, timingsize;
+
+	if (!drv->tcache || drv->multi_revolution || drv->tcache_slot[tr] >= 0)
+		return;
+	tc = &drv->tcache[0];
+	for (i = 0; i < drv->tcache_size; i++) {
+		if (drv->tcache[i].tr < 0) {
+			tc = &drv->tcache[i];
+			break;
+		}
+		if (drv->tcache[i].used < tc->used)
+			tc = &drv->tcache[i];
+	}
+	if (tc->tr >= 0)
+		drv->tcache_slot[tc->tr] = -1;
+
+	mfmsize = (drv->tracklen + 15) / 16;
+	timingsize = drv->tracktiming[0] ? drv->tracklen / 8 + 1 : 0;
+	if (mfmsize > 0x4000 * DDHDMULT)
+		mfmsize = 0x4000 * DDHDMULT;
+	if (timingsize > 0x4000 * DDHDMULT)
+		timingsize = 0x4000 * DDHDMULT;
+	if (mfmsize > tc->mfmsize) {
+		xfree (tc->mfm);
+		tc->mfm = xmalloc (uae_u16, mfmsize);
+	}
+	if (timingsize > tc->timingsize) {
+		xfree (tc->timing);
+		tc->timing = xmalloc (uae_u16, timingsize);
+	}
+	tc->mfmsize = mfmsize;
+	tc->timingsize = timingsize;
+	memcpy (tc->mfm, drv->bigmfmbuf, mfmsize * sizeof (uae_u16));
+	if (timingsize)
+		memcpy (tc->timing, drv->tracktiming, timingsize * sizeof (uae_u16));
+	tc->tracklen = drv->tracklen;
+	tc->indexoffset = drv->indexoffset;
+	tc->skipoffset = drv->skipoffset;
+	tc->revolutions = drv->revolutions;
+	tc->tr = tr;
+	tc->used = ++drv->tcache_used;
+	drv->tcache_slot[tr] = tc - drv->tcache;
+}
+
+static void drive_track_cache_drop (drive *drv, int tr)
+{
+	int n;
+
+	if (!drv->tcache || drv->tcache_slot[tr] < 0)
+		return;
+	n = drv->tcache_slot[tr];
+	drv->tcache[n].tr = -1;
+	drv->tcache_slot[tr] = -1;
+}
+
 static void drive_fill_bigbuf (drive * drv, int force)
 {
 	int tr = drv->cyl * 2 + side;
@@ -1789,7 +1934,12 @@ static void drive_fill_bigbuf (drive * drv, int force)
 		drv->track_access_done = false;
 	//write_log (_T("%d:%d %d\n"), drv->cyl, side, retrytrack);
 
-	if (drv->writediskfile && drv->writetrackdata[tr].bitlen > 0) {
+	if (drive_track_cache_get (drv, tr)) {
+
+		if (disk_debug_logging > 1)
+			write_log (_T("track %d from cache\n"), tr);
+
+	} else if (drv->writediskfile && drv->writetrackdata[tr].bitlen > 0) {
 		int i;
 		trackid *wti = &drv->writetrackdata[tr];
 		drv->tracklen = wti->bitlen;
@@ -1868,11 +2018,29 @@ static void drive_fill_bigbuf (drive * drv, int force)
 		drv->tracklen = FLOPPY_WRITE_LEN * drv->ddhd * 2 * 8;
 		memset (drv->bigmfmbuf, 0, FLOPPY_WRITE_LEN * 2 * drv->ddhd);
 	}
+	drive_track_cache_put (drv, tr);
 
 	drv->trackspeed = get_floppy_speed2 (drv);
 	updatemfmpos (drv);
 }
 
+/* encode every track of a newly inserted disk into the track cache */
+static void drive_track_cache_preload (drive *drv)
+{
+	int cyl = drv->cyl, oldside = side;
+	int tr;
+
+	if (!currprefs.floppy_track_cache_preload || !drive_track_cache_check (drv))
+		return;
+	for (tr = 0; tr < drv->num_tracks && tr < drv->tcache_size; tr++) {
+		drv->cyl = tr / 2;
+		side = tr & 1;
+		drive_fill_bigbuf (drv, 1);
+	}
+	drv->cyl = cyl;
+	side = oldside;
+}
+
 /* Update ADF_EXT2 track header */
 static void diskfile_update (struct zfile *diskfile, trackid *ti, int len, image_tracktype type)
 {
@@ -2270,6 +2438,7 @@ static void drive_write_data (drive * drv)
 	int ret = -1;
 	int tr = drv->cyl * 2 + side;
 
+	drive_track_cache_drop (drv, tr);
 	if (drive_writeprotected (drv) || drv->trackdata[tr].type == TRACK_NONE) {
 		/* read original track back because we didn't really write anything */
 		drv->buffered_side = 2;
@@ -2349,6 +2518,7 @@ void DISK_ersatz_read (int tr, int sec, uaecptr dest)
 	uae_u8 *dptr = get_real_address (dest);
 	zfile_fseek (floppy[0].diskfile, floppy[0].trackdata[tr].offs + sec * 512, SEEK_SET);
 	zfile_fread (dptr, 1, 512, floppy[0].diskfile);
+	memory_dirty_address (dest, 512);
 }
 
 static void floppy_get_bootblock (uae_u8 *dst, bool ffs, bool bootable)
@@ -2943,6 +3113,9 @@ void dumpdisk (void)
 				}
 				write_log (_T("\n"));
 			}
+			if (drv->tcache)
+				write_log (_T("Track cache %d tracks, %u hits %u misses\n"),
+					drv->tcache_size, drv->tcache_hits, drv->tcache_misses);
 		}
 	}
 	write_log (_T("side %d dma %d off %d word %04X pt %08X len %04X bytr %04X adk %04X sync %04X\n"),
@@ -3262,9 +3435,78 @@ static void disk_doupdate_read_nothing (int floppybits)
 	}
 }
 
+/* DSKBYTR after n bits starting at bit offset b0, c holds the last bits shifted in */
+STATIC_INLINE void read_word_bytr (int b0, int n, uae_u32 c)
+{
+	int last = n - 1 - ((b0 + n) & 7);
+	if (last >= 0)
+		dskbytr_val = ((c >> ((b0 + n) & 7)) & 0xff) | 0x8000;
+}
+
+/* Fixed timing tracks: shift in up to a word of bits in one go. Stops
+ * short of every bit the per-bit loop must see on its own (index, track
+ * wrap and skip positions, sync match), a DMA word is only delivered as
+ * the last bit. Returns bits consumed, 0 if the next bit needs the
+ * per-bit loop, -1 if the fifo overflowed.
+ */
+static int disk_doupdate_read_word (drive *drv, int maxbits)
+{
+	int mfmpos = drv->mfmpos;
+	int dma = dmaen (DMA_DISK) && dma_enable && dskdmaen == DSKDMA_READ && dsklength >= 0;
+	int bits = maxbits > 16 ? 16 : maxbits;
+	int b0 = bitoffset;
+	int i;
+	uae_u16 *buf;
+	uae_u32 v, c;
+
+	if (dma && bits > 16 - b0)
+		bits = 16 - b0;
+	if (bits > drv->tracklen - mfmpos - 1)
+		bits = drv->tracklen - mfmpos - 1;
+	if (drv->indexoffset > mfmpos && bits > drv->indexoffset - mfmpos - 1)
+		bits = drv->indexoffset - mfmpos - 1;
+	if (drv->skipoffset > mfmpos && bits > drv->skipoffset - mfmpos - 1)
+		bits = drv->skipoffset - mfmpos - 1;
+	if (bits <= 0)
+		return 0;
+
+	buf = &drv->bigmfmbuf[mfmpos >> 4];
+	v = (((uae_u32)buf[0] << 16) | buf[1]) << (mfmpos & 15);
+	c = ((uae_u32)word << bits) | (v >> (32 - bits));
+	for (i = 0; i < bits; i++) {
+		if (((c >> (bits - 1 - i)) & 0xffff) == dsksync)
+			break;
+	}
+	if (i < bits) {
+		c >>= bits - i;
+		bits = i;
+		if (!bits)
+			return 0;
+	}
+
+	if (dma && b0 + bits - 1 == 15) {
+		bitoffset = 15;
+		word = c;
+		if (doreaddma () < 0) {
+			/* same state the per-bit loop leaves: last bit not consumed */
+			bits--;
+			c >>= 1;
+			word = c & 0x7fff;
+			read_word_bytr (b0, bits, c);
+			drv->mfmpos += bits;
+			return -1;
+		}
+	}
+	word = c;
+	read_word_bytr (b0, bits, c);
+	drv->mfmpos += bits;
+	bitoffset = (b0 + bits) & 15;
+	return bits;
+}
+
 static void disk_doupdate_read (drive * drv, int floppybits)
 {
-// REMOVEME: int j = 0, k = 1, l = 0;
+	int fixed = !drive_empty (drv) && !unformatted (drv);
 
 	/*
 	uae_u16 *mfmbuf = drv->bigmfmbuf;
@@ -3285,6 +3527,15 @@ static void disk_doupdate_read (drive * drv, int floppybits)
 	mfmbuf[7] = 0x4444;
 	*/
 	while (floppybits >= drv->trackspeed) {
+		if (fixed && !drv->tracktiming[0]) {
+			int bits = disk_doupdate_read_word (drv, floppybits / drv->trackspeed);
+			if (bits < 0)
+				return;
+			if (bits > 0) {
+				floppybits -= bits * drv->trackspeed;
+				continue;
+			}
+		}
 		if (drv->tracktiming[0])
 			updatetrackspeed (drv, drv->mfmpos);
 		word <<= 1;
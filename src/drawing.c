@@ -85,14 +85,14 @@ bool direct_rgb;
    coordinates.  Zero if the resolution is the same, positive if window coordinates
    have a higher resolution (i.e. we're stretching the image), negative if window
    coordinates have a lower resolution (i.e. we're shrinking the image).  */
-static int res_shift;
+static RENDER_TLS int res_shift;
 
 static int linedbl, linedbld;
 
 int interlace_seen = 0;
 #define AUTO_LORES_FRAMES 10
 static int can_use_lores = 0, frame_res, frame_res_lace;
-static int resolution_count[RES_MAX + 1], lines_count;
+static RENDER_TLS int resolution_count[RES_MAX + 1], lines_count;
 static bool center_reset;
 
 /* Lookup tables for dual playfields.  The dblpf_*1 versions are for the case
@@ -127,8 +127,8 @@ struct spritepixelsbuf {
 	uae_u8 stdata;
 	uae_u16 data;
 };
-static struct spritepixelsbuf spritepixels[MAX_PIXELS_PER_LINE];
-static int sprite_first_x, sprite_last_x;
+static RENDER_TLS struct spritepixelsbuf spritepixels[MAX_PIXELS_PER_LINE];
+static RENDER_TLS int sprite_first_x, sprite_last_x;
 
 #ifdef AGA
 /* AGA mode color lookup tables */
@@ -142,12 +142,12 @@ int xredcolor_s, xredcolor_b, xredcolor_m;
 int xgreencolor_s, xgreencolor_b, xgreencolor_m;
 int xbluecolor_s, xbluecolor_b, xbluecolor_m;
 
-struct color_entry colors_for_drawing;
+RENDER_TLS struct color_entry colors_for_drawing;
 
 /* The size of these arrays is pretty arbitrary; it was chosen to be "more
    than enough".  The coordinates used for indexing into these arrays are
    almost, but not quite, Amiga coordinates (there's a constant offset).  */
-union {
+RENDER_TLS union {
 	/* Let's try to align this thing. */
 	double uupzuq;
 	long int cruxmedo;
@@ -165,13 +165,13 @@ uae_u16 spixels[2 * MAX_SPR_PIXELS];
 /* Eight bits for every pixel.  */
 union sps_union spixstate;
 
-static uae_u32 ham_linebuf[MAX_PIXELS_PER_LINE * 2];
-static uae_u8 *real_bplpt[8];
+static RENDER_TLS uae_u32 ham_linebuf[MAX_PIXELS_PER_LINE * 2];
+static RENDER_TLS uae_u8 *real_bplpt[8];
 
 static uae_u8 all_ones[MAX_PIXELS_PER_LINE];
 static uae_u8 all_zeros[MAX_PIXELS_PER_LINE];
 
-uae_u8 *xlinebuffer;
+RENDER_TLS uae_u8 *xlinebuffer;
 
 static int *amiga2aspect_line_map, *native2amiga_line_map;
 static uae_u8 **row_map;
@@ -218,21 +218,30 @@ int thisframe_first_drawn_line, thisframe_last_drawn_line;
 static int last_redraw_point;
 
 #define MAX_STOP 30000
-static int first_drawn_line, last_drawn_line;
-static int first_block_line, last_block_line;
+static RENDER_TLS int first_drawn_line, last_drawn_line;
+static RENDER_TLS int first_block_line, last_block_line;
+#ifdef RENDER_THREADS
+/* set while drawing a band, flush_line ()/flush_block () are done when the
+ * whole frame is ready */
+static RENDER_TLS bool render_deferred_flush;
+static RENDER_TLS uae_u8 *render_emergmem;
+#define EMERGMEM (render_emergmem ? render_emergmem : gfxvidinfo.emergmem)
+#else
+#define EMERGMEM gfxvidinfo.emergmem
+#endif
 
 #define NO_BLOCK -3
 
 /* These are generated by the drawing code from the line_decisions array for
    each line that needs to be drawn.  These are basically extracted out of
    bit fields in the hardware registers.  */
-static int bplehb, bplham, bpldualpf, bpldualpfpri, bpldualpf2of, bplplanecnt, ecsshres;
-static bool issprites;
-static int bplres;
-static int plf1pri, plf2pri, bplxor;
-static uae_u32 plf_sprite_mask;
-static int sbasecol[2] = { 16, 16 };
-static int hposblank;
+static RENDER_TLS int bplehb, bplham, bpldualpf, bpldualpfpri, bpldualpf2of, bplplanecnt, ecsshres;
+static RENDER_TLS bool issprites;
+static RENDER_TLS int bplres;
+static RENDER_TLS int plf1pri, plf2pri, bplxor;
+static RENDER_TLS uae_u32 plf_sprite_mask;
+static RENDER_TLS int sbasecol[2] = { 16, 16 };
+static RENDER_TLS int hposblank;
 static bool specialmonitoron;
 
 bool picasso_requested_on;
@@ -663,8 +672,8 @@ void get_custom_mouse_limits (int *pw, int *ph, int *pdx, int *pdy, int dbl)
 	*pdx = dx; *pdy = dy;
 }
 
-static struct decision *dp_for_drawing;
-static struct draw_info *dip_for_drawing;
+static RENDER_TLS struct decision *dp_for_drawing;
+static RENDER_TLS struct draw_info *dip_for_drawing;
 
 /* Record DIW of the current line for use by centering code.  */
 void record_diw_line (int plfstrt, int first, int last)
@@ -688,15 +697,15 @@ void record_diw_line (int plfstrt, int first, int last)
    where do we start drawing the playfield, where do we start drawing the right border.
    All of these are forced into the visible window (VISIBLE_LEFT_BORDER .. VISIBLE_RIGHT_BORDER).
    PLAYFIELD_START and PLAYFIELD_END are in window coordinates.  */
-static int playfield_start, playfield_end;
-static int real_playfield_start, real_playfield_end;
-static int linetoscr_diw_start, linetoscr_diw_end;
-static int native_ddf_left, native_ddf_right;
+static RENDER_TLS int playfield_start, playfield_end;
+static RENDER_TLS int real_playfield_start, real_playfield_end;
+static RENDER_TLS int linetoscr_diw_start, linetoscr_diw_end;
+static RENDER_TLS int native_ddf_left, native_ddf_right;
 
-static int pixels_offset;
-static int src_pixel;
+static RENDER_TLS int pixels_offset;
+static RENDER_TLS int src_pixel;
 /* How many pixels in window coordinates which are to the left of the left border.  */
-static int unpainted;
+static RENDER_TLS int unpainted;
 
 STATIC_INLINE xcolnr getbgc (bool blank)
 {
@@ -1602,8 +1611,8 @@ static void dummy_worker (int start, int stop, bool blank)
 {
 }
 
-static int ham_decode_pixel;
-static unsigned int ham_lastcolor;
+static RENDER_TLS int ham_decode_pixel;
+static RENDER_TLS unsigned int ham_lastcolor;
 
 /* Decode HAM in the invisible portion of the display (left of VISIBLE_LEFT_BORDER),
  * but don't draw anything in.  This is done to prepare HAM_LASTCOLOR for later,
@@ -1973,6 +1982,12 @@ static void pfield_doline (int lineno)
 #endif
 #endif
 
+	if (bplplanecnt > 0) {
+		int done = p2c_simd (data, real_bplpt, bplplanecnt, wordcount);
+		data += done * 8;
+		wordcount -= done;
+	}
+
 	switch (bplplanecnt) {
 	default: break;
 	case 0: memset (data, 0, wordcount * 32); break;
@@ -2090,6 +2105,10 @@ static void do_flush_line_1 (int lineno)
 	if (lineno > last_drawn_line)
 		last_drawn_line = lineno;
 
+#ifdef RENDER_THREADS
+	if (render_deferred_flush)
+		return;
+#endif
 	if (gfxvidinfo.maxblocklines == 0)
 		flush_line (lineno);
 	else {
@@ -2219,8 +2238,8 @@ static void pfield_expand_dp_bplconx (int regno, int v)
 	res_shift = lores_shift - bplres;
 }
 
-static int drawing_color_matches;
-static enum { color_match_acolors, color_match_full } color_match_type;
+static RENDER_TLS int drawing_color_matches;
+static RENDER_TLS enum { color_match_acolors, color_match_full } color_match_type;
 
 /* Set up colors_for_drawing to the state at the beginning of the currently drawn
    line.  Try to avoid copying color tables around whenever possible.  */
@@ -2403,7 +2422,7 @@ static void pfield_draw_line (int lineno, int gfx_ypos, int follow_ypos)
 	xlinebuffer = gfxvidinfo.linemem;
 	if (xlinebuffer == 0 && do_double
 		&& (border == 0 || have_color_changes))
-		xlinebuffer = gfxvidinfo.emergmem, dh = dh_emerg;
+		xlinebuffer = EMERGMEM, dh = dh_emerg;
 	if (xlinebuffer == 0)
 		xlinebuffer = row_map[gfx_ypos], dh = dh_buf;
 	xlinebuffer -= linetoscr_x_adjust_bytes;
@@ -2984,10 +3003,10 @@ static void lightpen_update (void)
 }
 #endif
 
-static void draw_frame2 (void)
+static void draw_frame_rows (int first, int last)
 {
 	int i;
-	for ( i = 0; i < max_ypos_thisframe; i++) {
+	for (i = first; i < last; i++) {
 		int i1 = i + min_ypos_for_screen;
 		int line = i + thisframe_y_adjust_real;
 		int where2 = amiga2aspect_line_map[i1];
@@ -3001,6 +3020,182 @@ static void draw_frame2 (void)
 	}
 }
 
+static void draw_frame2 (void)
+{
+	draw_frame_rows (0, max_ypos_thisframe);
+}
+
+#ifdef RENDER_THREADS
+
+struct render_band {
+	uae_sem_t start, done;
+	uae_thread_id thread;
+	bool running, quit;
+	int first, last;
+	int first_drawn, last_drawn;
+	int lines_count, resolution_count[RES_MAX + 1];
+	uae_u8 *emergmem;
+	int emergsize;
+};
+
+static struct render_band render_bands[MAX_RENDER_THREADS + 1];
+
+static void draw_frame_band (struct render_band *rb)
+{
+	int i;
+
+	render_deferred_flush = true;
+	render_emergmem = rb->emergmem;
+	first_drawn_line = 32767;
+	last_drawn_line = 0;
+	drawing_color_matches = -1;
+	lines_count = 0;
+	memset (resolution_count, 0, sizeof resolution_count);
+
+	draw_frame_rows (rb->first, rb->last);
+
+	rb->first_drawn = first_drawn_line;
+	rb->last_drawn = last_drawn_line;
+	rb->lines_count = lines_count;
+	for (i = 0; i <= RES_MAX; i++)
+		rb->resolution_count[i] = resolution_count[i];
+	render_deferred_flush = false;
+	render_emergmem = NULL;
+}
+
+static void *render_thread (void *v)
+{
+	struct render_band *rb = (struct render_band*)v;
+
+	for (;;) {
+		uae_sem_wait (&rb->start);
+		if (rb->quit)
+			break;
+		draw_frame_band (rb);
+		uae_sem_post (&rb->done);
+	}
+	return NULL;
+}
+
+static void render_threads_stop (void)
+{
+	int i;
+
+	for (i = 1; i <= MAX_RENDER_THREADS; i++) {
+		struct render_band *rb = &render_bands[i];
+		if (!rb->running)
+			continue;
+		rb->quit = true;
+		uae_sem_post (&rb->start);
+		uae_wait_thread (rb->thread);
+		uae_sem_destroy (&rb->start);
+		uae_sem_destroy (&rb->done);
+		rb->running = false;
+		rb->quit = false;
+		xfree (rb->emergmem);
+		rb->emergmem = NULL;
+		rb->emergsize = 0;
+	}
+}
+
+/* Split the frame in horizontal bands, band 0 is drawn by the emulation
+ * thread, the rest by render threads. Returns false if the frame must be
+ * drawn the normal way. */
+static bool draw_frame_threaded (void)
+{
+	int threads = currprefs.gfx_render_threads;
+	int saved_lines_count, saved_resolution_count[RES_MAX + 1];
+	int saved_first, saved_last;
+	int i, j, rows, step, base;
+
+	if (threads <= 0 || gfxvidinfo.linemem || !gfxvidinfo.maxblocklines)
+		return false;
+	if (threads > MAX_RENDER_THREADS)
+		threads = MAX_RENDER_THREADS;
+	rows = max_ypos_thisframe;
+	if (rows < 16 * (threads + 1))
+		return false;
+
+	for (i = 1; i <= threads; i++) {
+		struct render_band *rb = &render_bands[i];
+		if (gfxvidinfo.emergmem && rb->emergsize < gfxvidinfo.rowbytes) {
+			xfree (rb->emergmem);
+			rb->emergsize = gfxvidinfo.rowbytes;
+			rb->emergmem = xcalloc (uae_u8, rb->emergsize);
+		} else if (!gfxvidinfo.emergmem && rb->emergmem) {
+			xfree (rb->emergmem);
+			rb->emergmem = NULL;
+			rb->emergsize = 0;
+		}
+		if (rb->running)
+			continue;
+		uae_sem_init (&rb->start, 0, 0);
+		uae_sem_init (&rb->done, 0, 0);
+		if (!uae_start_thread (_T("render"), render_thread, rb, &rb->thread)) {
+			write_log (_T("Render thread %d failed to start\n"), i);
+			uae_sem_destroy (&rb->start);
+			uae_sem_destroy (&rb->done);
+			threads = i - 1;
+			break;
+		}
+		rb->running = true;
+	}
+	if (threads <= 0)
+		return false;
+
+	/* Bands start on an even line so that doubled lines and the line
+	 * they are copied to are drawn by the same thread. */
+	base = thisframe_y_adjust_real & 1;
+	step = ((rows + threads) / (threads + 1) + 1) & ~1;
+	for (i = 0; i <= threads; i++) {
+		struct render_band *rb = &render_bands[i];
+		rb->first = i == 0 ? 0 : i * step + base;
+		rb->last = i == threads ? rows : (i + 1) * step + base;
+		if (rb->last > rows)
+			rb->last = rows;
+		if (rb->first > rb->last)
+			rb->first = rb->last;
+	}
+
+	for (i = 1; i <= threads; i++)
+		uae_sem_post (&render_bands[i].start);
+
+	saved_first = first_drawn_line;
+	saved_last = last_drawn_line;
+	saved_lines_count = lines_count;
+	memcpy (saved_resolution_count, resolution_count, sizeof resolution_count);
+	render_bands[0].emergmem = NULL;
+	draw_frame_band (&render_bands[0]);
+	first_drawn_line = saved_first;
+	last_drawn_line = saved_last;
+	lines_count = saved_lines_count;
+	memcpy (resolution_count, saved_resolution_count, sizeof resolution_count);
+
+	for (i = 0; i <= threads; i++) {
+		struct render_band *rb = &render_bands[i];
+		if (i > 0)
+			uae_sem_wait (&rb->done);
+		if (rb->first_drawn < first_drawn_line)
+			first_drawn_line = rb->first_drawn;
+		if (rb->last_drawn > last_drawn_line)
+			last_drawn_line = rb->last_drawn;
+		lines_count += rb->lines_count;
+		for (j = 0; j <= RES_MAX; j++)
+			resolution_count[j] += rb->resolution_count[j];
+	}
+	drawing_color_matches = -1;
+
+	for (i = first_drawn_line; i <= last_drawn_line; i += gfxvidinfo.maxblocklines) {
+		int last = i + gfxvidinfo.maxblocklines - 1;
+		if (last > last_drawn_line)
+			last = last_drawn_line;
+		flush_block (i, last);
+	}
+	return true;
+}
+
+#endif
+
 bool draw_frame (struct vidbuffer *vb)
 {
 	uae_u8 oldstate[LINESTATE_SIZE];
@@ -3057,7 +3252,10 @@ void finish_drawing_frame (void)
 	return;
 #endif
 
-	draw_frame2 ();
+#ifdef RENDER_THREADS
+	if (!draw_frame_threaded ())
+#endif
+		draw_frame2 ();
 
 	if (currprefs.leds_on_screen) {
 		int slx, sly;
@@ -3297,8 +3495,7 @@ void hsync_record_line_state (int lineno, enum nln_how how, int changed)
 	}
 }
 
-// REMOVEME:
-#if 0
+/* Used by the benchmark mode, frames are drawn but never reach the screen */
 static void dummy_flush_line (struct vidbuf_description *gfxinfo, int line_no)
 {
 }
@@ -3315,25 +3512,28 @@ static void dummy_flush_clear_screen (struct vidbuf_description *gfxinfo)
 {
 }
 
-static int  dummy_lock (struct vidbuf_description *gfxinfo)
-{
-	return 1;
-}
-
-static void dummy_unlock (struct vidbuf_description *gfxinfo)
+void drawing_dummy_flush (bool enable)
 {
-}
+	static struct vidbuf_description saved;
+	static bool active;
 
-static void gfxbuffer_reset (void)
-{
-	gfxvidinfo.flush_line         = dummy_flush_line;
-	gfxvidinfo.flush_block        = dummy_flush_block;
-	gfxvidinfo.flush_screen       = dummy_flush_screen;
-	gfxvidinfo.flush_clear_screen = dummy_flush_clear_screen;
-	gfxvidinfo.lockscr            = dummy_lock;
-	gfxvidinfo.unlockscr          = dummy_unlock;
+	if (enable == active)
+		return;
+	active = enable;
+	if (enable) {
+		/* the backend still owns the buffer, only the flushes go */
+		saved = gfxvidinfo;
+		gfxvidinfo.flush_line         = dummy_flush_line;
+		gfxvidinfo.flush_block        = dummy_flush_block;
+		gfxvidinfo.flush_screen       = dummy_flush_screen;
+		gfxvidinfo.flush_clear_screen = dummy_flush_clear_screen;
+	} else {
+		gfxvidinfo.flush_line         = saved.flush_line;
+		gfxvidinfo.flush_block        = saved.flush_block;
+		gfxvidinfo.flush_screen       = saved.flush_screen;
+		gfxvidinfo.flush_clear_screen = saved.flush_clear_screen;
+	}
 }
-#endif
 
 void notice_resolution_seen (int res, bool lace)
 {
@@ -3397,9 +3597,19 @@ void reset_drawing (void)
 	specialmonitoron = false;
 }
 
+/* render threads are idle between frames, stop them on reset and exit */
+void drawing_free (void)
+{
+#ifdef RENDER_THREADS
+	render_threads_stop ();
+#endif
+}
+
 void drawing_init (void)
 {
+	drawing_free ();
 	gen_pfield_tables ();
+	p2c_simd_init (3);
 
 	uae_sem_init (&gui_sem, 0, 1);
 #ifdef PICASSO96
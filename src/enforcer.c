@@ -490,6 +490,8 @@ static void REGPARAM2 chipmem_lput2 (uaecptr addr, uae_u32 l)
 	if (ISEXEC (addr) || ISEXEC (addr + 1) || ISEXEC (addr + 2) || ISEXEC (addr + 3))
 		return;
 	do_put_mem_long (m, l);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 3);
 }
 
 static void REGPARAM2 chipmem_wput2 (uaecptr addr, uae_u32 w)
@@ -509,6 +511,8 @@ static void REGPARAM2 chipmem_wput2 (uaecptr addr, uae_u32 w)
 	if (ISEXEC (addr) || ISEXEC (addr + 1))
 		return;
 	do_put_mem_word (m, w);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 1);
 }
 
 static void REGPARAM2 chipmem_bput2 (uaecptr addr, uae_u32 b)
@@ -525,6 +529,7 @@ static void REGPARAM2 chipmem_bput2 (uaecptr addr, uae_u32 b)
 	if (ISEXEC (addr))
 		return;
 	chipmem_bank.baseaddr[addr] = b;
+	memory_dirty (&chipmem_bank, addr);
 }
 
 static int REGPARAM2 chipmem_check2 (uaecptr addr, uae_u32 size)
@@ -668,6 +673,7 @@ int enforcer_enable (int enfmode)
 		chipmem_bank.check = chipmem_check2;
 
 		enforcer_installed = 1;
+		memory_direct_refresh ();
 	}
 	write_log ("Enforcer enabled\n");
 	return 1;
@@ -695,6 +701,7 @@ int enforcer_disable (void)
 		chipmem_bank.check = saved_chipmem_check;
 
 		enforcer_installed = 0;
+		memory_direct_refresh ();
 	}
 	return 1;
 }
@@ -13,6 +13,7 @@
 
 #include "options.h"
 #include "events.h"
+#include "benchmark.h"
 
 unsigned long int event_cycles, nextevent, currcycle;
 int is_syncline, is_syncline_end;
@@ -76,6 +77,7 @@ void do_cycles_slow (unsigned long cycles_to_add)
 		cycles_to_add -= nextevent - currcycle;
 		currcycle = nextevent;
 
+		BENCH_ENTER (BENCH_EVENTS);
 		for (i = 0; i < ev_max; i++) {
 			if (eventtab[i].active && eventtab[i].evtime == currcycle) {
 				if (eventtab[i].handler == NULL) {
@@ -87,89 +89,249 @@ void do_cycles_slow (unsigned long cycles_to_add)
 			}
 		}
 		events_schedule ();
+		BENCH_LEAVE ();
+	}
+	currcycle += cycles_to_add;
+}
+
+/*
+ * event2's are kept in a binary min-heap ordered by evtime (ties in
+ * scheduling order), so the next one is always ev2_heap[0] and ev_misc
+ * is simply set to its time. The fixed eventtab2[] slots (blitter, disk)
+ * go in the same heap, anonymous events get a node from a free list that
+ * grows on demand.
+ */
+
+static struct ev2 **ev2_heap;
+static int ev2_heap_size;
+static struct ev2 *ev2_free;
+static uae_u32 ev2_seq;
+#define EV2_HASH_BITS 8
+static struct ev2 *ev2_hash[1 << EV2_HASH_BITS];
+
+/* Anonymous events are also hashed by evtime so that the "same event
+ * already queued?" check in event2_newevent_xx () is not a full scan. */
+static uae_u32 ev2_hashkey (evt t)
+{
+	return (uae_u32)((t / CYCLE_UNIT) * 2654435761u) >> (32 - EV2_HASH_BITS);
+}
+
+static void ev2_hash_add (struct ev2 *e)
+{
+	struct ev2 **head = &ev2_hash[ev2_hashkey (e->evtime)];
 
+	e->next = *head;
+	if (e->next)
+		e->next->prevp = &e->next;
+	e->prevp = head;
+	*head = e;
+}
+
+static void ev2_hash_del (struct ev2 *e)
+{
+	*e->prevp = e->next;
+	if (e->next)
+		e->next->prevp = e->prevp;
+}
+
+static bool ev2_find (evt et, uae_u32 data, evfunc2 func)
+{
+	struct ev2 *e;
 
+	for (e = ev2_hash[ev2_hashkey (et)]; e; e = e->next) {
+		if (e->evtime == et && e->handler == func && e->data == data)
+			return true;
+	}
+	return false;
+}
+
+STATIC_INLINE bool ev2_before (struct ev2 *a, struct ev2 *b)
+{
+	long d = (long)(a->evtime - b->evtime);
+	if (d)
+		return d < 0;
+	return (uae_s32)(a->seq - b->seq) < 0;
+}
+
+STATIC_INLINE void ev2_heap_set (int pos, struct ev2 *e)
+{
+	ev2_heap[pos] = e;
+	e->heap = pos;
+}
+
+static void ev2_sift_up (int pos)
+{
+	struct ev2 *e = ev2_heap[pos];
+
+	while (pos > 0) {
+		int parent = (pos - 1) / 2;
+		if (!ev2_before (e, ev2_heap[parent]))
+			break;
+		ev2_heap_set (pos, ev2_heap[parent]);
+		pos = parent;
+	}
+	ev2_heap_set (pos, e);
+}
+
+static void ev2_sift_down (int pos)
+{
+	struct ev2 *e = ev2_heap[pos];
+
+	for (;;) {
+		int child = pos * 2 + 1;
+		if (child >= event2_count)
+			break;
+		if (child + 1 < event2_count && ev2_before (ev2_heap[child + 1], ev2_heap[child]))
+			child++;
+		if (!ev2_before (ev2_heap[child], e))
+			break;
+		ev2_heap_set (pos, ev2_heap[child]);
+		pos = child;
+	}
+	ev2_heap_set (pos, e);
+}
+
+static void ev2_insert (struct ev2 *e)
+{
+	if (event2_count == ev2_heap_size) {
+		ev2_heap_size = ev2_heap_size ? ev2_heap_size * 2 : 32;
+		ev2_heap = xrealloc (struct ev2*, ev2_heap, ev2_heap_size);
+	}
+	e->active = true;
+	e->seq = ev2_seq++;
+	ev2_heap_set (event2_count++, e);
+	ev2_sift_up (e->heap);
+}
+
+static void ev2_remove (struct ev2 *e)
+{
+	int pos = e->heap;
+
+	e->active = false;
+	event2_count--;
+	if (pos != event2_count) {
+		ev2_heap_set (pos, ev2_heap[event2_count]);
+		if (pos > 0 && ev2_before (ev2_heap[pos], ev2_heap[(pos - 1) / 2]))
+			ev2_sift_up (pos);
+		else
+			ev2_sift_down (pos);
+	}
+	/* anonymous node, back to the free list */
+	if (e < eventtab2 || e >= eventtab2 + ev2_max) {
+		ev2_hash_del (e);
+		e->handler = NULL;
+		e->next = ev2_free;
+		ev2_free = e;
 	}
-	currcycle += cycles_to_add;
+}
+
+static struct ev2 *ev2_alloc (void)
+{
+	struct ev2 *e = ev2_free;
+
+	if (e) {
+		ev2_free = e->next;
+	} else {
+		e = xcalloc (struct ev2, 1);
+	}
+	return e;
+}
+
+/* point ev_misc at the first pending event2 */
+static void ev2_schedule (void)
+{
+	if (event2_count) {
+		eventtab[ev_misc].active = true;
+		eventtab[ev_misc].oldcycles = get_cycles ();
+		eventtab[ev_misc].evtime = ev2_heap[0]->evtime;
+	} else {
+		eventtab[ev_misc].active = false;
+	}
+	events_schedule ();
 }
 
 void MISC_handler (void)
 {
-	static bool dorecheck;
-	bool recheck;
-	int i;
-	evt mintime;
-	evt ct = get_cycles ();
 	static int recursive;
+	evt ct = get_cycles ();
 
-	if (recursive) {
-		dorecheck = true;
+	/* event2_newevent_xx () from a handler, the loop below picks it up */
+	if (recursive)
 		return;
-	}
 	recursive++;
-	eventtab[ev_misc].active = 0;
-	recheck = true;
-	while (recheck) {
-		recheck = false;
-		mintime = ~0L;
-		for (i = 0; i < ev2_max; i++) {
-			if (eventtab2[i].active) {
-				if (eventtab2[i].evtime == ct) {
-					eventtab2[i].active = false;
-					event2_count--;
-					eventtab2[i].handler (eventtab2[i].data);
-					if (dorecheck || eventtab2[i].active) {
-						recheck = true;
-						dorecheck = false;
-					}
-				} else {
-					evt eventtime = eventtab2[i].evtime - ct;
-					if (eventtime < mintime)
-						mintime = eventtime;
-				}
-			}
-		}
-	}
-	if (mintime != ~0UL) {
-		eventtab[ev_misc].active = true;
-		eventtab[ev_misc].oldcycles = ct;
-		eventtab[ev_misc].evtime = ct + mintime;
-		events_schedule ();
+	while (event2_count && (long)(ev2_heap[0]->evtime - ct) <= 0) {
+		struct ev2 *e = ev2_heap[0];
+		evfunc2 handler = e->handler;
+		uae_u32 data = e->data;
+
+		ev2_remove (e);
+		handler (data);
 	}
+	ev2_schedule ();
 	recursive--;
 }
 
-
 void event2_newevent_xx (int no, evt t, uae_u32 data, evfunc2 func)
 {
-	evt et;
-	static int next = ev2_misc;
+	evt et = t + get_cycles ();
+	struct ev2 *e;
 
-	et = t + get_cycles ();
 	if (no < 0) {
-		no = next;
-		for (;;) {
-			if (!eventtab2[no].active) {
-				event2_count++;
-				break;
-			}
-			if (eventtab2[no].evtime == et && eventtab2[no].handler == func && eventtab2[no].data == data)
-				break;
-			no++;
-			if (no == ev2_max)
-				no = ev2_misc;
-			if (no == next) {
-				write_log (_T("out of event2's!\n"));
-				return;
-			}
-		}
-		next = no;
+		if (ev2_find (et, data, func))
+			return;
+		e = ev2_alloc ();
+	} else {
+		e = &eventtab2[no];
+		if (e->active)
+			ev2_remove (e);
 	}
-	eventtab2[no].active = true;
-	eventtab2[no].evtime = et;
-	eventtab2[no].handler = func;
-	eventtab2[no].data = data;
-	MISC_handler ();
+	e->evtime = et;
+	e->handler = func;
+	e->data = data;
+	if (no < 0)
+		ev2_hash_add (e);
+	ev2_insert (e);
+	if ((long)(et - get_cycles ()) <= 0)
+		MISC_handler ();
+	else if (ev2_heap[0] == e)
+		ev2_schedule ();
+}
+
+void event2_remevent (int no)
+{
+	if (eventtab2[no].active) {
+		ev2_remove (&eventtab2[no]);
+		ev2_schedule ();
+	}
+}
+
+/* Drops all pending event2's, the fixed eventtab2[] handlers stay */
+void event2_reset (void)
+{
+	while (event2_count)
+		ev2_remove (ev2_heap[0]);
+	ev2_seq = 0;
+}
+
+/* Runs every pending event2 now, in time order (savestates) */
+void event2_flush (void)
+{
+	int n = event2_count;
+
+	while (n-- > 0 && event2_count) {
+		struct ev2 *e = ev2_heap[0];
+		evfunc2 handler = e->handler;
+		uae_u32 data = e->data;
+
+		ev2_remove (e);
+		handler (data);
+	}
+}
+
+/* i'th pending event2, in no particular order */
+struct ev2 *event2_get (int i)
+{
+	return i < event2_count ? ev2_heap[i] : NULL;
 }
 
 int current_hpos (void)
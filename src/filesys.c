@@ -1073,11 +1073,20 @@ typedef struct notify {
 	TCHAR *partname;
 } Notify;
 
+/* Names and stat data of a whole host directory, read in one pass
+ * when ExAll starts so that later rounds don't touch the host again.  */
+typedef struct dirsnap {
+	int count, next;
+	TCHAR **names;
+	struct mystat *stats;
+} DirSnap;
+
 typedef struct exallkey {
 	uae_u32 id;
 	struct fs_dirhandle *dirhandle;
 	TCHAR *fn;
 	uaecptr control;
+	DirSnap *snap;
 } ExAllKey;
 
 /* Since ACTION_EXAMINE_NEXT is so braindamaged, we have to keep
@@ -1366,7 +1375,7 @@ static void fs_closedir (struct fs_dirhandle *fsd)
 }
 static struct fs_filehandle *fs_openfile (Unit *u, a_inode *aino, int flags)
 {
-	struct fs_filehandle *fsf = xmalloc (struct fs_filehandle, 1);
+	struct fs_filehandle *fsf = xcalloc (struct fs_filehandle, 1);
 	fsf->fstype = (u->volflags & MYVOLUMEINFO_ARCHIVE) ? FS_ARCHIVE : ((u->volflags & MYVOLUMEINFO_CDFS) ? FS_CDFS : FS_DIRECTORY);
 	if (fsf->fstype == FS_ARCHIVE) {
 		fsf->zf = zfile_open_archive (aino->nname, flags);
@@ -1395,22 +1404,37 @@ static void fs_closefile (struct fs_filehandle *fsf)
 	/*} else if (fsf->fstype == FS_CDFS) {
 		isofs_closefile (fsf->isof);*/
 	}
+	xfree (fsf->rabuf);
 	xfree (fsf);
 }
+/* fs_pread () leaves the host file position alone, everything else
+ * expects it to be where the last read ended.  */
+static void fs_syncpos (struct fs_filehandle *fsf)
+{
+	if (fsf->hostpos_pending) {
+		fsf->hostpos_pending = false;
+		my_lseek (fsf->of, fsf->hostpos, SEEK_SET);
+	}
+}
 static unsigned int fs_read (struct fs_filehandle *fsf, void *b, unsigned int size)
 {
 	if (fsf->fstype == FS_ARCHIVE)
 		return zfile_read_archive (fsf->zf, b, size);
-	else if (fsf->fstype == FS_DIRECTORY)
+	else if (fsf->fstype == FS_DIRECTORY) {
+		fs_syncpos (fsf);
 		return my_read (fsf->of, b, size);
+	}
 /*	else if (fsf->fstype == FS_CDFS)
 		return isofs_read (fsf->isof, b, size);*/
 	return 0;
 }
 static unsigned int fs_write (struct fs_filehandle *fsf, void *b, unsigned int size)
 {
-	if (fsf->fstype == FS_DIRECTORY)
+	if (fsf->fstype == FS_DIRECTORY) {
+		fs_syncpos (fsf);
+		fsf->ralen = 0;
 		return my_write (fsf->of, b, size);
+	}
 	return 0;
 }
 
@@ -1419,8 +1443,10 @@ static uae_s64 fs_lseek64 (struct fs_filehandle *fsf, uae_s64 offset, int whence
 {
 	if (fsf->fstype == FS_ARCHIVE)
 		return zfile_lseek_archive (fsf->zf, offset, whence);
-	else if (fsf->fstype == FS_DIRECTORY)
+	else if (fsf->fstype == FS_DIRECTORY) {
+		fs_syncpos (fsf);
 		return my_lseek (fsf->of, offset, whence);
+	}
 /*	else if (fsf->fstype == FS_CDFS)
 		return isofs_lseek (fsf->isof, offset, whence);*/
 	return -1;
@@ -1436,8 +1462,10 @@ static uae_s64 fs_fsize64 (struct fs_filehandle *fsf)
 {
 	if (fsf->fstype == FS_ARCHIVE)
 		return zfile_fsize_archive (fsf->zf);
-	else if (fsf->fstype == FS_DIRECTORY)
+	else if (fsf->fstype == FS_DIRECTORY) {
+		fs_syncpos (fsf);
 		return my_fsize (fsf->of);
+	}
 /*	else if (fsf->fstype == FS_CDFS)
 		return isofs_fsize (fsf->isof);*/
 	return -1;
@@ -1446,6 +1474,66 @@ static uae_u32 fs_fsize (struct fs_filehandle *fsf)
 {
 	return (uae_u32)fs_fsize64 (fsf);
 }
+/* Read SIZE bytes at POS.  On directory mounts, a small read that
+ * continues where the previous one ended fills a FS_READAHEAD buffer
+ * with one host call and later reads are copied from it, instead of
+ * costing a seek and a read each.  */
+#define FS_READAHEAD 65536
+static int fs_pread (struct fs_filehandle *fsf, uae_u8 *b, unsigned int size, uae_s64 pos)
+{
+	unsigned int done = 0;
+	int got;
+
+	if (fsf->fstype != FS_DIRECTORY) {
+		if (fs_lseek64 (fsf, pos, SEEK_SET) < 0)
+			return -1;
+		return fs_read (fsf, b, size);
+	}
+	if (pos >= fsf->rapos && pos < fsf->rapos + fsf->ralen) {
+		done = (unsigned int)(fsf->rapos + fsf->ralen - pos);
+		if (done > size)
+			done = size;
+		memcpy (b, fsf->rabuf + (pos - fsf->rapos), done);
+		b += done;
+		pos += done;
+		size -= done;
+		fsf->ranext = pos;
+	}
+	if (size == 0) {
+		got = 0;
+	} else if (pos == fsf->ranext && size < FS_READAHEAD / 2) {
+		if (!fsf->rabuf)
+			fsf->rabuf = xmalloc (uae_u8, FS_READAHEAD);
+		fsf->ralen = 0;
+		got = my_pread (fsf->of, fsf->rabuf, FS_READAHEAD, pos);
+		if (got > 0) {
+			fsf->rapos = pos;
+			fsf->ralen = got;
+			if ((unsigned int)got > size)
+				got = size;
+			memcpy (b, fsf->rabuf, got);
+		}
+	} else {
+		got = my_pread (fsf->of, b, size, pos);
+	}
+	if (got < 0)
+		return done ? (int)done : -1;
+	fsf->ranext = pos + got;
+	fsf->hostpos = pos + got;
+	fsf->hostpos_pending = true;
+	return done + got;
+}
+
+/* Some handle wrote to AINO, forget what the others have read ahead.  */
+static void fs_readahead_drop (Unit *unit, a_inode *aino)
+{
+	Key *k;
+
+	for (k = unit->keys; k; k = k->next) {
+		if (k->aino == aino && k->fd)
+			k->fd->ralen = 0;
+	}
+}
 
 #ifdef SCSI
 static void set_highcyl (UnitInfo *ui, uae_u32 blocks)
@@ -1476,6 +1564,7 @@ static void set_volume_name (Unit *unit, struct mytimeval *tv)
 		put_long (unit->volume + 24, ticks);
 	}
 	xfree (s);
+	fsdb_dir_free (&unit->rootnode);
 	unit->rootnode.aname = unit->ui.volname;
 	unit->rootnode.nname = unit->ui.rootdir;
 	unit->rootnode.mountcount = unit->mountcount;
@@ -1488,6 +1577,30 @@ static int filesys_isvolume (Unit *unit)
 	return get_byte (unit->volume + 44) || unit->ui.unknown_media;
 }
 
+
+static void free_dirsnap (DirSnap *snap)
+{
+	int i;
+
+	if (!snap)
+		return;
+	for (i = 0; i < snap->count; i++)
+		xfree (snap->names[i]);
+	xfree (snap->names);
+	xfree (snap->stats);
+	xfree (snap);
+}
+
+static void free_exall (ExAllKey *eak)
+{
+	eak->id = 0;
+	fs_closedir (eak->dirhandle);
+	eak->dirhandle = NULL;
+	xfree (eak->fn);
+	eak->fn = NULL;
+	free_dirsnap (eak->snap);
+	eak->snap = NULL;
+}
 static void clear_exkeys (Unit *unit)
 {
 	int i;
@@ -1497,13 +1610,8 @@ static void clear_exkeys (Unit *unit)
 		unit->examine_keys[i].curr_file = 0;
 		unit->examine_keys[i].uniq = 0;
 	}
-	for (i = 0; i < EXALLKEYS; i++) {
-		fs_closedir (unit->exalls[i].dirhandle);
-		unit->exalls[i].dirhandle = NULL;
-		xfree (unit->exalls[i].fn);
-		unit->exalls[i].fn = NULL;
-		unit->exalls[i].id = 0;
-	}
+	for (i = 0; i < EXALLKEYS; i++)
+		free_exall (&unit->exalls[i]);
 	unit->exallid = 0;
 	unit->next_exkey = 1;
 	a = &unit->rootnode;
@@ -1986,6 +2094,94 @@ static void de_recycle_aino (Unit *unit, a_inode *aino)
 	unit->aino_cache_size--;
 }
 
+/* Children of a directory, hashed on the last component of their aname
+ * (case-insensitive) and of their nname.  Only the name is hashed, so
+ * the table can move with the children when a directory is renamed.  */
+struct aino_childhash {
+	int size, count;
+	a_inode **abucket, **nbucket;
+};
+
+static const TCHAR *aino_lastname (const TCHAR *name, TCHAR sep)
+{
+	const TCHAR *p = _tcsrchr (name, sep);
+	return p ? p + 1 : name;
+}
+
+static void childhash_link (struct aino_childhash *h, a_inode *aino)
+{
+	a_inode **a = &h->abucket[fsdb_name_hash (aino_lastname (aino->aname, '/'), 1) & (h->size - 1)];
+	a_inode **n = &h->nbucket[fsdb_name_hash (aino_lastname (aino->nname, FSDB_DIR_SEPARATOR), 0) & (h->size - 1)];
+
+	aino->ahash_next = *a;
+	*a = aino;
+	aino->nhash_next = *n;
+	*n = aino;
+}
+
+static void childhash_resize (a_inode *dir, int size)
+{
+	struct aino_childhash *h = dir->childhash;
+	a_inode *c;
+
+	xfree (h->abucket);
+	xfree (h->nbucket);
+	h->size = size;
+	h->abucket = xcalloc (a_inode*, size);
+	h->nbucket = xcalloc (a_inode*, size);
+	for (c = dir->child; c; c = c->sibling)
+		childhash_link (h, c);
+}
+
+static void childhash_free (a_inode *dir)
+{
+	struct aino_childhash *h = dir->childhash;
+
+	if (!h)
+		return;
+	xfree (h->abucket);
+	xfree (h->nbucket);
+	xfree (h);
+	dir->childhash = 0;
+}
+
+/* AINO must already be on the parent's child list.  */
+static void childhash_add (a_inode *aino)
+{
+	a_inode *dir = aino->parent;
+	struct aino_childhash *h = dir->childhash;
+
+	if (!h) {
+		h = dir->childhash = xcalloc (struct aino_childhash, 1);
+		h->count = 1;
+		childhash_resize (dir, 16);
+		return;
+	}
+	h->count++;
+	if (h->count > h->size * 2)
+		childhash_resize (dir, h->size * 4);
+	else
+		childhash_link (h, aino);
+}
+
+static void childhash_remove (a_inode *aino)
+{
+	a_inode *dir = aino->parent;
+	struct aino_childhash *h = dir ? dir->childhash : 0;
+	a_inode **p;
+
+	if (!h)
+		return;
+	for (p = &h->abucket[fsdb_name_hash (aino_lastname (aino->aname, '/'), 1) & (h->size - 1)]; *p && *p != aino; p = &(*p)->ahash_next);
+	if (*p == 0)
+		return;
+	*p = aino->ahash_next;
+	for (p = &h->nbucket[fsdb_name_hash (aino_lastname (aino->nname, FSDB_DIR_SEPARATOR), 0) & (h->size - 1)]; *p != aino; p = &(*p)->nhash_next);
+	*p = aino->nhash_next;
+	if (--h->count == 0)
+		childhash_free (dir);
+}
+
 static void dispose_aino (Unit *unit, a_inode **aip, a_inode *aino)
 {
 	int hash = aino->uniq % MAX_AINO_HASH;
@@ -1995,6 +2191,7 @@ static void dispose_aino (Unit *unit, a_inode **aip, a_inode *aino)
 	if (aino->dirty && aino->parent)
 		fsdb_dir_writeback (aino->parent);
 
+	childhash_remove (aino);
 	*aip = aino->sibling;
 
 	if (unit->volflags & MYVOLUMEINFO_ARCHIVE) {
@@ -2006,6 +2203,8 @@ static void dispose_aino (Unit *unit, a_inode **aip, a_inode *aino)
 	}
 #endif
 
+	childhash_free (aino);
+	fsdb_dir_free (aino);
 	xfree (aino->aname);
 	xfree (aino->comment);
 	xfree (aino->nname);
@@ -2019,6 +2218,7 @@ static void free_all_ainos (Unit *u, a_inode *parent)
 		free_all_ainos (u, a);
 		dispose_aino (u, &parent->child, a);
 	}
+	fsdb_dir_free (parent);
 }
 
 static int flush_cache (Unit *unit, int num)
@@ -2150,6 +2350,9 @@ static void move_aino_children (Unit *unit, a_inode *from, a_inode *to)
 	aino_test (to);
 	to->child = from->child;
 	from->child = 0;
+	childhash_free (to);
+	to->childhash = from->childhash;
+	from->childhash = 0;
 	update_child_names (unit, to->child, to);
 }
 
@@ -2420,6 +2623,7 @@ static void init_child_aino_tree (Unit *unit, a_inode *base, a_inode *aino)
 	aino->child = 0;
 	aino->sibling = base->child;
 	base->child = aino;
+	childhash_add (aino);
 	aino->next = aino->prev = 0;
 	aino->volflags = unit->volflags;
 }
@@ -2520,7 +2724,8 @@ static a_inode *create_child_aino (Unit *unit, a_inode *base, TCHAR *rel, int is
 
 static a_inode *lookup_child_aino (Unit *unit, a_inode *base, TCHAR *rel, int *err)
 {
-	a_inode *c = base->child;
+	struct aino_childhash *h = base->childhash;
+	a_inode *c = h ? h->abucket[fsdb_name_hash (rel, 1) & (h->size - 1)] : 0;
 	int l0 = _tcslen (rel);
 
 	aino_test (base);
@@ -2538,7 +2743,7 @@ static a_inode *lookup_child_aino (Unit *unit, a_inode *base, TCHAR *rel, int *e
 			&& ( (l0 == l1) || (c->aname[l1-l0-1] == '/') )
 			&& c->mountcount == unit->mountcount)
 			break;
-		c = c->sibling;
+		c = c->ahash_next;
 	}
 	if (c != 0)
 		return c;
@@ -2551,7 +2756,8 @@ static a_inode *lookup_child_aino (Unit *unit, a_inode *base, TCHAR *rel, int *e
 /* Different version because for this one, REL is an nname.  */
 static a_inode *lookup_child_aino_for_exnext (Unit *unit, a_inode *base, TCHAR *rel, uae_u32 *err, uae_u64 uniq_external)
 {
-	a_inode *c = base->child;
+	struct aino_childhash *h = base->childhash;
+	a_inode *c = h ? h->nbucket[fsdb_name_hash (rel, 0) & (h->size - 1)] : 0;
 	int l0 = _tcslen (rel);
 	int isvirtual = unit->volflags & (MYVOLUMEINFO_ARCHIVE | MYVOLUMEINFO_CDFS);
 
@@ -2565,7 +2771,7 @@ static a_inode *lookup_child_aino_for_exnext (Unit *unit, a_inode *base, TCHAR *
 		if (l0 <= l1 && _tcscmp (rel, c->nname + l1 - l0) == 0
 			&& (l0 == l1 || c->nname[l1-l0-1] == FSDB_DIR_SEPARATOR) && c->mountcount == unit->mountcount)
 			break;
-		c = c->sibling;
+		c = c->nhash_next;
 	}
 	if (c != 0)
 		return c;
@@ -4064,9 +4270,10 @@ static ExAllKey *getexall (Unit *unit, uaecptr control, uae_u32 id)
 	return NULL;
 }
 
-static int exalldo (uaecptr exalldata, uae_u32 exalldatasize, uae_u32 type, uaecptr control, Unit *unit, a_inode *aino)
+/* Append AINO at *EXPP, using STATP if the caller already has it.  */
+static int exalldo (uaecptr exalldata, uae_u32 exalldatasize, uae_u32 type, uaecptr control, Unit *unit, a_inode *aino, uaecptr *expp, const struct mystat *statp)
 {
-	uaecptr exp = exalldata;
+	uaecptr exp = *expp;
 	int i;
 	uae_u32 size, size2;
 	int entrytype;
@@ -4080,7 +4287,9 @@ static int exalldo (uaecptr exalldata, uae_u32 exalldatasize, uae_u32 type, uaec
 	int ret = 0;
 
 	memset (&statbuf, 0, sizeof statbuf);
-	if (unit->volflags & MYVOLUMEINFO_ARCHIVE)
+	if (statp)
+		statbuf = *statp;
+	else if (unit->volflags & MYVOLUMEINFO_ARCHIVE)
 		zfile_stat_archive (aino->nname, &statbuf);
 /*	else if (unit->volflags & MYVOLUMEINFO_CDFS)
 		isofs_stat (unit->ui.cdfs_superblock, aino->uniq_external, &statbuf);*/
@@ -4134,12 +4343,6 @@ static int exalldo (uaecptr exalldata, uae_u32 exalldatasize, uae_u32 type, uaec
 		size2 += 8;
 	}
 
-	i = get_long (control + 0);
-	while (i > 0) {
-		exp = get_long (exp); /* ed_Next */
-		i--;
-	}
-
 	if (exalldata + exalldatasize - exp < size + size2)
 		goto end; /* not enough space */
 
@@ -4185,6 +4388,7 @@ static int exalldo (uaecptr exalldata, uae_u32 exalldatasize, uae_u32 type, uaec
 	}
 
 	put_long (control + 0, get_long (control + 0) + 1);
+	*expp = get_long (exp);
 	ret = 1;
 end:
 	if (x)
@@ -4199,46 +4403,82 @@ static bool filesys_name_invalid (const TCHAR *fn)
 	return _tcslen (fn) > currprefs.filesys_max_name;
 }
 
+static DirSnap *exall_snapshot (struct fs_dirhandle *d)
+{
+	DirSnap *snap = xcalloc (DirSnap, 1);
+	struct dirent *ok;
+	int alloc = 0;
+
+	while ((ok = readdir (d->od))) {
+		if (filesys_name_invalid (ok->d_name) || fsdb_name_invalid (ok->d_name))
+			continue;
+		if (snap->count == alloc) {
+			alloc = alloc ? alloc * 2 : 64;
+			snap->names = xrealloc (TCHAR*, snap->names, alloc);
+			snap->stats = xrealloc (struct mystat, snap->stats, alloc);
+		}
+		memset (&snap->stats[snap->count], 0, sizeof (struct mystat));
+		my_statat (d->od, ok->d_name, &snap->stats[snap->count]);
+		snap->names[snap->count++] = my_strdup (ok->d_name);
+	}
+	return snap;
+}
+
 static int action_examine_all_do (Unit *unit, uaecptr lock, ExAllKey *eak, uaecptr exalldata, uae_u32 exalldatasize, uae_u32 type, uaecptr control)
 {
 	a_inode *aino, *base = NULL;
-	struct dirent *ok = NULL;
+	int ok;
 	uae_u32 err;
 	struct fs_dirhandle *d;
 	TCHAR fn[MAX_DPATH];
+	uaecptr exp = exalldata;
 
 	if (lock != 0)
 		base = aino_from_lock (unit, lock);
 	if (base == 0)
 		base = &unit->rootnode;
+	d = eak->dirhandle;
+	if (!eak->snap && d && d->fstype == FS_DIRECTORY) {
+		eak->snap = exall_snapshot (d);
+		fs_closedir (d);
+		eak->dirhandle = NULL;
+	}
+	if (eak->snap) {
+		DirSnap *snap = eak->snap;
+		for (; snap->next < snap->count; snap->next++) {
+			aino = lookup_child_aino_for_exnext (unit, base, snap->names[snap->next], &err, 0);
+			if (!aino)
+				return 0;
+			eak->id = unit->exallid++;
+			put_long (control + 4, eak->id);
+			if (!exalldo (exalldata, exalldatasize, type, control, unit, aino, &exp, &snap->stats[snap->next]))
+				return 1; /* no space in exallstruct, continue from this entry */
+		}
+		return 0;
+	}
 	for (;;) {
 		uae_u64 uniq = 0;
-		d = eak->dirhandle;
 		if (!eak->fn) {
-			do {
-				if (d->fstype == FS_ARCHIVE)
-					/*fixme*/ ok = zfile_readdir_archive (d->zd, fn);
-				else if (d->fstype == FS_DIRECTORY)
-					/*fixme*/ ok = readdir (d->od);
-				/*else if (d->fstype == FS_CDFS)
-					ok = isofs_readdir (d->isod, fn, &uniq);*/
-				else
-					ok = 0;
-			} while (ok && d->fstype == FS_DIRECTORY && (filesys_name_invalid (ok->d_name) || fsdb_name_invalid (ok->d_name)));
+			if (d && d->fstype == FS_ARCHIVE)
+				ok = zfile_readdir_archive (d->zd, fn);
+			/*else if (d && d->fstype == FS_CDFS)
+				ok = isofs_readdir (d->isod, fn, &uniq);*/
+			else
+				ok = 0;
 			if (!ok)
 				return 0;
 		} else {
-			_tcscpy (ok->d_name, eak->fn);
+			_tcscpy (fn, eak->fn);
 			xfree (eak->fn);
 			eak->fn = NULL;
 		}
-		aino = lookup_child_aino_for_exnext (unit, base, ok->d_name, &err, uniq);
+		aino = lookup_child_aino_for_exnext (unit, base, fn, &err, uniq);
 		if (!aino)
 			return 0;
 		eak->id = unit->exallid++;
 		put_long (control + 4, eak->id);
-		if (!exalldo (exalldata, exalldatasize, type, control, unit, aino)) {
-			eak->fn = my_strdup (ok->d_name); /* no space in exallstruct, save current entry */
+		if (!exalldo (exalldata, exalldatasize, type, control, unit, aino, &exp, NULL)) {
+			eak->fn = my_strdup (fn); /* no space in exallstruct, save current entry */
 			break;
 		}
 	}
@@ -4263,11 +4503,7 @@ static int action_examine_all_end (Unit *unit, dpacket packet)
 		write_log (_T("FILESYS: EXALL_END non-existing ID %d\n"), id);
 		doserr = ERROR_OBJECT_WRONG_TYPE;
 	} else {
-		eak->id = 0;
-		fs_closedir (eak->dirhandle);
-		xfree (eak->fn);
-		eak->fn = NULL;
-		eak->dirhandle = NULL;
+		free_exall (eak);
 	}
 	if (doserr) {
 		PUT_PCK_RES1 (packet, DOS_FALSE);
@@ -4382,13 +4618,8 @@ fail:
 	if (!ok) {
 		PUT_PCK_RES1 (packet, DOS_FALSE);
 		PUT_PCK_RES2 (packet, doserr);
-		if (eak) {
-			eak->id = 0;
-			fs_closedir (eak->dirhandle);
-			eak->dirhandle = NULL;
-			xfree (eak->fn);
-			eak->fn = NULL;
-		}
+		if (eak)
+			free_exall (eak);
 		if (doserr == ERROR_NO_MORE_ENTRIES)
 			put_long (control + 4, EXALL_END);
 	}
@@ -4886,12 +5117,6 @@ static void
 			write_log (_T("unixfs warning: Bad pointer passed for read: %08x, size %d\n"), addr, size);
 			/* ugh this is inefficient but easy */
 
-			if (fs_lseek64 (k->fd, k->file_pos, SEEK_SET) < 0) {
-				PUT_PCK_RES1 (packet, 0);
-				PUT_PCK_RES2 (packet, dos_errno ());
-				return;
-			}
-
 			buf = xmalloc (uae_u8, size);
 			if (!buf) {
 				PUT_PCK_RES1 (packet, -1);
@@ -4899,7 +5124,7 @@ static void
 				return;
 			}
 
-			actual = fs_read (k->fd, buf, size);
+			actual = fs_pread (k->fd, buf, size, k->file_pos);
 
 			if ((uae_s32)actual == -1) {
 				PUT_PCK_RES1 (packet, 0);
@@ -4920,13 +5145,7 @@ static void
 		/* normal fast read */
 		uae_u8 *realpt = get_real_address (addr);
 
-		if (fs_lseek64 (k->fd, k->file_pos, SEEK_SET) < 0) {
-			PUT_PCK_RES1 (packet, 0);
-			PUT_PCK_RES2 (packet, dos_errno ());
-			return;
-		}
-
-		actual = fs_read (k->fd, realpt, size);
+		actual = fs_pread (k->fd, realpt, size, k->file_pos);
 
 		if (actual == 0) {
 			PUT_PCK_RES1 (packet, 0);
@@ -4937,6 +5156,7 @@ static void
 		} else {
 			PUT_PCK_RES1 (packet, actual);
 			k->file_pos += actual;
+			memory_dirty_address (addr, actual);
 		}
 		flush_dcache (addr, size);
 	}
@@ -5013,6 +5233,7 @@ static void
 		PUT_PCK_RES2 (packet, dos_errno ());
 	if ((uae_s32)actual != -1)
 		k->file_pos += actual;
+	fs_readahead_drop (unit, k->aino);
 
 	k->notifyactive = 1;
 }
@@ -5433,6 +5654,7 @@ static void
 	 * The write is supposed to guarantee that the file can't be smaller than
 	 * the requested size, the truncate guarantees that it can't be larger.
 	 * If we were to write one byte earlier we'd clobber file data.  */
+	fs_readahead_drop (unit, k->aino);
 	if (my_truncate (k->aino->nname, offset) == -1) {
 		PUT_PCK_RES1 (packet, DOS_TRUE);
 		PUT_PCK_RES2 (packet, dos_errno ());
@@ -5902,6 +6124,7 @@ static void action_change_file_size64 (Unit *unit, dpacket packet)
 		k->file_pos = offset;
 	fs_lseek64 (k->fd, k->file_pos, SEEK_SET);
 
+	fs_readahead_drop (unit, k->aino);
 	if (my_truncate (k->aino->nname, offset) == -1) {
 		PUT_PCK64_RES1 (packet, DOS_FALSE);
 		PUT_PCK64_RES2 (packet, dos_errno ());
@@ -5998,6 +6221,7 @@ static void action_set_file_size64(Unit *unit, dpacket packet)
 		k->file_pos = offset;
 	fs_lseek64 (k->fd, k->file_pos, SEEK_SET);
 
+	fs_readahead_drop (unit, k->aino);
 	if (my_truncate (k->aino->nname, offset) == -1) {
 		PUT_PCK_RES1 (packet, DOS_FALSE);
 		PUT_PCK_RES2 (packet, dos_errno ());
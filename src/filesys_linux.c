@@ -63,26 +63,29 @@ typedef struct {
 	LONGLONG QuadPart;
 } LARGE_INTEGER;
 
+static void my_stat_fill (uae_s64 size, mode_t mode, struct mystat *statbuf)
+{
+	statbuf->size = size;
+
+	if (mode & (S_IWGRP | S_IWOTH)) {
+		statbuf->mode = FILEFLAG_READ | FILEFLAG_WRITE;
+	} else {
+		statbuf->mode = FILEFLAG_READ;
+	}
+
+//S_IFREG: regular file
+	if ((mode & S_IFMT) == S_IFDIR) {
+		statbuf->mode |= FILEFLAG_DIR;
+	}
+}
+
 // fsdb_mywin32
 bool my_stat (const TCHAR *name, struct mystat *statbuf)
 {
 	struct _stat64 st;
-	uae_s64 foo_size;
 
 	if (stat (name, &st) != -1) {
-		foo_size = st.st_size;
-		statbuf->size = foo_size;
-
-		if (st.st_mode & (S_IWGRP | S_IWOTH)) {
-			statbuf->mode = FILEFLAG_READ | FILEFLAG_WRITE;
-		} else {
-			statbuf->mode = FILEFLAG_READ;
-		}
-
-//S_IFREG: regular file
-		if ((st.st_mode & S_IFMT) == S_IFDIR) {
-			statbuf->mode |= FILEFLAG_DIR;
-		}
+		my_stat_fill (st.st_size, st.st_mode, statbuf);
 
 /*		statbuf->mode = st->st_mode;
 		uae_u64 t = (*(uae_s64 *)&st->st_mtime-((uae_s64)(369*365+89)*(uae_s64)(24*60*60)*(uae_s64)10000000));
@@ -93,6 +96,18 @@ bool my_stat (const TCHAR *name, struct mystat *statbuf)
 	return false;
 }
 
+/* my_stat () of an entry in a directory opened with my_opendir (),
+ * without resolving the full path again.  */
+bool my_statat (struct my_opendir_s *mod, const TCHAR *name, struct mystat *statbuf)
+{
+	struct stat st;
+
+	if (fstatat (dirfd ((DIR*)mod), name, &st, 0) == -1)
+		return false;
+	my_stat_fill (st.st_size, st.st_mode, statbuf);
+	return true;
+}
+
 static int setfiletime (const TCHAR *name, int days, int minute, int tick, int tolocal)
 {
 //FIXME
@@ -586,6 +601,10 @@ int my_read (struct my_openfile_s *mos, void *b, unsigned int size) {
 	return bytesRead;
 }
 
+int my_pread (struct my_openfile_s *mos, void *b, unsigned int size, uae_s64 offset) {
+	return pread (mos->h, b, size, offset);
+}
+
 int my_write (struct my_openfile_s *mos, void *b, unsigned int size) {
 //        DWORD written = 0;
 //        WriteFile (mos->h, b, size, &written, NULL);
@@ -28,6 +28,7 @@
 #include "cpummu.h"
 #include "cpummu030.h"
 #include "debug.h"
+#include "fpp-fast.h"
 
 #define DEBUG_FPP 0
 #define EXCEPTION_FPP 1
@@ -126,17 +127,27 @@ static bool fpu_mmu_fixup;
 #define FFLAG_N	    0x0100
 #define FFLAG_NAN   0x0400
 
+/* fpu_fast: the host exception flags are not read back, only a NaN
+ * result is reported (as OPERR). Reading and clearing them costs far
+ * more than the operation itself. Condition codes are always exact. */
 STATIC_INLINE void MAKE_FPSR (fptype *fp)
 {
-	int status = fetestexcept (FE_ALL_EXCEPT);
-	if (status)
-		regs.fp_result_status |= status;
+	if (!currprefs.fpu_fast) {
+		int status = fetestexcept (FE_ALL_EXCEPT);
+		if (status)
+			regs.fp_result_status |= status;
+	} else if (*fp != *fp) {
+#ifdef FE_INVALID
+		regs.fp_result_status |= FE_INVALID;
+#endif
+	}
 	regs.fp_result.fp = *fp;
 }
 
 STATIC_INLINE void CLEAR_STATUS (void)
 {
-	feclearexcept (FE_ALL_EXCEPT);
+	if (!currprefs.fpu_fast)
+		feclearexcept (FE_ALL_EXCEPT);
 }
 
 static void fpnan (fpdata *fpd)
@@ -2344,13 +2355,13 @@ static void fpuop_arithmetic2 (uae_u32 opcode, uae_u16 extra)
 					regs.fp[reg].fp = atanh (src);
 					break;
 				case 0x0e: /* FSIN */
-					regs.fp[reg].fp = sin (src);
+					regs.fp[reg].fp = currprefs.fpu_fast ? fast_sin (src) : sin (src);
 					break;
 				case 0x0f: /* FTAN */
 					regs.fp[reg].fp = tan (src);
 					break;
 				case 0x10: /* FETOX */
-					regs.fp[reg].fp = exp (src);
+					regs.fp[reg].fp = currprefs.fpu_fast ? fast_exp (src) : exp (src);
 					break;
 				case 0x11: /* FTWOTOX */
 					regs.fp[reg].fp = pow (2.0, src);
@@ -2384,7 +2395,7 @@ static void fpuop_arithmetic2 (uae_u32 opcode, uae_u16 extra)
 					regs.fp[reg].fp = acos (src);
 					break;
 				case 0x1d: /* FCOS */
-					regs.fp[reg].fp = cos (src);
+					regs.fp[reg].fp = currprefs.fpu_fast ? fast_cos (src) : cos (src);
 					break;
 				case 0x1e: /* FGETEXP */
 					{
@@ -2464,8 +2475,13 @@ static void fpuop_arithmetic2 (uae_u32 opcode, uae_u16 extra)
 				case 0x35:
 				case 0x36:
 				case 0x37:
-					regs.fp[extra & 7].fp = cos (src);
-					regs.fp[reg].fp = sin (src);
+					if (currprefs.fpu_fast) {
+						regs.fp[extra & 7].fp = fast_cos (src);
+						regs.fp[reg].fp = fast_sin (src);
+					} else {
+						regs.fp[extra & 7].fp = cos (src);
+						regs.fp[reg].fp = sin (src);
+					}
 					break;
 				case 0x38: /* FCMP */
 					{
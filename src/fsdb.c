@@ -10,6 +10,8 @@
 #include "sysconfig.h"
 #include "sysdeps.h"
 
+#include <ctype.h>
+
 #include "options.h"
 #include "uae.h"
 #include "memory_uae.h"
@@ -86,6 +88,188 @@ static FILE *get_fsdb (a_inode *dir, const TCHAR *mode)
 	return f;
 }
 
+/* In-memory copy of a directory's db file, loaded on the first lookup
+ * and kept up to date by fsdb_dir_writeback (), with hash chains on the
+ * aname (case-insensitive, like same_aname) and on the nname.  Records
+ * are indexed by their position in the file.  */
+
+#define FSDB_RECSIZE (1 + 4 + 257 + 257 + 81)
+
+struct fsdb_rec {
+	TCHAR *aname, *nname;
+	int anext, nnext;
+};
+
+struct fsdb_index {
+	uae_u8 *data;
+	struct fsdb_rec *recs;
+	int count, alloc;
+	int *ahash, *nhash;
+	int hashsize;
+};
+
+/* Hash that agrees with same_aname () if NOCASE, else with _tcscmp ().  */
+unsigned int fsdb_name_hash (const TCHAR *s, int nocase)
+{
+	unsigned int h = 5381;
+
+	while (*s) {
+		uae_u8 c = *s++;
+		if (nocase)
+			c = _totlower (c);
+		h = h * 33 + c;
+	}
+	return h;
+}
+
+static void fsdb_index_link (struct fsdb_index *idx, int n)
+{
+	struct fsdb_rec *r = &idx->recs[n];
+	int *a = &idx->ahash[fsdb_name_hash (r->aname, 1) & (idx->hashsize - 1)];
+	int *b = &idx->nhash[fsdb_name_hash (r->nname, 0) & (idx->hashsize - 1)];
+
+	r->anext = *a;
+	*a = n;
+	r->nnext = *b;
+	*b = n;
+}
+
+static void fsdb_index_unlink (struct fsdb_index *idx, int n)
+{
+	struct fsdb_rec *r = &idx->recs[n];
+	int *p;
+
+	for (p = &idx->ahash[fsdb_name_hash (r->aname, 1) & (idx->hashsize - 1)]; *p != n; p = &idx->recs[*p].anext);
+	*p = r->anext;
+	for (p = &idx->nhash[fsdb_name_hash (r->nname, 0) & (idx->hashsize - 1)]; *p != n; p = &idx->recs[*p].nnext);
+	*p = r->nnext;
+}
+
+static void fsdb_index_rehash (struct fsdb_index *idx, int size)
+{
+	int i;
+
+	xfree (idx->ahash);
+	xfree (idx->nhash);
+	idx->hashsize = size;
+	idx->ahash = xmalloc (int, size);
+	idx->nhash = xmalloc (int, size);
+	for (i = 0; i < size; i++)
+		idx->ahash[i] = idx->nhash[i] = -1;
+	for (i = 0; i < idx->count; i++)
+		fsdb_index_link (idx, i);
+}
+
+static void fsdb_index_clear (struct fsdb_index *idx)
+{
+	int i;
+
+	for (i = 0; i < idx->count; i++) {
+		xfree (idx->recs[i].aname);
+		xfree (idx->recs[i].nname);
+	}
+	idx->count = 0;
+	fsdb_index_rehash (idx, 16);
+}
+
+/* Store record N, appending if it is past the end.  */
+static void fsdb_index_put (struct fsdb_index *idx, int n, const uae_u8 *buf)
+{
+	struct fsdb_rec *r;
+
+	if (n < idx->count) {
+		fsdb_index_unlink (idx, n);
+		xfree (idx->recs[n].aname);
+		xfree (idx->recs[n].nname);
+	} else {
+		static const uae_u8 empty[FSDB_RECSIZE];
+		while (idx->count < n)
+			fsdb_index_put (idx, idx->count, empty);
+		if (n >= idx->alloc) {
+			idx->alloc = idx->alloc ? idx->alloc * 2 : 16;
+			idx->data = xrealloc (uae_u8, idx->data, idx->alloc * FSDB_RECSIZE);
+			idx->recs = xrealloc (struct fsdb_rec, idx->recs, idx->alloc);
+		}
+		idx->count++;
+	}
+	memcpy (idx->data + n * FSDB_RECSIZE, buf, FSDB_RECSIZE);
+	r = &idx->recs[n];
+	r->aname = au ((char*)buf + 5);
+	r->nname = au ((char*)buf + 5 + 257);
+	if (idx->count > idx->hashsize * 2)
+		fsdb_index_rehash (idx, idx->hashsize * 4);
+	else
+		fsdb_index_link (idx, n);
+}
+
+static struct fsdb_index *get_fsdb_index (a_inode *dir)
+{
+	struct fsdb_index *idx = dir->fsdb;
+	uae_u8 buf[FSDB_RECSIZE];
+	FILE *f;
+	int n;
+
+	if (idx || !dir->nname)
+		return idx;
+	idx = xcalloc (struct fsdb_index, 1);
+	fsdb_index_rehash (idx, 16);
+	f = get_fsdb (dir, _T("r+b"));
+	if (f) {
+		for (n = 0; fread (buf, 1, sizeof buf, f) == sizeof buf; n++)
+			fsdb_index_put (idx, n, buf);
+		fclose (f);
+	}
+	dir->fsdb = idx;
+	return idx;
+}
+
+/* Lowest record whose aname matches: valid entries compared like
+ * same_aname, or any entry compared exactly (for reusing slots).  */
+static int fsdb_index_find_aname (struct fsdb_index *idx, const TCHAR *aname, int exact)
+{
+	int n, found = -1;
+
+	for (n = idx->ahash[fsdb_name_hash (aname, 1) & (idx->hashsize - 1)]; n >= 0; n = idx->recs[n].anext) {
+		if (exact) {
+			if (_tcscmp (idx->recs[n].aname, aname))
+				continue;
+		} else if (idx->data[n * FSDB_RECSIZE] == 0 || !same_aname (idx->recs[n].aname, aname)) {
+			continue;
+		}
+		if (found < 0 || n < found)
+			found = n;
+	}
+	return found;
+}
+
+static int fsdb_index_find_nname (struct fsdb_index *idx, const TCHAR *nname)
+{
+	int n, found = -1;
+
+	for (n = idx->nhash[fsdb_name_hash (nname, 0) & (idx->hashsize - 1)]; n >= 0; n = idx->recs[n].nnext) {
+		if (idx->data[n * FSDB_RECSIZE] == 0 || _tcscmp (idx->recs[n].nname, nname))
+			continue;
+		if (found < 0 || n < found)
+			found = n;
+	}
+	return found;
+}
+
+void fsdb_dir_free (a_inode *dir)
+{
+	struct fsdb_index *idx = dir->fsdb;
+
+	if (!idx)
+		return;
+	fsdb_index_clear (idx);
+	xfree (idx->ahash);
+	xfree (idx->nhash);
+	xfree (idx->recs);
+	xfree (idx->data);
+	xfree (idx);
+	dir->fsdb = NULL;
+}
+
 static void kill_fsdb (a_inode *dir)
 {
 	if (!dir->nname)
@@ -93,6 +277,8 @@ static void kill_fsdb (a_inode *dir)
 	TCHAR *n = build_nname (dir->nname, FSDB_FILE);
 	_wunlink (n);
 	xfree (n);
+	if (dir->fsdb)
+		fsdb_index_clear (dir->fsdb);
 }
 
 static void fsdb_fixup (FILE *f, uae_u8 *buf, int size, a_inode *base)
@@ -126,6 +312,7 @@ void fsdb_clean_dir (a_inode *dir)
 
 	if (!dir->nname)
 		return;
+	fsdb_dir_free (dir);
 	n = build_nname (dir->nname, FSDB_FILE);
 	f = _tfopen (n, _T("r+b"));
 	if (f == 0) {
@@ -184,87 +371,46 @@ static a_inode *aino_from_buf (a_inode *base, uae_u8 *buf, long off)
 
 a_inode *fsdb_lookup_aino_aname (a_inode *base, const TCHAR *aname)
 {
-	FILE *f;
+	struct fsdb_index *idx = get_fsdb_index (base);
+	int n;
 
-	f = get_fsdb (base, _T("r+b"));
-	if (f == 0) {
+	if (idx == 0) {
 //		if (currprefs.filesys_custom_uaefsdb && (base->volflags & MYVOLUMEINFO_STREAMS))
 //			return custom_fsdb_lookup_aino_aname (base, aname);
 		return 0;
 	}
-	for (;;) {
-		uae_u8 buf[1 + 4 + 257 + 257 + 81];
-		TCHAR *s;
-		if (fread (buf, 1, sizeof buf, f) < sizeof buf)
-			break;
-		s = au ((char*)buf + 5);
-		if (buf[0] != 0 && same_aname (s, aname)) {
-			long pos = ftell (f) - sizeof buf;
-			fclose (f);
-			xfree (s);
-			return aino_from_buf (base, buf, pos);
-		}
-		xfree (s);
-	}
-	fclose (f);
-	return 0;
+	n = fsdb_index_find_aname (idx, aname, 0);
+	if (n < 0)
+		return 0;
+	return aino_from_buf (base, idx->data + n * FSDB_RECSIZE, n * FSDB_RECSIZE);
 }
 
 a_inode *fsdb_lookup_aino_nname (a_inode *base, const TCHAR *nname)
 {
-	FILE *f;
-	char *s;
+	struct fsdb_index *idx = get_fsdb_index (base);
+	int n;
 
-	f = get_fsdb (base, _T("r+b"));
-	if (f == 0) {
+	if (idx == 0) {
 //		if (currprefs.filesys_custom_uaefsdb && (base->volflags & MYVOLUMEINFO_STREAMS))
 //			return custom_fsdb_lookup_aino_nname (base, nname);
 		return 0;
 	}
-	s = ua (nname);
-	for (;;) {
-		uae_u8 buf[1 + 4 + 257 + 257 + 81];
-		if (fread (buf, 1, sizeof buf, f) < sizeof buf)
-			break;
-		if (buf[0] != 0 && strcmp ((char*)buf + 5 + 257, s) == 0) {
-			long pos = ftell (f) - sizeof buf;
-			fclose (f);
-			xfree (s);
-			return aino_from_buf (base, buf, pos);
-		}
-	}
-	xfree (s);
-	fclose (f);
-	return 0;
+	n = fsdb_index_find_nname (idx, nname);
+	if (n < 0)
+		return 0;
+	return aino_from_buf (base, idx->data + n * FSDB_RECSIZE, n * FSDB_RECSIZE);
 }
 
 int fsdb_used_as_nname (a_inode *base, const TCHAR *nname)
 {
-	FILE *f;
-	uae_u8 buf[1 + 4 + 257 + 257 + 81];
+	struct fsdb_index *idx = get_fsdb_index (base);
 
-	f = get_fsdb (base, _T("r+b"));
-	if (f == 0) {
+	if (idx == 0) {
 //		if (currprefs.filesys_custom_uaefsdb && (base->volflags & MYVOLUMEINFO_STREAMS))
 //			return custom_fsdb_used_as_nname (base, nname);
 		return 0;
 	}
-	for (;;) {
-		TCHAR *s;
-		if (fread (buf, 1, sizeof buf, f) < sizeof buf)
-			break;
-		if (buf[0] == 0)
-			continue;
-		s = au ((char*)buf + 5 + 257);
-		if (_tcscmp (s, nname) == 0) {
-			xfree (s);
-			fclose (f);
-			return 1;
-		}
-		xfree (s);
-	}
-	fclose (f);
-	return 0;
+	return fsdb_index_find_nname (idx, nname) >= 0;
 }
 
 static int needs_dbentry (a_inode *aino)
@@ -281,9 +427,9 @@ static int needs_dbentry (a_inode *aino)
 	return _tcscmp (nn_begin, aino->aname) != 0;
 }
 
-static void write_aino (FILE *f, a_inode *aino)
+static void write_aino (FILE *f, a_inode *dir, a_inode *aino)
 {
-	uae_u8 buf[1 + 4 + 257 + 257 + 81] = { 0 };
+	uae_u8 buf[FSDB_RECSIZE] = { 0 };
 
 	buf[0] = aino->needs_dbentry ? 1 : 0;
 	do_put_mem_long ((uae_u32 *)(buf + 1), aino->amigaos_mode);
@@ -295,10 +441,15 @@ static void write_aino (FILE *f, a_inode *aino)
 	buf[5 + 2 * 257 + 80] = '\0';
 	aino->db_offset = ftell (f);
 	size_t isWritten = fwrite (buf, 1, sizeof buf, f);
-	if (isWritten < sizeof(buf))
+	if (isWritten < sizeof(buf)) {
 		write_log("%s:%d [%s] - Failed to write %ld bytes (%ld/%ld)",
 							 __FILE__, __LINE__, __FUNCTION__,
 					sizeof(buf) - isWritten, isWritten, sizeof(buf));
+		/* don't know what is in the file now, reload it next time */
+		fsdb_dir_free (dir);
+	} else if (dir->fsdb) {
+		fsdb_index_put (dir->fsdb, aino->db_offset / FSDB_RECSIZE, buf);
+	}
 	aino->has_dbentry = aino->needs_dbentry;
 	TRACE ((_T("%d '%s' '%s' written\n"), aino->db_offset, aino->aname, aino->nname));
 }
@@ -311,8 +462,7 @@ void fsdb_dir_writeback (a_inode *dir)
 	int changes_needed = 0;
 	int entries_needed = 0;
 	a_inode *aino;
-	uae_u8 *tmpbuf;
-	int size, i;
+	struct fsdb_index *idx;
 
 	TRACE ((_T("fsdb writeback %s\n"), dir->aname));
 	/* First pass: clear dirty bits where unnecessary, and see if any work
@@ -345,6 +495,7 @@ void fsdb_dir_writeback (a_inode *dir)
 		return;
 	}
 
+	idx = get_fsdb_index (dir);
 	f = get_fsdb (dir, _T("r+b"));
 	if (f == 0) {
 		if (/*(currprefs.filesys_custom_uaefsdb  && (dir->volflags & MYVOLUMEINFO_STREAMS)) ||*/ currprefs.filesys_no_uaefsdb) {
@@ -362,34 +513,19 @@ void fsdb_dir_writeback (a_inode *dir)
 			return;
 		}
 	}
-	fseek (f, 0, SEEK_END);
-	size = ftell (f);
-	fseek (f, 0, SEEK_SET);
-	tmpbuf = 0;
-	if (size > 0) {
-		tmpbuf = (uae_u8*)malloc (size);
-		size_t isRead = fread (tmpbuf, 1, size, f);
-		if (isRead < (size_t)size)
-			write_log("%s:%d [%s] - Failed to read %ld bytes (%ld/%d)",
-						__FILE__, __LINE__, __FUNCTION__,
-						(size_t)size - isRead, isRead, size);
-	}
-	TRACE ((_T("**** updating '%s' %d\n"), dir->aname, size));
+	TRACE ((_T("**** updating '%s' %d\n"), dir->aname, idx ? idx->count : 0));
 
 	for (aino = dir->child; aino; aino = aino->sibling) {
 		if (! aino->dirty)
 			continue;
 		aino->dirty = 0;
 
-		i = 0;
-		while (!aino->has_dbentry && i < size) {
-			TCHAR *s = au ((char*)tmpbuf + i +  5);
-			if (!_tcscmp (s, aino->aname)) {
+		if (!aino->has_dbentry && idx) {
+			int n = fsdb_index_find_aname (idx, aino->aname, 1);
+			if (n >= 0) {
 				aino->has_dbentry = 1;
-				aino->db_offset = i;
+				aino->db_offset = n * FSDB_RECSIZE;
 			}
-			xfree (s);
-			i += 1 + 4 + 257 + 257 + 81;
 		}
 
 		if (! aino->has_dbentry) {
@@ -398,9 +534,8 @@ void fsdb_dir_writeback (a_inode *dir)
 		} else {
 			fseek (f, aino->db_offset, SEEK_SET);
 		}
-		write_aino (f, aino);
+		write_aino (f, dir, aino);
 	}
 	TRACE ((_T("end\n")));
 	fclose (f);
-	xfree (tmpbuf);
 }
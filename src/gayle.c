@@ -1077,7 +1077,10 @@ static void ide_do_command (struct ide_hdf *ide, uae_u8 cmd)
 		} else if (cmd == 0x00) { /* nop */
 			ide_fail (ide);
 		} else if (cmd == 0xe0 || cmd == 0xe1 || cmd == 0xe7 || cmd == 0xea) { /* standby now/idle/flush cache/flush cache ext */
-			ide_interrupt (ide);
+			if ((cmd == 0xe7 || cmd == 0xea) && !hdf_flush (&ide->hdhfd.hfd))
+				ide_fail_err (ide, IDE_ERR_UNC);
+			else
+				ide_interrupt (ide);
 		} else if (cmd == 0xe5) { /* check power mode */
 			ide->regs.ide_nsector = 0xff;
 			ide_interrupt (ide);
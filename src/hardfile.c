@@ -437,21 +437,488 @@ static uae_u32 vhd_checksum (uae_u8 *p, int offset)
 static int hdf_write2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 static int hdf_read2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 
+/* Block cache
+ *
+ * Up to hardfile_cache lines of HDF_CACHE_LINE bytes, least recently used
+ * line is replaced. When reads are sequential, hardfile_readahead lines
+ * following the last read are loaded by the unit's cache thread.
+ * All access to cache lines and to the image itself is serialized by
+ * cachectl->sem.
+ *
+ * Cache is write-through unless hardfile_writeback is set. In write-back
+ * mode writes only update cache lines, dirty lines are written in block
+ * order by the flush thread hardfile_writeback seconds after the first
+ * unflushed write, when the Amiga asks for a flush (CMD_UPDATE, SCSI
+ * SYNCHRONIZE CACHE, ATA FLUSH CACHE), when a dirty line is replaced and
+ * when the hardfile is closed. Anything written after the last flush is
+ * lost if the emulator does not exit cleanly. A line that can't be
+ * written to the image stays dirty and is retried, the failure is
+ * returned to the Amiga as an error of the flush command.
+ */
+
+#define HDF_CACHE_LINE 32768
+
+struct hdf_cachectl
+{
+	uae_sem_t sem;
+	smp_comm_pipe requests;
+	volatile int thread_running;
+	volatile int flush_running;
+	volatile int pending;
+	int lines;
+	int readahead;
+	int writeback;
+	time_t dirtytime;
+	int sequential;
+	uae_u64 nextoffset;
+	time_t tick;
+	uae_u64 hits, misses, readaheads, bypassed, flushes;
+};
+
+static int hdf_cache_linelen (struct hardfiledata *hfd, uae_u64 line)
+{
+	uae_u64 start = line * HDF_CACHE_LINE;
+
+	if (start >= hfd->virtsize)
+		return 0;
+	if (hfd->virtsize - start < HDF_CACHE_LINE)
+		return hfd->virtsize - start;
+	return HDF_CACHE_LINE;
+}
+
+static struct hdf_cache *hdf_cache_find (struct hardfiledata *hfd, uae_u64 line)
+{
+	struct hdf_cachectl *ctl = hfd->cachectl;
+	int i;
+
+	for (i = 0; i < ctl->lines; i++) {
+		struct hdf_cache *bc = &hfd->bcache[i];
+		if (bc->valid && bc->block == line)
+			return bc;
+	}
+	return NULL;
+}
+
+static bool hdf_cache_writeline (struct hardfiledata *hfd, struct hdf_cache *bc)
+{
+	int len = hdf_cache_linelen (hfd, bc->block);
+
+	if (hdf_write2 (hfd, bc->data, bc->block * HDF_CACHE_LINE, len) != len) {
+		// line stays dirty, next flush tries again
+		write_log (_T("HDF: write-back of block %llu failed\n"), bc->block);
+		return false;
+	}
+	bc->dirty = false;
+	return true;
+}
+
+/* write all dirty lines, lowest block first. Returns false if any line
+ * could not be written, those stay dirty and are retried later.
+ */
+static bool hdf_cache_flushlines (struct hardfiledata *hfd)
+{
+	struct hdf_cachectl *ctl = hfd->cachectl;
+	uae_u64 next = 0;
+	bool ok = true;
+	int i;
+
+	for (;;) {
+		struct hdf_cache *bc = NULL;
+		for (i = 0; i < ctl->lines; i++) {
+			struct hdf_cache *bc2 = &hfd->bcache[i];
+			if (bc2->valid && bc2->dirty && bc2->block >= next && (!bc || bc2->block < bc->block))
+				bc = bc2;
+		}
+		if (!bc)
+			break;
+		if (!hdf_cache_writeline (hfd, bc))
+			ok = false;
+		next = bc->block + 1;
+	}
+	ctl->dirtytime = ok ? 0 : time (NULL);
+	ctl->flushes++;
+	return ok;
+}
+
+/* replace least recently used line, contents are not valid yet.
+ * A dirty line that can't be written back is never replaced, NULL if
+ * no other line is available.
+ */
+static struct hdf_cache *hdf_cache_alloc (struct hardfiledata *hfd, uae_u64 line)
+{
+	struct hdf_cachectl *ctl = hfd->cachectl;
+	struct hdf_cache *bc = NULL;
+	int i;
+
+	for (i = 0; i < ctl->lines; i++) {
+		struct hdf_cache *bc2 = &hfd->bcache[i];
+		if (!bc2->valid) {
+			bc = bc2;
+			break;
+		}
+		if (!bc || bc2->lastaccess < bc->lastaccess)
+			bc = bc2;
+	}
+	if (bc->valid && bc->dirty && !hdf_cache_writeline (hfd, bc)) {
+		bc = NULL;
+		for (i = 0; i < ctl->lines; i++) {
+			struct hdf_cache *bc2 = &hfd->bcache[i];
+			if (!bc2->dirty && (!bc || bc2->lastaccess < bc->lastaccess))
+				bc = bc2;
+		}
+		if (!bc)
+			return NULL;
+	}
+	bc->valid = false;
+	bc->dirty = false;
+	bc->block = line;
+	bc->readcount = 0;
+	bc->writecount = 0;
+	bc->lastaccess = ++ctl->tick;
+	return bc;
+}
+
+static struct hdf_cache *hdf_cache_fill (struct hardfiledata *hfd, uae_u64 line)
+{
+	struct hdf_cache *bc;
+	int len;
+
+	len = hdf_cache_linelen (hfd, line);
+	if (!len)
+		return NULL;
+	bc = hdf_cache_alloc (hfd, line);
+	if (!bc)
+		return NULL;
+	if (hdf_read2 (hfd, bc->data, line * HDF_CACHE_LINE, len) != len)
+		return NULL;
+	bc->valid = true;
+	return bc;
+}
+
+/* copy dirty cached data over data read directly from the image */
+static void hdf_cache_overlay (struct hardfiledata *hfd, uae_u8 *buffer, uae_u64 offset, int len)
+{
+	struct hdf_cachectl *ctl = hfd->cachectl;
+	int i;
+
+	for (i = 0; i < ctl->lines; i++) {
+		struct hdf_cache *bc = &hfd->bcache[i];
+		uae_u64 start, end;
+		if (!bc->valid || !bc->dirty)
+			continue;
+		start = bc->block * HDF_CACHE_LINE;
+		end = start + hdf_cache_linelen (hfd, bc->block);
+		if (offset >= end || offset + len <= start)
+			continue;
+		if (offset > start)
+			memcpy (buffer, bc->data + (offset - start), (offset + len > end ? end : offset + len) - offset);
+		else
+			memcpy (buffer + (start - offset), bc->data, (offset + len > end ? end : offset + len) - start);
+	}
+}
+
+static void *hdf_flush_thread (void *v)
+{
+	struct hardfiledata *hfd = (struct hardfiledata*)v;
+	struct hdf_cachectl *ctl = hfd->cachectl;
+
+	while (ctl->flush_running > 0) {
+		sleep_millis (250);
+		if (ctl->dirtytime && time (NULL) >= ctl->dirtytime + ctl->writeback) {
+			uae_sem_wait (&ctl->sem);
+			if (ctl->dirtytime)
+				hdf_cache_flushlines (hfd);
+			uae_sem_post (&ctl->sem);
+		}
+	}
+	ctl->flush_running = -1;
+	return 0;
+}
+
+static void *hdf_cache_thread (void *v)
+{
+	struct hardfiledata *hfd = (struct hardfiledata*)v;
+	struct hdf_cachectl *ctl = hfd->cachectl;
+
+	for (;;) {
+		uae_u32 line = read_comm_pipe_u32_blocking (&ctl->requests);
+		if (ctl->thread_running == 0)
+			break;
+		uae_sem_wait (&ctl->sem);
+		if (!hdf_cache_find (hfd, line) && hdf_cache_fill (hfd, line))
+			ctl->readaheads++;
+		ctl->pending--;
+		uae_sem_post (&ctl->sem);
+	}
+	ctl->thread_running = -1;
+	return 0;
+}
+
+/* Threads are only started when first needed, hdf_open () is also used
+ * for probing and geometry detection opens that are closed right away.
+ */
+static void hdf_cache_start_readahead (struct hardfiledata *hfd)
+{
+	struct hdf_cachectl *ctl = hfd->cachectl;
+
+	if (ctl->thread_running)
+		return;
+	init_comm_pipe (&ctl->requests, 100, 1);
+	ctl->thread_running = 1;
+	if (!uae_start_thread (_T("hardfile_cache"), hdf_cache_thread, hfd, NULL)) {
+		ctl->thread_running = 0;
+		ctl->readahead = 0;
+		destroy_comm_pipe (&ctl->requests);
+	}
+}
+
+static void hdf_cache_start_flush (struct hardfiledata *hfd)
+{
+	struct hdf_cachectl *ctl = hfd->cachectl;
+
+	if (ctl->flush_running)
+		return;
+	ctl->flush_running = 1;
+	if (!uae_start_thread (_T("hardfile_flush"), hdf_flush_thread, hfd, NULL)) {
+		// already dirty lines are still written on flush and close
+		ctl->flush_running = 0;
+		ctl->writeback = 0;
+	}
+}
+
 static void hdf_init_cache (struct hardfiledata *hfd)
 {
+	struct hdf_cachectl *ctl;
+	int i, lines;
+
+	lines = currprefs.hardfile_cache;
+	if (lines > MAX_HDF_CACHE_BLOCKS)
+		lines = MAX_HDF_CACHE_BLOCKS;
+	if (lines <= 0 || hfd->cachectl || hfd->drive_empty || hdf_mapped_target (hfd))
+		return;
+	ctl = xcalloc (struct hdf_cachectl, 1);
+	if (!ctl)
+		return;
+	for (i = 0; i < lines; i++) {
+		struct hdf_cache *bc = &hfd->bcache[i];
+		memset (bc, 0, sizeof (struct hdf_cache));
+		bc->data = xmalloc (uae_u8, HDF_CACHE_LINE);
+		if (!bc->data)
+			break;
+	}
+	ctl->lines = i;
+	if (!ctl->lines) {
+		xfree (ctl);
+		return;
+	}
+	ctl->readahead = currprefs.hardfile_readahead;
+	if (ctl->readahead > ctl->lines / 2)
+		ctl->readahead = ctl->lines / 2;
+	uae_sem_init (&ctl->sem, 0, 1);
+	hfd->cachectl = ctl;
+	ctl->writeback = currprefs.hardfile_writeback;
+	if (hfd->flags & (HFD_FLAGS_REALDRIVE | HFD_FLAGS_REALDRIVEPARTITION))
+		ctl->writeback = 0;
+	write_log (_T("HDF: %d cache lines, read-ahead %d, write-back %d\n"), ctl->lines, ctl->readahead, ctl->writeback);
+}
+
+static bool hdf_flush_cache (struct hardfiledata *hfd)
+{
+	struct hdf_cachectl *ctl = hfd->cachectl;
+	bool ok = true;
+
+	if (!ctl || !ctl->writeback)
+		return true;
+	uae_sem_wait (&ctl->sem);
+	if (ctl->dirtytime)
+		ok = hdf_cache_flushlines (hfd);
+	uae_sem_post (&ctl->sem);
+	return ok;
 }
-static void hdf_flush_cache (struct hardfiledata *hdf)
+
+/* returns 0 if written data could not be stored in the image */
+int hdf_flush (struct hardfiledata *hfd)
 {
+	bool ok = hdf_flush_cache (hfd);
+	if (!hdf_flush_target (hfd))
+		ok = false;
+	return ok ? 1 : 0;
+}
+
+static void hdf_free_cache (struct hardfiledata *hfd)
+{
+	struct hdf_cachectl *ctl = hfd->cachectl;
+	int i;
+
+	if (!ctl)
+		return;
+	if (ctl->thread_running > 0) {
+		ctl->thread_running = 0;
+		write_comm_pipe_u32 (&ctl->requests, 0xffffffff, 1);
+		while (ctl->thread_running == 0)
+			sleep_millis (10);
+		destroy_comm_pipe (&ctl->requests);
+	}
+	if (ctl->flush_running > 0) {
+		ctl->flush_running = 0;
+		while (ctl->flush_running == 0)
+			sleep_millis (10);
+	}
+	if (ctl->dirtytime && !hdf_cache_flushlines (hfd))
+		write_log (_T("HDF: dirty cache lines could not be written, data lost\n"));
+	write_log (_T("HDF: cache %llu hits, %llu misses, %llu read-ahead, %llu bypassed, %llu flushes\n"),
+		ctl->hits, ctl->misses, ctl->readaheads, ctl->bypassed, ctl->flushes);
+	for (i = 0; i < ctl->lines; i++) {
+		xfree (hfd->bcache[i].data);
+		memset (&hfd->bcache[i], 0, sizeof (struct hdf_cache));
+	}
+	uae_sem_destroy (&ctl->sem);
+	xfree (ctl);
+	hfd->cachectl = NULL;
+}
+
+static void hdf_cache_readahead (struct hardfiledata *hfd, uae_u64 offset)
+{
+	struct hdf_cachectl *ctl = hfd->cachectl;
+	uae_u64 line = (offset + HDF_CACHE_LINE - 1) / HDF_CACHE_LINE;
+	int i;
+
+	hdf_cache_start_readahead (hfd);
+	for (i = 0; i < ctl->readahead; i++, line++) {
+		if (ctl->pending >= ctl->readahead || !hdf_cache_linelen (hfd, line))
+			break;
+		if (hdf_cache_find (hfd, line))
+			continue;
+		ctl->pending++;
+		write_comm_pipe_u32 (&ctl->requests, (uae_u32)line, 1);
+	}
 }
 
 static int hdf_cache_read (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
-	return hdf_read2 (hfd, buffer, offset, len);
+	struct hdf_cachectl *ctl = hfd->cachectl;
+	uae_u8 *p = (uae_u8*)buffer;
+	int got = 0;
+
+	if (!ctl)
+		return hdf_read2 (hfd, buffer, offset, len);
+	uae_sem_wait (&ctl->sem);
+	if (offset == ctl->nextoffset)
+		ctl->sequential++;
+	else
+		ctl->sequential = 0;
+	ctl->nextoffset = offset + len;
+	if (len > HDF_CACHE_LINE * ctl->lines / 2) {
+		// would replace most of the cache
+		ctl->bypassed++;
+		got = hdf_read2 (hfd, buffer, offset, len);
+		if (ctl->dirtytime)
+			hdf_cache_overlay (hfd, p, offset, got);
+		uae_sem_post (&ctl->sem);
+		return got;
+	}
+	while (len > 0) {
+		uae_u64 line = offset / HDF_CACHE_LINE;
+		int loffset = offset % HDF_CACHE_LINE;
+		int size = len > HDF_CACHE_LINE - loffset ? HDF_CACHE_LINE - loffset : len;
+		struct hdf_cache *bc = hdf_cache_find (hfd, line);
+		if (bc) {
+			ctl->hits++;
+		} else {
+			ctl->misses++;
+			bc = hdf_cache_fill (hfd, line);
+		}
+		if (bc && loffset + size <= hdf_cache_linelen (hfd, line)) {
+			memcpy (p, bc->data + loffset, size);
+			bc->lastaccess = ++ctl->tick;
+			bc->readcount++;
+		} else {
+			int v = hdf_read2 (hfd, p, offset, size);
+			if (v != size) {
+				if (v > 0)
+					got += v;
+				break;
+			}
+		}
+		got += size;
+		offset += size;
+		p += size;
+		len -= size;
+	}
+	if (ctl->readahead && ctl->sequential >= 2)
+		hdf_cache_readahead (hfd, offset);
+	uae_sem_post (&ctl->sem);
+	return got;
 }
 
 static int hdf_cache_write (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
-	return hdf_write2 (hfd, buffer, offset, len);
+	struct hdf_cachectl *ctl = hfd->cachectl;
+	uae_u8 *p = (uae_u8*)buffer;
+	int i, v;
+
+	if (!ctl)
+		return hdf_write2 (hfd, buffer, offset, len);
+	uae_sem_wait (&ctl->sem);
+	if (ctl->writeback && len <= HDF_CACHE_LINE * ctl->lines / 2) {
+		v = 0;
+		while (len > 0) {
+			uae_u64 line = offset / HDF_CACHE_LINE;
+			int loffset = offset % HDF_CACHE_LINE;
+			int size = len > HDF_CACHE_LINE - loffset ? HDF_CACHE_LINE - loffset : len;
+			int linelen = hdf_cache_linelen (hfd, line);
+			struct hdf_cache *bc = hdf_cache_find (hfd, line);
+			if (!bc && loffset == 0 && size == linelen) {
+				// whole line is replaced, no need to read it first
+				bc = hdf_cache_alloc (hfd, line);
+				if (bc)
+					bc->valid = true;
+			} else if (!bc) {
+				bc = hdf_cache_fill (hfd, line);
+			}
+			if (bc && loffset + size <= linelen) {
+				memcpy (bc->data + loffset, p, size);
+				bc->dirty = true;
+				bc->writecount++;
+				bc->lastaccess = ++ctl->tick;
+				if (!ctl->dirtytime) {
+					ctl->dirtytime = time (NULL);
+					hdf_cache_start_flush (hfd);
+				}
+			} else if (hdf_write2 (hfd, p, offset, size) != size) {
+				break;
+			}
+			v += size;
+			offset += size;
+			p += size;
+			len -= size;
+		}
+		uae_sem_post (&ctl->sem);
+		return v;
+	}
+	v = hdf_write2 (hfd, buffer, offset, len);
+	for (i = 0; i < ctl->lines; i++) {
+		struct hdf_cache *bc = &hfd->bcache[i];
+		uae_u64 start, end;
+		if (!bc->valid)
+			continue;
+		start = bc->block * HDF_CACHE_LINE;
+		end = start + hdf_cache_linelen (hfd, bc->block);
+		if (offset >= end || offset + len <= start)
+			continue;
+		if (v != len) {
+			if (!bc->dirty || hdf_cache_writeline (hfd, bc))
+				bc->valid = false;
+			continue;
+		}
+		if (offset > start)
+			memcpy (bc->data + (offset - start), buffer, (offset + len > end ? end : offset + len) - offset);
+		else
+			memcpy (bc->data, (uae_u8*)buffer + (start - offset), (offset + len > end ? end : offset + len) - start);
+		bc->writecount++;
+	}
+	uae_sem_post (&ctl->sem);
+	return v;
 }
 
 int hdf_open (struct hardfiledata *hfd, const TCHAR *pname)
@@ -538,12 +1005,14 @@ int hdf_open (struct hardfiledata *hfd, const TCHAR *pname)
 		hfd->vhd_sectormapblock = -1;
 		hfd->vhd_bitmapsize = ((hfd->vhd_blocksize / (8 * 512)) + 511) & ~511;
 	}
+	hdf_unmap_target (hfd);
 	write_log (_T("HDF is VHD %s image, virtual size=%lluK\n"),
 		hfd->hfd_type == HFD_VHD_FIXED ? _T("fixed") : _T("dynamic"),
 		hfd->virtsize / 1024);
 	hdf_init_cache (hfd);
 	return 1;
 nonvhd:
+	hdf_init_cache (hfd);
 	return 1;
 end:
 	hdf_close_target (hfd);
@@ -553,6 +1022,7 @@ end:
 void hdf_close (struct hardfiledata *hfd)
 {
 	hdf_flush_cache (hfd);
+	hdf_free_cache (hfd);
 	hdf_close_target (hfd);
 #if USE_CHD
 	if (hfd->chd_handle) {
@@ -1079,9 +1549,12 @@ static uae_u64 cmd_readx (struct hardfiledata *hfd, uae_u8 *dataptr, uae_u64 off
 static uae_u64 cmd_read (struct hardfiledata *hfd, uaecptr dataptr, uae_u64 offset, uae_u64 len)
 {
 	addrbank *bank_data = &get_mem_bank (dataptr);
+	uae_u64 v;
 	if (!len || !bank_data || !bank_data->check (dataptr, len))
 		return 0;
-	return cmd_readx (hfd, bank_data->xlateaddr (dataptr), offset, len);
+	v = cmd_readx (hfd, bank_data->xlateaddr (dataptr), offset, len);
+	memory_dirty_address (dataptr, v);
+	return v;
 }
 static uae_u64 cmd_writex (struct hardfiledata *hfd, uae_u8 *dataptr, uae_u64 offset, uae_u64 len)
 {
@@ -1399,6 +1872,8 @@ int scsi_hd_emulate (struct hardfiledata *hfd, struct hd_hardfiledata *hdhfd, ua
 	case 0x35: /* SYNCRONIZE CACHE (10) */
 		if (nodisk (hfd))
 			goto nodisk;
+		if (!hdf_flush (hfd))
+			goto writeerr;
 		scsi_len = 0;
 		break;
 	case 0xa8: /* READ (12) */
@@ -1451,6 +1926,13 @@ nodisk:
 		s[12] = 0x3A; /* MEDIUM NOT PRESENT */
 		ls = 0x12;
 		break;
+writeerr:
+		status = 2; /* CHECK CONDITION */
+		s[0] = 0x70;
+		s[2] = 3; /* MEDIUM ERROR */
+		s[12] = 0x0C; /* WRITE ERROR */
+		ls = 0x12;
+		break;
 
 	default:
 err:
@@ -1525,6 +2007,8 @@ static int handle_scsi (uaecptr request, struct hardfiledata *hfd)
 	scsi_log (_T("\n"));
 
 	status = scsi_hd_emulate (hfd, NULL, cmdbuf, scsi_cmd_len, scsi_data_ptr, &scsi_len, reply, &reply_len, sense, &sense_len);
+	if (scsi_data_ptr && scsi_len > 0)
+		memory_dirty_address (scsi_data, scsi_len);
 
 	put_word (acmd + 18, status != 0 ? 0 : scsi_cmd_len); /* fake scsi_CmdActual */
 	put_byte (acmd + 21, status); /* scsi_Status */
@@ -1917,8 +2401,12 @@ static uae_u32 hardfile_do_io (struct hardfiledata *hfd, struct hardfileprivdata
 		actual = hfd->drive_empty ? 1 :0;
 		break;
 
-		/* Some commands that just do nothing and return zero */
 	case CMD_UPDATE:
+		if (!hdf_flush (hfd))
+			error = IOERR_NotSpecified;
+		break;
+
+		/* Some commands that just do nothing and return zero */
 	case CMD_CLEAR:
 	case CMD_MOTOR:
 	case CMD_SEEK:
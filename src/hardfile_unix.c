@@ -15,6 +15,12 @@
 #include "filesys.h"
 #include "zfile.h"
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <signal.h>
+
 #define hfd_log write_log
 
 //#define HDF_DEBUG
@@ -29,6 +35,10 @@ struct hardfilehandle
 	int zfile;
 	struct zfile *zf;
 	FILE *h;
+	uae_u8 *map;
+	uae_u64 mapsize;
+	uae_u64 nextoffset;
+	volatile sig_atomic_t maperror;
 };
 
 struct uae_driveinfo {
@@ -50,6 +60,7 @@ struct uae_driveinfo {
 //#define HDF_HANDLE_WIN32 1
 #define HDF_HANDLE_ZFILE 2
 #define HDF_HANDLE_LINUX 3
+#define HDF_HANDLE_MMAP 4
 #define INVALID_HANDLE_VALUE NULL
 
 #define CACHE_SIZE 16384
@@ -186,6 +197,191 @@ static int isharddrive (const TCHAR *name)
 
 static TCHAR *hdz[] = { "hdz", "zip", "rar", "7z", NULL };
 
+#ifdef HAVE_SYS_MMAN_H
+/* mapped images, looked up by the SIGBUS handler */
+#define MAX_HDF_MAPS 32
+static struct hardfilehandle *volatile hdf_maps[MAX_HDF_MAPS];
+static struct sigaction hdf_oldbus;
+static bool hdf_bus_installed;
+/* sysconf () is not async-signal-safe, the handler uses this copy */
+static long hdf_pagesize;
+
+/* Touching a mapped page past the end of a file that shrank behind our back
+ * (or one the host could not read) raises SIGBUS. Put an anonymous zero page
+ * over the faulting page so the copy can finish, and flag the mapping so the
+ * transfer is reported as failed. Faults outside our mappings go to the
+ * previous handler.
+ */
+static void hdf_sigbus (int sig, siginfo_t *si, void *ctx)
+{
+	uae_u8 *addr = (uae_u8*)si->si_addr;
+	long pagesize = hdf_pagesize;
+	int i;
+
+	for (i = 0; i < MAX_HDF_MAPS; i++) {
+		struct hardfilehandle *h = hdf_maps[i];
+		if (h && h->map && addr >= h->map && addr < h->map + h->mapsize) {
+			void *page = (void*)((uintptr_t)addr & ~(uintptr_t)(pagesize - 1));
+			if (mmap (page, pagesize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)
+				break;
+			h->maperror = 1;
+			return;
+		}
+	}
+	if (hdf_oldbus.sa_flags & SA_SIGINFO) {
+		if (hdf_oldbus.sa_sigaction) {
+			hdf_oldbus.sa_sigaction (sig, si, ctx);
+			return;
+		}
+	} else if (hdf_oldbus.sa_handler != SIG_DFL && hdf_oldbus.sa_handler != SIG_IGN) {
+		hdf_oldbus.sa_handler (sig);
+		return;
+	}
+	/* not ours: fault again with the default action */
+	signal (SIGBUS, SIG_DFL);
+}
+
+static bool hdf_map_register (struct hardfilehandle *h)
+{
+	int i;
+
+	if (!hdf_bus_installed) {
+		struct sigaction sa;
+		hdf_pagesize = sysconf (_SC_PAGESIZE);
+		memset (&sa, 0, sizeof sa);
+		sa.sa_sigaction = hdf_sigbus;
+		sa.sa_flags = SA_SIGINFO;
+		sigemptyset (&sa.sa_mask);
+		if (sigaction (SIGBUS, &sa, &hdf_oldbus))
+			return false;
+		hdf_bus_installed = true;
+	}
+	for (i = 0; i < MAX_HDF_MAPS; i++) {
+		if (!hdf_maps[i]) {
+			hdf_maps[i] = h;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void hdf_map_unregister (struct hardfilehandle *h)
+{
+	int i;
+
+	for (i = 0; i < MAX_HDF_MAPS; i++) {
+		if (hdf_maps[i] == h)
+			hdf_maps[i] = NULL;
+	}
+}
+#endif
+
+/* map whole image file, on success reads and writes are plain memcpy()s */
+static bool hdf_map (struct hardfiledata *hfd, const char *name)
+{
+#ifdef HAVE_SYS_MMAN_H
+	struct hardfilehandle *h = hfd->handle;
+	struct stat st;
+	void *map;
+
+	if (!currprefs.hardfile_mmap)
+		return false;
+	if (fstat (fileno (h->h), &st) || !S_ISREG (st.st_mode) || st.st_size <= 0)
+		return false;
+	if ((uae_u64)st.st_size != (uae_u64)(size_t)st.st_size)
+		return false;
+	map = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fileno (h->h), 0);
+	if (map == MAP_FAILED) {
+		write_log ("HDF '%s' mmap failed, error %d\n", name, errno);
+		return false;
+	}
+	h->map = (uae_u8*)map;
+	h->mapsize = st.st_size;
+	h->nextoffset = 0;
+	h->maperror = 0;
+	if (!hdf_map_register (h)) {
+		write_log ("HDF '%s' can't guard mapping, using file access\n", name);
+		munmap (map, st.st_size);
+		h->map = NULL;
+		h->mapsize = 0;
+		return false;
+	}
+	hfd->physsize = hfd->virtsize = st.st_size;
+	hfd->handle_valid = HDF_HANDLE_MMAP;
+	write_log ("HDF '%s' mapped at %p\n", name, map);
+	return true;
+#else
+	return false;
+#endif
+}
+
+static void hdf_unmap (struct hardfilehandle *h)
+{
+#ifdef HAVE_SYS_MMAN_H
+	if (!h || !h->map)
+		return;
+	hdf_map_unregister (h);
+	munmap (h->map, h->mapsize);
+	h->map = NULL;
+	h->mapsize = 0;
+#endif
+}
+
+/* returns image offset of the transfer or -1 if out of bounds */
+static uae_s64 hdf_map_check (struct hardfiledata *hfd, uae_u64 offset, int len)
+{
+	struct hardfilehandle *h = hfd->handle;
+
+	if (len < 0 || offset + len > hfd->physsize - hfd->virtual_size) {
+		gui_message ("hd: mapped access out of bounds! (0x%llx, LEN=%d)", offset, len);
+		return -1;
+	}
+	offset += hfd->offset;
+	if (offset + len > h->mapsize || h->maperror)
+		return -1;
+#ifdef HAVE_SYS_MMAN_H
+	// sequential transfer: ask kernel to start reading the next one
+	if (offset == h->nextoffset && len >= 4096) {
+		uae_u64 start = (offset + len) & ~(uae_u64)4095;
+		uae_u64 size = len * 2;
+		if (start < h->mapsize) {
+			if (start + size > h->mapsize)
+				size = h->mapsize - start;
+			madvise (h->map + start, size, MADV_WILLNEED);
+		}
+	}
+#endif
+	h->nextoffset = offset + len;
+	return offset;
+}
+
+bool hdf_mapped_target (struct hardfiledata *hfd)
+{
+	return hfd->handle_valid == HDF_HANDLE_MMAP;
+}
+
+/* back to stdio access, VHD images are not accessed through the mapping */
+void hdf_unmap_target (struct hardfiledata *hfd)
+{
+	if (hfd->handle_valid != HDF_HANDLE_MMAP)
+		return;
+	hdf_unmap (hfd->handle);
+	hfd->handle_valid = HDF_HANDLE_LINUX;
+}
+
+int hdf_flush_target (struct hardfiledata *hfd)
+{
+#ifdef HAVE_SYS_MMAN_H
+	if (hfd->handle_valid == HDF_HANDLE_MMAP && msync (hfd->handle->map, hfd->handle->mapsize, MS_SYNC)) {
+		write_log (_T("HDF: msync failed, errno %d\n"), errno);
+		return 0;
+	}
+	if (hfd->handle_valid == HDF_HANDLE_MMAP && hfd->handle->maperror)
+		return 0;
+#endif
+	return 1;
+}
+
 int hdf_open_target (struct hardfiledata *hfd, const char *pname)
 {
 	FILE *h = INVALID_HANDLE_VALUE;
@@ -297,6 +493,8 @@ int hdf_open_target (struct hardfiledata *hfd, const char *pname)
 				hfd->physsize = hfd->virtsize = zfile_ftell (hfd->handle->zf);
 				zfile_fseek (hfd->handle->zf, 0, SEEK_SET);
 				hfd->handle_valid = HDF_HANDLE_ZFILE;
+			} else if (!zmode) {
+				hdf_map (hfd, name);
 			}
 		} else {
 			write_log ("HDF '%s' failed to open. error = %d\n", name, errno);
@@ -335,6 +533,10 @@ static void freehandle (struct hardfilehandle *h)
 void hdf_close_target (struct hardfiledata *hfd)
 {
  	//freehandle (hfd->handle);
+	if (hfd->handle_valid == HDF_HANDLE_MMAP) {
+		hdf_unmap (hfd->handle);
+		fclose (hfd->handle->h);
+	}
 	xfree (hfd->handle);
 	xfree (hfd->emptyname);
 	hfd->emptyname = NULL;
@@ -478,6 +680,21 @@ static int hdf_read_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, i
 	return 0;
 }
 
+/* hardfile.c's block cache is in front, read straight into its buffer */
+static int hdf_read_direct (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
+{
+	size_t ret = 0;
+
+	hfd->cache_valid = 0;
+	hdf_seek (hfd, offset);
+	poscheck (hfd, len);
+	if (hfd->handle_valid == HDF_HANDLE_LINUX)
+		ret = fread (buffer, 1, len, hfd->handle->h);
+	else if (hfd->handle_valid == HDF_HANDLE_ZFILE)
+		ret = zfile_fread (buffer, 1, len, hfd->handle->zf);
+	return ret;
+}
+
 int hdf_read_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
     int got = 0;
@@ -493,6 +710,19 @@ int hdf_read_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int
 		return len2;
 	}
 	offset -= hfd->virtual_size;
+	if (hfd->handle_valid == HDF_HANDLE_MMAP) {
+		uae_s64 moffset = hdf_map_check (hfd, offset, len);
+		if (moffset < 0)
+			return 0;
+		memcpy (buffer, hfd->handle->map + moffset, len);
+		if (hfd->handle->maperror) {
+			write_log (_T("HDF: mapped read at 0x%llx failed, image truncated?\n"), moffset);
+			return 0;
+		}
+		return len;
+	}
+	if (hfd->cachectl)
+		return hdf_read_direct (hfd, buffer, offset, len);
 	while (len > 0) {
 		unsigned int maxlen;
 		size_t ret = 0;
@@ -524,6 +754,7 @@ int hdf_read_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int
 static int hdf_write_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len)
 {
 	long outlen = 0;
+	uae_u8 *data = hfd->cachectl ? (uae_u8*)buffer : hfd->cache;
 
 //	if (hfd->readonly)
 //		return 0;
@@ -532,9 +763,10 @@ static int hdf_write_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset,
 	hfd->cache_valid = 0;
 	hdf_seek (hfd, offset);
 	poscheck (hfd, len);
-	memcpy (hfd->cache, buffer, len);
+	if (data != buffer)
+		memcpy (data, buffer, len);
 	if (hfd->handle_valid == HDF_HANDLE_LINUX) {
-	    outlen = fwrite (hfd->cache, 1, len, hfd->handle->h);
+	    outlen = fwrite (data, 1, len, hfd->handle->h);
 		if (outlen != len)
 			gui_message ("Harddrive\n%s\ncache write failed!", hfd->device_name);
 		else if (offset == 0) {
@@ -546,13 +778,13 @@ static int hdf_write_2 (struct hardfiledata *hfd, void *buffer, uae_u64 offset,
 				memset (tmp, 0xa1, tmplen);
 				hdf_seek (hfd, offset);
 				outlen2 = fread (tmp, 1, tmplen, hfd->handle->h);
-				if (memcmp (hfd->cache, tmp, tmplen) != 0 || outlen2 != len)
+				if (memcmp (data, tmp, tmplen) != 0 || outlen2 != len)
 					gui_message ("Harddrive\n%s\nblock zero write failed!", hfd->device_name);
 				xfree (tmp);
 			}
 		}
 	} else if (hfd->handle_valid == HDF_HANDLE_ZFILE) {
-		outlen = zfile_fwrite (hfd->cache, 1, len, hfd->handle->zf);
+		outlen = zfile_fwrite (data, 1, len, hfd->handle->zf);
 	}
 	return outlen;
 }
@@ -566,6 +798,20 @@ int hdf_write_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, in
 	if (offset < hfd->virtual_size)
 		return len;
 	offset -= hfd->virtual_size;
+	if (hfd->handle_valid == HDF_HANDLE_MMAP) {
+		uae_s64 moffset;
+		if (hfd->dangerous)
+			return 0;
+		moffset = hdf_map_check (hfd, offset, len);
+		if (moffset < 0)
+			return 0;
+		memcpy (hfd->handle->map + moffset, buffer, len);
+		if (hfd->handle->maperror) {
+			write_log (_T("HDF: mapped write at 0x%llx failed, image truncated?\n"), moffset);
+			return 0;
+		}
+		return len;
+	}
 	while (len > 0) {
 		int maxlen = len > CACHE_SIZE ? CACHE_SIZE : len;
 		int ret = hdf_write_2 (hfd, p, offset, maxlen);
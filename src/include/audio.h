@@ -39,6 +39,7 @@ extern void audio_evhandler (void);
 extern void audio_hsync (void);
 extern void audio_update_adkmasks (void);
 extern void update_sound (double clk);
+extern float scaled_sample_evtime, scaled_sample_evtime_orig;
 extern void led_filter_audio (void);
 extern void set_audio (void);
 extern int audio_activate (void);
@@ -0,0 +1,36 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Headless benchmark mode
+  */
+
+#ifndef UAE_BENCHMARK_H
+#define UAE_BENCHMARK_H
+
+/* Wall time is split between these. Sections nest, time is charged to
+ * the innermost one (copper called from an event counts as copper). */
+enum {
+	BENCH_CPU,
+	BENCH_EVENTS,
+	BENCH_COPPER,
+	BENCH_BLITTER,
+	BENCH_DRAWING,
+	BENCH_AUDIO,
+	BENCH_SECTIONS
+};
+
+extern bool bench_running;
+extern uae_u64 bench_insns;
+
+extern void bench_setup (int frames);
+extern void bench_set_output (const TCHAR *jsonfile);
+extern void bench_vsync (void);
+extern void bench_enter (int section);
+extern void bench_leave (void);
+
+#define BENCH_ENTER(s) do { if (bench_running) bench_enter (s); } while (0)
+#define BENCH_LEAVE() do { if (bench_running) bench_leave (); } while (0)
+/* interpreted 68k instructions, compiled JIT blocks are not counted */
+#define BENCH_INSN() (bench_insns++)
+
+#endif /* UAE_BENCHMARK_H */
@@ -39,6 +39,10 @@ extern int blitnasty (void);
 extern int blitnnasty (int);
 extern void blitter_handler (uae_u32);
 extern void build_blitfilltable (void);
+extern void blitter_simd_init (int level);
+extern int blitter_simd_blit (uae_u8 *mem, uae_u32 memsize, uaecptr pta, uaecptr ptb, uaecptr ptc, uaecptr ptd,
+	struct bltinfo *b, uae_u8 mt, int desc, int fillmode, int *fcp, uae_u8 (*filltable)[4][2]);
+extern void blitter_simd_range (uaecptr pt, int mod, int w, int h, int desc, uae_s64 *lo, uae_s64 *hi);
 extern void do_blitter (int, int);
 extern void decide_blitter (int hpos);
 extern int blitter_need (int hpos);
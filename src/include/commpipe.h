@@ -18,6 +18,151 @@ typedef union {
  * We queue up to chunks pieces of data before signalling the other thread to
  * avoid overhead. */
 
+#if defined (__GCC_ATOMIC_INT_LOCK_FREE) && !defined (COMMPIPE_LOCKED)
+
+/* Lock-free version, ring indices are only written by one side: wrp by
+ * the writer, rdp by the reader, so the reader never takes a lock.
+ * Writers still serialize on lock because some pipes have more than one
+ * producer (e.g. device threads requeueing their own requests); with a
+ * single producer that is one uncontended atomic operation.
+ * A side that has to wait spins for a while first and then sleeps on its
+ * semaphore after announcing itself in reader_waiting/writer_waiting.
+ * The other side clears the flag with an atomic exchange and posts only
+ * if it won the exchange, so every post is matched by exactly one wait.
+ * rdp and wrp are kept on separate cache lines. */
+
+#ifndef COMMPIPE_SPIN
+#define COMMPIPE_SPIN 1000
+#endif
+
+typedef struct {
+    uae_sem_t lock;
+    uae_sem_t reader_wait;
+    uae_sem_t writer_wait;
+    uae_pt *data;
+    int size, chunks;
+    char pad1[64];
+    volatile int rdp;
+    volatile int writer_waiting;
+    char pad2[64];
+    volatile int wrp;
+    volatile int reader_waiting;
+    char pad3[64];
+} smp_comm_pipe;
+
+#if defined (__i386__) || defined (__x86_64__)
+#define commpipe_relax() __asm__ __volatile__ ("pause")
+#else
+#define commpipe_relax() __asm__ __volatile__ ("" ::: "memory")
+#endif
+
+STATIC_INLINE void init_comm_pipe (smp_comm_pipe *p, int size, int chunks)
+{
+    memset (p, 0, sizeof (*p));
+    p->data = (uae_pt *)malloc (size*sizeof (uae_pt));
+    p->size = size;
+    p->chunks = chunks;
+    p->rdp = p->wrp = 0;
+    p->reader_waiting = 0;
+    p->writer_waiting = 0;
+    uae_sem_init (&p->lock, 0, 1);
+    uae_sem_init (&p->reader_wait, 0, 0);
+    uae_sem_init (&p->writer_wait, 0, 0);
+}
+
+STATIC_INLINE void destroy_comm_pipe (smp_comm_pipe *p)
+{
+    uae_sem_destroy (&p->lock);
+    uae_sem_destroy (&p->reader_wait);
+    uae_sem_destroy (&p->writer_wait);
+}
+
+/* spinning only helps if the other side is running on another cpu */
+STATIC_INLINE int commpipe_spincount (void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    static int spin = -1;
+    if (spin < 0)
+		spin = sysconf (_SC_NPROCESSORS_ONLN) > 1 ? COMMPIPE_SPIN : 0;
+    return spin;
+#else
+    return COMMPIPE_SPIN;
+#endif
+}
+
+/* sleep until *flag is cleared by the other side or cond () becomes true */
+#define COMMPIPE_WAIT(p, flag, sem, cond) \
+    do { \
+		int spin_, spincount_ = commpipe_spincount (); \
+		for (spin_ = 0; spin_ < spincount_ && !(cond); spin_++) \
+			commpipe_relax (); \
+		while (!(cond)) { \
+			__atomic_store_n (&(p)->flag, 1, __ATOMIC_SEQ_CST); \
+			__atomic_thread_fence (__ATOMIC_SEQ_CST); \
+			if (cond) { \
+				if (!__atomic_exchange_n (&(p)->flag, 0, __ATOMIC_SEQ_CST)) \
+					uae_sem_wait (&(p)->sem); \
+				break; \
+			} \
+			uae_sem_wait (&(p)->sem); \
+		} \
+    } while (0)
+
+STATIC_INLINE void commpipe_wake (volatile int *flag, uae_sem_t *sem)
+{
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (__atomic_load_n (flag, __ATOMIC_RELAXED) && __atomic_exchange_n (flag, 0, __ATOMIC_SEQ_CST))
+		uae_sem_post (sem);
+}
+
+#define comm_pipe_wrp(p) __atomic_load_n (&(p)->wrp, __ATOMIC_ACQUIRE)
+#define comm_pipe_rdp(p) __atomic_load_n (&(p)->rdp, __ATOMIC_ACQUIRE)
+
+STATIC_INLINE void maybe_wake_reader (smp_comm_pipe *p, int no_buffer)
+{
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n (&p->reader_waiting, __ATOMIC_RELAXED))
+		return;
+    if (no_buffer || ((p->wrp - comm_pipe_rdp (p) + p->size) % p->size) >= p->chunks)
+		commpipe_wake (&p->reader_waiting, &p->reader_wait);
+}
+
+STATIC_INLINE void write_comm_pipe_pt (smp_comm_pipe *p, uae_pt data, int no_buffer)
+{
+    int wrp, nxwrp;
+
+    uae_sem_wait (&p->lock);
+    wrp = p->wrp;
+    nxwrp = (wrp + 1) % p->size;
+    /* Pipe full? */
+    COMMPIPE_WAIT (p, writer_waiting, writer_wait, comm_pipe_rdp (p) != nxwrp);
+    p->data[wrp] = data;
+    __atomic_store_n (&p->wrp, nxwrp, __ATOMIC_RELEASE);
+    maybe_wake_reader (p, no_buffer);
+    uae_sem_post (&p->lock);
+}
+
+STATIC_INLINE uae_pt read_comm_pipe_pt_blocking (smp_comm_pipe *p)
+{
+    uae_pt data;
+    int rdp = p->rdp;
+
+    COMMPIPE_WAIT (p, reader_waiting, reader_wait, comm_pipe_wrp (p) != rdp);
+    data = p->data[rdp];
+    __atomic_store_n (&p->rdp, (rdp + 1) % p->size, __ATOMIC_RELEASE);
+
+    /* We ignore chunks here. If this is a problem, make the size bigger in the init call. */
+    commpipe_wake (&p->writer_waiting, &p->writer_wait);
+    return data;
+}
+
+STATIC_INLINE int comm_pipe_has_data (smp_comm_pipe *p)
+{
+    return comm_pipe_rdp (p) != comm_pipe_wrp (p);
+}
+
+#else
+
 typedef struct {
     uae_sem_t lock;
     uae_sem_t reader_wait;
@@ -117,6 +262,8 @@ STATIC_INLINE int comm_pipe_has_data (smp_comm_pipe *p)
     return p->rdp != p->wrp;
 }
 
+#endif
+
 STATIC_INLINE int read_comm_pipe_int_blocking (smp_comm_pipe *p)
 {
     uae_pt foo = read_comm_pipe_pt_blocking (p);
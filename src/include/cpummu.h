@@ -193,6 +193,69 @@ extern struct mmu_atc_line mmu_atc_array[ATC_TYPE][ATC_WAYS][ATC_SLOTS];
 /* Last matched ATC index, next lookup starts from this index as an optimization */
 extern int mmu_atc_ways;
 
+/*
+ * Software TLB in front of the ATC. Direct mapped, one table per access
+ * type, caches the host address of recently translated pages that are
+ * plain memory (mem_direct_r/w). A hit skips the TTR check, the ATC
+ * search and the bank handlers. Entries are only made from valid ATC
+ * lines with no TTR match, so the whole TLB is flushed on PFLUSH, TC and
+ * TTR writes and memory map changes, and a page is dropped when its ATC
+ * line is refilled or reused.
+ */
+#define MMU_TLB_BITS 8
+#define MMU_TLB_SIZE (1 << MMU_TLB_BITS)
+/* valid tags are page | MMU_TLB_VALID | super, so a cleared entry never matches */
+#define MMU_TLB_VALID 2
+
+enum { MMU_TLB_IREAD, MMU_TLB_DREAD, MMU_TLB_DWRITE, MMU_TLB_TYPES };
+
+struct mmu_tlb_entry {
+	uaecptr tag;
+	uae_u8 *host;
+};
+
+extern struct mmu_tlb_entry mmu_tlb[MMU_TLB_TYPES][MMU_TLB_SIZE];
+extern uae_u64 mmu_tlb_hits, mmu_tlb_misses;
+
+extern void mmu_tlb_flush (void);
+extern void mmu_tlb_flush_page (uaecptr addr);
+extern void mmu_tlb_evict (struct mmu_atc_line *l, int index);
+
+STATIC_INLINE uaecptr mmu_tlb_tag (uaecptr addr)
+{
+	return (addr & ~mmu_pagemask) | MMU_TLB_VALID | (mmu_is_super >> 31);
+}
+
+static ALWAYS_INLINE uae_u8 *mmu_tlb_lookup (uaecptr addr, int type)
+{
+	struct mmu_tlb_entry *e = &mmu_tlb[type][(addr >> 12) & (MMU_TLB_SIZE - 1)];
+
+	if (e->tag != mmu_tlb_tag (addr))
+		return NULL;
+	mmu_tlb_hits++;
+	return e->host + (addr & mmu_pagemask);
+}
+
+/* addr hit the ATC line cl, remember the page if it is plain memory */
+static ALWAYS_INLINE void mmu_tlb_fill (uaecptr addr, int type, struct mmu_atc_line *cl)
+{
+	struct mmu_tlb_entry *e = &mmu_tlb[type][(addr >> 12) & (MMU_TLB_SIZE - 1)];
+	uae_u8 *p;
+
+	mmu_tlb_misses++;
+	if (type == MMU_TLB_DWRITE) {
+		if (!cl->modified || cl->write_protect)
+			return;
+		p = mem_direct_wptr (cl->phys);
+	} else {
+		p = mem_direct_rptr (cl->phys);
+	}
+	if (!p)
+		return;
+	e->tag = mmu_tlb_tag (addr);
+	e->host = p + (cl->phys & 0xffff);
+}
+
 /*
  * mmu access is a 4 step process:
  * if mmu is not enabled just read physical
@@ -226,6 +289,7 @@ static ALWAYS_INLINE bool mmu_lookup(uaecptr addr, bool data, bool write,
 	}
 	// we select a random way to void
 	*cl=&mmu_atc_array[data][way_miss%ATC_WAYS][index];
+	mmu_tlb_evict(*cl, index);
 	(*cl)->tag = tag;
 	way_miss++;
 	return false;
@@ -259,6 +323,7 @@ static ALWAYS_INLINE bool mmu_user_lookup(uaecptr addr, bool super, bool data,
 	}
 	// we select a random way to void
 	*cl=&mmu_atc_array[data][way_miss%ATC_WAYS][index];
+	mmu_tlb_evict(*cl, index);
 	(*cl)->tag = tag;
 	way_miss++;
 	return false;
@@ -391,82 +456,124 @@ extern void mmu_put_move16(uaecptr addr, uae_u32 *val, bool data, int size);
 static ALWAYS_INLINE uae_u32 mmu_get_long(uaecptr addr, bool data, int size, bool rmw)
 {
 	struct mmu_atc_line *cl;
+	uae_u8 *p = mmu_tlb_lookup(addr, data ? MMU_TLB_DREAD : MMU_TLB_IREAD);
 
+	if (p)
+		return do_get_mem_long ((uae_u32 *)p);
 	//                                       addr,super,data
 	if ((!regs.mmu_enabled) || (mmu_match_ttr(addr,regs.s != 0,data,rmw)!=TTR_NO_MATCH))
 		return phys_get_long(addr);
-	if (likely(mmu_lookup(addr, data, false, &cl)))
+	if (likely(mmu_lookup(addr, data, false, &cl))) {
+		mmu_tlb_fill(addr, data ? MMU_TLB_DREAD : MMU_TLB_IREAD, cl);
 		return phys_get_long(mmu_get_real_address(addr, cl));
+	}
 	return mmu_get_long_slow(addr, regs.s != 0, data, size, rmw, cl);
 }
 
 static ALWAYS_INLINE uae_u16 mmu_get_word(uaecptr addr, bool data, int size, bool rmw)
 {
 	struct mmu_atc_line *cl;
+	uae_u8 *p = mmu_tlb_lookup(addr, data ? MMU_TLB_DREAD : MMU_TLB_IREAD);
 
+	if (p)
+		return do_get_mem_word ((uae_u16 *)p);
 	//                                       addr,super,data
 	if ((!regs.mmu_enabled) || (mmu_match_ttr(addr,regs.s != 0,data,rmw)!=TTR_NO_MATCH))
 		return phys_get_word(addr);
-	if (likely(mmu_lookup(addr, data, false, &cl)))
+	if (likely(mmu_lookup(addr, data, false, &cl))) {
+		mmu_tlb_fill(addr, data ? MMU_TLB_DREAD : MMU_TLB_IREAD, cl);
 		return phys_get_word(mmu_get_real_address(addr, cl));
+	}
 	return mmu_get_word_slow(addr, regs.s != 0, data, size, rmw, cl);
 }
 
 static ALWAYS_INLINE uae_u8 mmu_get_byte(uaecptr addr, bool data, int size, bool rmw)
 {
 	struct mmu_atc_line *cl;
+	uae_u8 *p = mmu_tlb_lookup(addr, data ? MMU_TLB_DREAD : MMU_TLB_IREAD);
 
+	if (p)
+		return *p;
 	//                                       addr,super,data
 	if ((!regs.mmu_enabled) || (mmu_match_ttr(addr,regs.s != 0,data,rmw)!=TTR_NO_MATCH))
 		return phys_get_byte(addr);
-	if (likely(mmu_lookup(addr, data, false, &cl)))
+	if (likely(mmu_lookup(addr, data, false, &cl))) {
+		mmu_tlb_fill(addr, data ? MMU_TLB_DREAD : MMU_TLB_IREAD, cl);
 		return phys_get_byte(mmu_get_real_address(addr, cl));
+	}
 	return mmu_get_byte_slow(addr, regs.s != 0, data, size, rmw, cl);
 }
 
 static ALWAYS_INLINE void mmu_put_long(uaecptr addr, uae_u32 val, bool data, int size, bool rmw)
 {
 	struct mmu_atc_line *cl;
+	uae_u8 *p = data ? mmu_tlb_lookup(addr, MMU_TLB_DWRITE) : NULL;
+
+	if (p) {
+		do_put_mem_long ((uae_u32 *)p, val);
+		return;
+	}
 
 	//                                        addr,super,data
 	if ((!regs.mmu_enabled) || mmu_match_ttr_write(addr,regs.s != 0,data,val,size,rmw)==TTR_OK_MATCH) {
 		phys_put_long(addr,val);
 		return;
 	}
-	if (likely(mmu_lookup(addr, data, true, &cl)))
+	if (likely(mmu_lookup(addr, data, true, &cl))) {
+		if (data)
+			mmu_tlb_fill(addr, MMU_TLB_DWRITE, cl);
 		phys_put_long(mmu_get_real_address(addr, cl), val);
-	else
+	} else {
 		mmu_put_long_slow(addr, val, regs.s != 0, data, size, rmw, cl);
+	}
 }
 
 static ALWAYS_INLINE void mmu_put_word(uaecptr addr, uae_u16 val, bool data, int size, bool rmw)
 {
 	struct mmu_atc_line *cl;
+	uae_u8 *p = data ? mmu_tlb_lookup(addr, MMU_TLB_DWRITE) : NULL;
+
+	if (p) {
+		do_put_mem_word ((uae_u16 *)p, val);
+		return;
+	}
 
 	//                                        addr,super,data
 	if ((!regs.mmu_enabled) || (mmu_match_ttr_write(addr,regs.s != 0,data,val,size,rmw)==TTR_OK_MATCH)) {
 		phys_put_word(addr,val);
 		return;
 	}
-	if (likely(mmu_lookup(addr, data, true, &cl)))
+	if (likely(mmu_lookup(addr, data, true, &cl))) {
+		if (data)
+			mmu_tlb_fill(addr, MMU_TLB_DWRITE, cl);
 		phys_put_word(mmu_get_real_address(addr, cl), val);
-	else
+	} else {
 		mmu_put_word_slow(addr, val, regs.s != 0, data, size, rmw, cl);
+	}
 }
 
 static ALWAYS_INLINE void mmu_put_byte(uaecptr addr, uae_u8 val, bool data, int size, bool rmw)
 {
 	struct mmu_atc_line *cl;
+	uae_u8 *p = data ? mmu_tlb_lookup(addr, MMU_TLB_DWRITE) : NULL;
+
+	if (p) {
+		*p = val;
+		return;
+	}
 
 	//                                        addr,super,data
 	if ((!regs.mmu_enabled) || (mmu_match_ttr_write(addr,regs.s != 0,data,val,size,rmw)==TTR_OK_MATCH)) {
 		phys_put_byte(addr,val);
 		return;
 	}
-	if (likely(mmu_lookup(addr, data, true, &cl)))
+	if (likely(mmu_lookup(addr, data, true, &cl))) {
+		if (data)
+			mmu_tlb_fill(addr, MMU_TLB_DWRITE, cl);
 		phys_put_byte(mmu_get_real_address(addr, cl), val);
-	else
+	} else {
 		mmu_put_byte_slow(addr, val, regs.s != 0, data, size, rmw, cl);
+	}
 }
 
 static ALWAYS_INLINE uae_u32 mmu_get_user_long(uaecptr addr, bool super, bool data, bool write, int size)
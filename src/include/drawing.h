@@ -11,6 +11,17 @@
 #define SMART_UPDATE 1
 #endif
 
+/* With configure --enable-render-threads the per-line drawing state is
+ * thread local so that frame bands can be drawn in parallel
+ * (gfx_render_threads). */
+#if defined (RENDER_THREADS) && defined (SMART_UPDATE) && defined (__GNUC__)
+#define RENDER_TLS __thread
+#define MAX_RENDER_THREADS 8
+#else
+#undef RENDER_THREADS
+#define RENDER_TLS
+#endif
+
 #ifdef AGA
 #define MAX_PLANES 8
 #else
@@ -277,6 +288,7 @@ extern bool vsync_handle_check (void);
 extern void init_hardware_for_drawing_frame (void);
 extern void reset_drawing (void);
 extern void drawing_init (void);
+extern void drawing_free (void);
 extern bool notice_interlace_seen (bool);
 extern void notice_resolution_seen (int, bool);
 extern void frame_drawn (void);
@@ -287,6 +299,12 @@ extern void set_custom_limits (int w, int h, int dx, int dy);
 extern void get_custom_topedge (int *x, int *y, bool max);
 extern void putpixel (uae_u8 *buf, int bpp, int x, xcolnr c8, int opaq);
 
+extern void drawing_dummy_flush (bool enable);
+
+/* p2c_simd.c */
+extern void p2c_simd_init (int level);
+extern int p2c_simd (uae_u32 *pixels, uae_u8 **bplpt, int planes, int wordcount);
+
 /* Finally, stuff that shouldn't really be shared.  */
 
 extern int thisframe_first_drawn_line, thisframe_last_drawn_line;
@@ -69,6 +69,10 @@ struct ev2
     evt evtime;
     uae_u32 data;
     evfunc2 handler;
+    /* scheduler internals, see events.c */
+    int heap;
+    uae_u32 seq;
+    struct ev2 *next, **prevp;
 };
 
 enum {
@@ -76,9 +80,10 @@ enum {
     ev_max
 };
 
+/* fixed event2 slots, anything else goes through event2_newevent2 () */
 enum {
-    ev2_blitter, ev2_disk, ev2_misc,
-    ev2_max = 12
+    ev2_blitter, ev2_disk,
+    ev2_max
 };
 
 extern int pissoff_value;
@@ -142,6 +147,10 @@ STATIC_INLINE bool cycles_in_range (unsigned long endcycles)
 
 extern void MISC_handler (void);
 extern void event2_newevent_xx (int no, evt t, uae_u32 data, evfunc2 func);
+extern void event2_remevent (int no);
+extern void event2_reset (void);
+extern void event2_flush (void);
+extern struct ev2 *event2_get (int i);
 
 STATIC_INLINE void event2_newevent_x (int no, evt t, uae_u32 data, evfunc2 func)
 {
@@ -161,10 +170,5 @@ STATIC_INLINE void event2_newevent2 (evt t, uae_u32 data, evfunc2 func)
 	event2_newevent_x (-1, t, data, func);
 }
 
-STATIC_INLINE void event2_remevent (int no)
-{
-	eventtab2[no].active = 0;
-}
-
 
 #endif
@@ -11,6 +11,7 @@
 #define FILESYS_H
 
 struct hardfilehandle;
+struct hdf_cachectl;
 struct mountedinfo;
 struct uaedev_config_info;
 struct uae_prefs;
@@ -70,6 +71,7 @@ struct hardfiledata {
     TCHAR *emptyname;
 
 	struct hdf_cache bcache[MAX_HDF_CACHE_BLOCKS];
+	struct hdf_cachectl *cachectl;
 	uae_u8 scsi_sense[MAX_SCSI_SENSE];
 
 	struct uaedev_config_info delayedci;
@@ -128,6 +130,7 @@ void hdf_close (struct hardfiledata *hfd);
 int hdf_read_rdb (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 int hdf_read (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 int hdf_write (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
+int hdf_flush (struct hardfiledata *hfd);
 int hdf_getnumharddrives (void);
 TCHAR *hdf_getnameharddrive (int index, int flags, int *sectorsize, int *dangerousdrive);
 int isspecialdrive(const TCHAR *name);
@@ -149,6 +152,9 @@ void hdf_close_target (struct hardfiledata *hfd);
 int hdf_read_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 int hdf_write_target (struct hardfiledata *hfd, void *buffer, uae_u64 offset, int len);
 int hdf_resize_target (struct hardfiledata *hfd, uae_u64 newsize);
+int hdf_flush_target (struct hardfiledata *hfd);
+bool hdf_mapped_target (struct hardfiledata *hfd);
+void hdf_unmap_target (struct hardfiledata *hfd);
 void getchsgeometry (uae_u64 size, int *pcyl, int *phead, int *psectorspertrack);
 void getchsgeometry_hdf (struct hardfiledata *hfd, uae_u64 size, int *pcyl, int *phead, int *psectorspertrack);
 void getchspgeometry (uae_u64 total, int *pcyl, int *phead, int *psectorspertrack, bool idegeometry);
@@ -0,0 +1,130 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * MC68881 emulation
+  *
+  * fpu_fast versions of FSIN, FCOS and FETOX: argument reduction and
+  * the polynomials from fdlibm, inlined. Large or special arguments go
+  * to libm.
+  */
+
+#include <math.h>
+
+/* The error terms below only work when evaluated as written. -ffast-math
+ * (configure's default with GCC) lets the compiler reassociate them into
+ * zeros, so these functions are compiled without associative math. GCC
+ * drops the attribute when it force-inlines, hence plain static. */
+#if defined(__GNUC__) && !defined(__clang__)
+#define FPP_FAST_STRICT __attribute__ ((optimize ("no-associative-math")))
+#else
+#define FPP_FAST_STRICT
+#endif
+
+static FPP_FAST_STRICT int fast_exponent (double x)
+{
+	union {
+		double d;
+		uae_u64 u;
+	} v;
+
+	v.d = x;
+	return (int)(v.u >> 52) & 0x7ff;
+}
+
+/* x - n * pi/2 as hi + lo, the medium size case of fdlibm
+ * __ieee754_rem_pio2: pi/2 is split into 33-bit parts so fn * part is
+ * exact, and a further part (with the tail of the previous step carried
+ * over) is only subtracted when the last step cancelled enough bits to
+ * make it exact. Good to ~150 bits for |n| < 2^20. */
+static FPP_FAST_STRICT int fast_rem_pio2 (double x, double *hi, double *lo)
+{
+	double fn, r, t, w;
+	int n, j;
+
+	n = (int)(x * 6.36619772367581382433e-01 + (x < 0 ? -0.5 : 0.5));
+	fn = (double)n;
+	r = x - fn * 1.57079632673412561417e+00;
+	w = fn * 6.07710050650619224932e-11;
+	*hi = r - w;
+	j = fast_exponent (x);
+	if (j - fast_exponent (*hi) > 16) {
+		t = r;
+		w = fn * 6.07710050630396597660e-11;
+		r = t - w;
+		w = fn * 2.02226624879595063154e-21 - ((t - r) - w);
+		*hi = r - w;
+		if (j - fast_exponent (*hi) > 49) {
+			t = r;
+			w = fn * 2.02226624871116645580e-21;
+			r = t - w;
+			w = fn * 8.47842766036889956997e-32 - ((t - r) - w);
+			*hi = r - w;
+		}
+	}
+	*lo = (r - *hi) - w;
+	return n;
+}
+
+/* sin (x + y) and cos (x + y) for |x + y| <= pi/4, y the tail of x */
+static FPP_FAST_STRICT double fast_kernel_sin (double x, double y)
+{
+	double z = x * x, w = z * z, v = z * x, r;
+
+	r = 8.33333333332248946124e-03 + z * (-1.98412698298579493134e-04 + z * 2.75573137070700676789e-06)
+		+ z * w * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10);
+	return x - ((z * (0.5 * y - v * r) - y) - v * -1.66666666666666324348e-01);
+}
+
+static FPP_FAST_STRICT double fast_kernel_cos (double x, double y)
+{
+	double z = x * x, w = z * z, hz, r;
+
+	r = z * (4.16666666666666019037e-02 + z * (-1.38888888888741095749e-03 + z * 2.48015872894767294178e-05))
+		+ w * w * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 + z * -1.13596475577881948265e-11));
+	hz = 0.5 * z;
+	w = 1.0 - hz;
+	return w + (((1.0 - w) - hz) + (z * r - x * y));
+}
+
+/* quadrant 0 is sin (x), 1 is cos (x) */
+static FPP_FAST_STRICT double fast_sincos (double x, int quadrant)
+{
+	double hi, lo, v;
+	int n;
+
+	if (!(x > -1.0e5 && x < 1.0e5))
+		return quadrant ? cos (x) : sin (x);
+	if (x == 0)
+		return quadrant ? 1.0 : x;
+	n = fast_rem_pio2 (x, &hi, &lo) + quadrant;
+	v = (n & 1) ? fast_kernel_cos (hi, lo) : fast_kernel_sin (hi, lo);
+	return (n & 2) ? -v : v;
+}
+
+#define fast_sin(x) fast_sincos (x, 0)
+#define fast_cos(x) fast_sincos (x, 1)
+
+static FPP_FAST_STRICT double fast_exp (double x)
+{
+	double hi, lo, r, t, c, y;
+	union {
+		double d;
+		uae_u64 u;
+	} scale;
+	int k;
+
+	if (!(x > -708.0 && x < 709.0))
+		return exp (x);
+	k = (int)(x * 1.44269504088896338700e+00 + (x < 0 ? -0.5 : 0.5));
+	hi = x - k * 6.93147180369123816490e-01;
+	lo = k * 1.90821492927058770002e-10;
+	r = hi - lo;
+	t = r * r;
+	c = r - t * (1.66666666666666019037e-01 + t * (-2.77777777770155933842e-03
+		+ t * (6.61375632143793436117e-05 + t * (-1.65339022054652515390e-06
+		+ t * 4.13813679705723846039e-08))));
+	y = 1.0 - ((lo - (r * c) / (2.0 - c)) - hi);
+	/* |k| <= 1022 here, 2^k is a normal number */
+	scale.u = (uae_u64)(k + 1023) << 52;
+	return y * scale.d;
+}
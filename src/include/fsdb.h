@@ -106,6 +106,12 @@ typedef struct a_inode_struct {
     /* not equaling unit.mountcount -> not in this volume */
     unsigned int mountcount;
 	uae_u64 uniq_external;
+	/* In-memory copy of this directory's database (fsdb.c).  */
+	struct fsdb_index *fsdb;
+	/* Hashed children of this directory, and our own chains in the
+	 * parent's table (filesys.c).  */
+	struct aino_childhash *childhash;
+	struct a_inode_struct *ahash_next, *nhash_next;
 #ifdef AINO_DEBUG
     uae_u32 checksum2;
 #endif
@@ -142,6 +148,8 @@ extern TCHAR *build_aname (const TCHAR *d, const TCHAR *n);
 extern void fsdb_clean_dir (a_inode *);
 extern TCHAR *fsdb_search_dir (const TCHAR *dirname, TCHAR *rel);
 extern void fsdb_dir_writeback (a_inode *);
+extern void fsdb_dir_free (a_inode *);
+extern unsigned int fsdb_name_hash (const TCHAR *, int nocase);
 extern int fsdb_used_as_nname (a_inode *base, const TCHAR *);
 extern a_inode *fsdb_lookup_aino_aname (a_inode *base, const TCHAR *);
 extern a_inode *fsdb_lookup_aino_nname (a_inode *base, const TCHAR *);
@@ -181,6 +189,7 @@ extern void my_close (struct my_openfile_s*);
 extern uae_s64 my_lseek (struct my_openfile_s*, uae_s64, int);
 extern uae_s64 my_fsize (struct my_openfile_s*);
 extern int my_read (struct my_openfile_s*, void*, unsigned int);
+extern int my_pread (struct my_openfile_s*, void*, unsigned int, uae_s64);
 extern int my_write (struct my_openfile_s*, void*, unsigned int);
 extern int my_truncate (const TCHAR *name, uae_u64 len);
 extern int dos_errno (void);
@@ -189,6 +198,7 @@ extern int my_existsdir (const TCHAR *name);
 extern FILE *my_opentext (const TCHAR*);
 
 extern bool my_stat (const TCHAR *name, struct mystat *ms);
+extern bool my_statat (struct my_opendir_s *dir, const TCHAR *name, struct mystat *ms);
 extern bool my_utime (const TCHAR *name, struct mytimeval *tv);
 extern bool my_chmod (const TCHAR *name, uae_u32 mode);
 extern bool my_resolveshortcut(TCHAR *linkfile, int size);
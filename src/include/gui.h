@@ -62,6 +62,8 @@ struct gui_info
 	int fps, idle;
 	int fps_color;
 	int sndbuf, sndbuf_status;
+	int sndbuf_underruns, sndbuf_overruns;
+	bool statesave;			/* state save being written */
 	TCHAR df[4][256];		/* inserted image */
 	uae_u32 crc32[4];		/* crc32 of image */
 };
@@ -85,6 +87,7 @@ extern void gui_update_gfx (void);
 #define NUMSG_KS68020       "The selected system ROM requires a 68020 with 32-bit addressing or 68030 or higher CPU."
 #define NUMSG_ROMNEED       "One of the following system ROMs is required:\n\n%s\n\nCheck the System ROM path in the Paths panel and click Rescan ROMs."
 #define NUMSG_STATEHD       "WARNING: Current configuration is not fully compatible with state saves.\nThis message will not appear again."
+#define NUMSG_STATESAVEFAIL "Could not write state file\n%s\nThe file is incomplete."
 #define NUMSG_NOCAPS        "Selected disk image needs the SPS plugin\nwhich is available from\nhttp//www.softpres.org/"
 #define NUMSG_OLDCAPS       "You need an updated SPS plugin\nwhich is available from\nhttp//www.softpres.org/"
 #define NUMSG_KS68EC020     "The selected system ROM requires a 68020 with 24-bit addressing or higher CPU."
@@ -104,8 +104,27 @@ typedef struct {
 //FIXME: uae_u32 startmask;
 	uae_u32 start;
 	uae_u32 allocated;
+	/* rewind capture dirty pages, see memory_dirty () */
+	uae_u8 *dirty;
 } addrbank;
 
+/* While savestate.c tracks a RAM bank for rewind, ab->dirty has one byte
+ * per RAM_DIRTY_PAGE and every write to the bank sets the byte of its
+ * page. Writes through host pointers must call memory_dirty_address (). */
+#define RAM_DIRTY_SHIFT 12
+#define RAM_DIRTY_PAGE (1 << RAM_DIRTY_SHIFT)
+
+STATIC_INLINE void memory_dirty (addrbank *ab, uae_u32 offset)
+{
+	if (ab->dirty)
+		ab->dirty[offset >> RAM_DIRTY_SHIFT] = 1;
+}
+
+extern bool memory_dirty_alloc (addrbank *ab);
+extern void memory_dirty_free (addrbank *ab);
+extern bool memory_dirty_untracked (void);
+extern void memory_dirty_address (uaecptr addr, uae_u32 size);
+
 #define CE_MEMBANK_FAST32 0
 #define CE_MEMBANK_CHIP16 1
 #define CE_MEMBANK_CHIP32 2
@@ -150,6 +169,8 @@ static void REGPARAM2 name ## _lput (uaecptr addr, uae_u32 l) \
 	addr &= name ## _bank.mask; \
 	m = name ## _bank.baseaddr + addr; \
 	do_put_mem_long ((uae_u32 *)m, l); \
+	memory_dirty (&name ## _bank, addr); \
+	memory_dirty (&name ## _bank, addr + 3); \
 }
 #define MEMORY_WPUT(name) \
 static void REGPARAM3 name ## _wput (uaecptr, uae_u32) REGPARAM; \
@@ -160,6 +181,8 @@ static void REGPARAM2 name ## _wput (uaecptr addr, uae_u32 w) \
 	addr &= name ## _bank.mask; \
 	m = name ## _bank.baseaddr + addr; \
 	do_put_mem_word ((uae_u16 *)m, w); \
+	memory_dirty (&name ## _bank, addr); \
+	memory_dirty (&name ## _bank, addr + 1); \
 }
 #define MEMORY_BPUT(name) \
 static void REGPARAM3 name ## _bput (uaecptr, uae_u32) REGPARAM; \
@@ -168,6 +191,7 @@ static void REGPARAM2 name ## _bput (uaecptr addr, uae_u32 b) \
 	addr -= name ## _bank.start & name ## _bank.mask; \
 	addr &= name ## _bank.mask; \
 	name ## _bank.baseaddr[addr] = b; \
+	memory_dirty (&name ## _bank, addr); \
 }
 #define MEMORY_CHECK(name) \
 static int REGPARAM3 name ## _check (uaecptr addr, uae_u32 size) REGPARAM; \
@@ -258,17 +282,34 @@ extern uae_u8 *baseaddr[MEMORY_BANKS];
 
 #define get_mem_bank(addr) (*mem_banks[bankindex(addr)])
 
+/* Host address of the start of each 64k bank if the CPU can access it
+ * without going through the bank handlers (plain RAM, ROM for reads),
+ * NULL otherwise. There is no write pointer while the bank has a rewind
+ * dirty map. Kept in sync by map_banks (), code that patches the
+ * handlers of a mapped bank must call memory_direct_refresh (). */
+extern uae_u8 *mem_direct_r[MEMORY_BANKS];
+extern uae_u8 *mem_direct_w[MEMORY_BANKS];
+extern void mem_direct_set (int bnr, addrbank *b);
+extern void memory_direct_refresh (void);
+#ifdef FULLMMU
+/* 68040/060 MMU software TLB caches mem_direct_* pointers */
+extern void mmu_tlb_flush (void);
+#endif
+
 #ifdef JIT
 #define put_mem_bank(addr, b, realstart) { \
 	(mem_banks[bankindex(addr)] = (b)); \
+	mem_direct_set (bankindex(addr), (b)); \
 	if ((b)->baseaddr) \
 	baseaddr[bankindex(addr)] = (b)->baseaddr - (realstart); \
 	else \
 	baseaddr[bankindex(addr)] = (uae_u8*)(((uae_u8*)b)+1); \
 }
 #else
-#define put_mem_bank(addr, b, realstart) \
-	(mem_banks[bankindex(addr)] = (b));
+#define put_mem_bank(addr, b, realstart) { \
+	(mem_banks[bankindex(addr)] = (b)); \
+	mem_direct_set (bankindex(addr), (b)); \
+}
 #endif
 
 extern void memory_init (void);
@@ -290,24 +331,42 @@ extern void free_fastmemory (void);
 #define wordput(addr,w) (call_mem_put_func(get_mem_bank(addr).wput, addr, w))
 #define byteput(addr,b) (call_mem_put_func(get_mem_bank(addr).bput, addr, b))
 
+#define mem_direct_rptr(addr) (mem_direct_r[bankindex(addr)])
+#define mem_direct_wptr(addr) (mem_direct_w[bankindex(addr)])
+
 STATIC_INLINE uae_u32 get_long (uaecptr addr)
 {
+	uae_u8 *m = mem_direct_rptr (addr);
+	if (m)
+		return do_get_mem_long ((uae_u32 *)(m + (addr & 0xffff)));
 	return longget (addr);
 }
 STATIC_INLINE uae_u32 get_word (uaecptr addr)
 {
+	uae_u8 *m = mem_direct_rptr (addr);
+	if (m)
+		return do_get_mem_word ((uae_u16 *)(m + (addr & 0xffff)));
 	return wordget (addr);
 }
 STATIC_INLINE uae_u32 get_byte (uaecptr addr)
 {
+	uae_u8 *m = mem_direct_rptr (addr);
+	if (m)
+		return m[addr & 0xffff];
 	return byteget (addr);
 }
 STATIC_INLINE uae_u32 get_longi(uaecptr addr)
 {
+	uae_u8 *m = mem_direct_rptr (addr);
+	if (m)
+		return do_get_mem_long ((uae_u32 *)(m + (addr & 0xffff)));
 	return longgeti (addr);
 }
 STATIC_INLINE uae_u32 get_wordi(uaecptr addr)
 {
+	uae_u8 *m = mem_direct_rptr (addr);
+	if (m)
+		return do_get_mem_word ((uae_u16 *)(m + (addr & 0xffff)));
 	return wordgeti (addr);
 }
 
@@ -343,15 +402,27 @@ STATIC_INLINE void *get_pointer (uaecptr addr)
 
 STATIC_INLINE void put_long (uaecptr addr, uae_u32 l)
 {
-	longput(addr, l);
+	uae_u8 *m = mem_direct_wptr (addr);
+	if (m)
+		do_put_mem_long ((uae_u32 *)(m + (addr & 0xffff)), l);
+	else
+		longput(addr, l);
 }
 STATIC_INLINE void put_word (uaecptr addr, uae_u32 w)
 {
-	wordput(addr, w);
+	uae_u8 *m = mem_direct_wptr (addr);
+	if (m)
+		do_put_mem_word ((uae_u16 *)(m + (addr & 0xffff)), w);
+	else
+		wordput(addr, w);
 }
 STATIC_INLINE void put_byte (uaecptr addr, uae_u32 b)
 {
-	byteput(addr, b);
+	uae_u8 *m = mem_direct_wptr (addr);
+	if (m)
+		m[addr & 0xffff] = b;
+	else
+		byteput(addr, b);
 }
 
 extern void put_long_slow (uaecptr addr, uae_u32 v);
@@ -410,6 +481,7 @@ extern void REGPARAM3 chipmem_bput (uaecptr, uae_u32) REGPARAM;
 
 extern uae_u32 REGPARAM3 chipmem_agnus_wget (uaecptr) REGPARAM;
 extern void REGPARAM3 chipmem_agnus_wput (uaecptr, uae_u32) REGPARAM;
+extern uae_u8 *chipmem_agnus_direct (uae_u32 *size);
 
 extern addrbank dummy_bank;
 
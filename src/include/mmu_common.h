@@ -36,7 +36,9 @@ extern int     __exvalue;
 #define THROW_AGAIN(var) if (__is_catched()) longjmp(*__poptry(),__exvalue)
 */
 #define TRY(DUMMY)
-#define CATCH(x)
+/* THROW aborts, so the handler is never entered, but it must not run
+ * after the TRY block either */
+#define CATCH(x) if (0)
 #define ENDTRY
 #define THROW(x) { fprintf(stderr,"Longjumping %s in %d\n",__FILE__,__LINE__);abort(); }
 #define THROW_AGAIN(var)
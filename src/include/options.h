@@ -332,6 +332,7 @@ struct uae_prefs {
 	int sound_mixed_stereo_delay;
 	int sound_freq;
 	int sound_maxbsiz;
+	int sound_latency;
 	int sound_interpol;
 	int sound_filter;
 	int sound_filter_type;
@@ -366,6 +367,7 @@ struct uae_prefs {
 	bool avoid_cmov;
 
 	int gfx_framerate, gfx_autoframerate;
+	int gfx_render_threads;
 	struct wh gfx_size_win;
 	struct wh gfx_size_fs;
 	struct wh gfx_size;
@@ -427,6 +429,8 @@ struct uae_prefs {
 	int floppy_random_bits_min;
 	int floppy_random_bits_max;
 	int floppy_auto_ext2;
+	int floppy_track_cache;
+	bool floppy_track_cache_preload;
 	bool tod_hack;
 	uae_u32 maprom;
 	bool rom_readwrite;
@@ -435,6 +439,10 @@ struct uae_prefs {
 	int filesys_limit;
 	unsigned int filesys_max_name;
 	int filesys_max_file_size;
+	int hardfile_cache;
+	int hardfile_readahead;
+	int hardfile_writeback;
+	bool hardfile_mmap;
 
 	int cs_compatible;
 	int cs_ciaatod;
@@ -514,6 +522,7 @@ struct uae_prefs {
 	bool cpu_compatible;
 	bool int_no_unimplemented;
 	bool fpu_no_unimplemented;
+	bool fpu_fast;
 	bool address_space_24;
 	bool picasso96_nocustom;
 	int picasso96_modeflags;
@@ -596,6 +605,7 @@ struct uae_prefs {
 #ifdef SAVESTATE
 	bool statecapture;
 	int statecapturerate, statecapturebuffersize;
+	int statecapturekeyframe, statecapturememory;
 #endif
 
 	/* input */
@@ -730,6 +730,19 @@ void picasso_handle_hsync (void);
 void picasso_handle_vsync (void);
 void picasso_trigger_vblank (void);
 void picasso_reset (void);
+void picasso_allocatewritewatch (int gfxmemsize);
+void picasso_getwritewatch (int offset);
+bool picasso_is_vram_dirty (uaecptr addr, int size);
+void picasso_dirty_address (uaecptr addr, uae_u32 size);
+
+/* rtg_simd.c */
+extern void rtg_simd_init (int level);
+extern int rtg_simd_clut32 (uae_u32 *dst, const uae_u8 *src, const uae_u32 *clut, int width);
+extern int rtg_simd_rgb16to32 (uae_u32 *dst, const uae_u16 *src, const uae_u32 *table, int width);
+extern int rtg_simd_swizzle (uae_u32 *dst, const uae_u8 *src, int srcbytes, int r, int g, int b, int width);
+extern int rtg_simd_fill (uae_u8 *dst, uae_u32 pen, int bpp, int bytes);
+extern int rtg_simd_xor (uae_u8 *dst, uae_u32 v, int bytes);
+extern bool rtg_simd_blit (BLIT_OPCODE opcode, uae_u8 *src, uae_u8 *dst, int bytes, int height, int srcpitch, int dstpitch);
 int picasso_setwincursor (void);
 int picasso_palette (void);
 void uaegfx_install_code (uaecptr start);
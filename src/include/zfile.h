@@ -40,6 +40,13 @@ struct fs_filehandle
 		struct my_openfile_s *of;
 		struct cd_openfile_s *isof;
 //	};
+	/* filesys.c read-ahead, directory mounts only */
+	uae_u8 *rabuf;
+	unsigned int ralen;
+	uae_s64 rapos, ranext;
+	/* host file position to seek to before the next positioned call */
+	uae_s64 hostpos;
+	bool hostpos_pending;
 };
 
 extern struct zfile *zfile_fopen (const TCHAR *, const TCHAR *, int mask);
@@ -65,6 +72,7 @@ extern size_t zfile_fputs (struct zfile *z, const TCHAR *s);
 extern int zfile_getc (struct zfile *z);
 extern int zfile_putc (int c, struct zfile *z);
 extern int zfile_ferror (struct zfile *z);
+extern int zfile_fflush (struct zfile *z);
 extern uae_u8 *zfile_getdata (struct zfile *z, uae_s64 offset, int len);
 extern void zfile_exit (void);
 extern int execute_command (TCHAR *);
@@ -27,6 +27,7 @@
 #include "disk.h"
 #include "debug.h"
 #include "xwin.h"
+#include "drawing.h"
 #include "inputdevice.h"
 #include "keybuf.h"
 #include "gui.h"
@@ -60,6 +61,8 @@
 #include "misc.h"
 #include "keyboard.h"
 #include "tabletlibrary.h"
+#include "inputrecord.h"
+#include "benchmark.h"
 #ifdef RETROPLATFORM
 #include "rp.h"
 #endif
@@ -812,6 +815,17 @@ static void parse_cmdline (int argc, TCHAR **argv)
 			write_log (_T("Option -statefile ignored:\n"));
 			write_log (_T("-> puae has been configured with --disable-save-state\n"));
 #endif // SAVESTATE
+		} else if (_tcsncmp (argv[i], _T("-playback="), 10) == 0) {
+			TCHAR *txt = parsetextpath (argv[i] + 10);
+			_tcsncpy (currprefs.inprecfile, txt, MAX_DPATH - 1);
+			input_play = INPREC_PLAY_NORMAL;
+			xfree (txt);
+		} else if (_tcsncmp (argv[i], _T("-benchmark="), 11) == 0) {
+			bench_setup (_tstol (argv[i] + 11));
+		} else if (_tcsncmp (argv[i], _T("-benchmark_json="), 16) == 0) {
+			TCHAR *txt = parsetextpath (argv[i] + 16);
+			bench_set_output (txt);
+			xfree (txt);
 		} else if (_tcscmp (argv[i], _T("-f")) == 0) {
 			/* Check for new-style "-f xxx" argument, where xxx is config-file */
 			if (i + 1 == argc) {
@@ -970,6 +984,7 @@ void do_leave_program (void)
 #ifdef SAMPLER
 	sampler_free ();
 #endif
+	drawing_free ();
 	graphics_leave ();
 	inputdevice_close ();
 	DISK_free ();
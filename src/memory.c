@@ -35,6 +35,7 @@
 #include "misc.h"
 #include "zfile.h"
 #include "gfxboard.h"
+#include "picasso96.h"
 #include <sys/mman.h>
 
 extern uae_u8 *natmem_offset, *natmem_offset_end;
@@ -147,6 +148,9 @@ addrbank *mem_banks[MEMORY_BANKS];
 
 uae_u8 *baseaddr[MEMORY_BANKS];
 
+uae_u8 *mem_direct_r[MEMORY_BANKS];
+uae_u8 *mem_direct_w[MEMORY_BANKS];
+
 #ifdef NO_INLINE_MEMORY_ACCESS
 __inline__ uae_u32 longget (uaecptr addr)
 {
@@ -474,6 +478,8 @@ static void REGPARAM2 chipmem_lput_ce2 (uaecptr addr, uae_u32 l)
 	m = (uae_u32 *)(chipmem_bank.baseaddr + addr);
 	ce2_timeout ();
 	do_put_mem_long (m, l);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 3);
 }
 
 static void REGPARAM2 chipmem_wput_ce2 (uaecptr addr, uae_u32 w)
@@ -487,6 +493,8 @@ static void REGPARAM2 chipmem_wput_ce2 (uaecptr addr, uae_u32 w)
 	m = (uae_u16 *)(chipmem_bank.baseaddr + addr);
 	ce2_timeout ();
 	do_put_mem_word (m, w);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 1);
 }
 
 static void REGPARAM2 chipmem_bput_ce2 (uaecptr addr, uae_u32 b)
@@ -497,6 +505,7 @@ static void REGPARAM2 chipmem_bput_ce2 (uaecptr addr, uae_u32 b)
 	addr &= chipmem_bank.mask;
 	ce2_timeout ();
 	chipmem_bank.baseaddr[addr] = b;
+	memory_dirty (&chipmem_bank, addr);
 }
 
 #endif
@@ -535,6 +544,8 @@ void REGPARAM2 chipmem_lput (uaecptr addr, uae_u32 l)
 	addr &= chipmem_bank.mask;
 	m = (uae_u32 *)(chipmem_bank.baseaddr + addr);
 	do_put_mem_long (m, l);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 3);
 }
 
 void REGPARAM2 chipmem_wput (uaecptr addr, uae_u32 w)
@@ -544,12 +555,15 @@ void REGPARAM2 chipmem_wput (uaecptr addr, uae_u32 w)
 	addr &= chipmem_bank.mask;
 	m = (uae_u16 *)(chipmem_bank.baseaddr + addr);
 	do_put_mem_word (m, w);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 1);
 }
 
 void REGPARAM2 chipmem_bput (uaecptr addr, uae_u32 b)
 {
 	addr &= chipmem_bank.mask;
 	chipmem_bank.baseaddr[addr] = b;
+	memory_dirty (&chipmem_bank, addr);
 }
 
 /* cpu chipmem access inside agnus addressable ram but no ram available */
@@ -637,6 +651,8 @@ static void REGPARAM2 chipmem_agnus_lput (uaecptr addr, uae_u32 l)
 		return;
 	m = (uae_u32 *)(chipmem_bank.baseaddr + addr);
 	do_put_mem_long (m, l);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 3);
 }
 
 void REGPARAM2 chipmem_agnus_wput (uaecptr addr, uae_u32 w)
@@ -648,6 +664,8 @@ void REGPARAM2 chipmem_agnus_wput (uaecptr addr, uae_u32 w)
 		return;
 	m = (uae_u16 *)(chipmem_bank.baseaddr + addr);
 	do_put_mem_word (m, w);
+	memory_dirty (&chipmem_bank, addr);
+	memory_dirty (&chipmem_bank, addr + 1);
 }
 
 static void REGPARAM2 chipmem_agnus_bput (uaecptr addr, uae_u32 b)
@@ -656,6 +674,7 @@ static void REGPARAM2 chipmem_agnus_bput (uaecptr addr, uae_u32 b)
 	if (addr >= chipmem_full_size)
 		return;
 	chipmem_bank.baseaddr[addr] = b;
+	memory_dirty (&chipmem_bank, addr);
 }
 
 static int REGPARAM2 chipmem_check (uaecptr addr, uae_u32 size)
@@ -712,6 +731,16 @@ void (REGPARAM2 *chipmem_bput_indirect)(uaecptr, uae_u32);
 int (REGPARAM2 *chipmem_check_indirect)(uaecptr, uae_u32);
 uae_u8 *(REGPARAM2 *chipmem_xlate_indirect)(uaecptr);
 
+/* chip ram as seen by the blitter if it can be accessed directly,
+ * addresses below size are not masked or mirrored */
+uae_u8 *chipmem_agnus_direct (uae_u32 *size)
+{
+	if (chipmem_wget_indirect != chipmem_agnus_wget || chipmem_wput_indirect != chipmem_agnus_wput)
+		return NULL;
+	*size = chipmem_full_size;
+	return chipmem_bank.baseaddr;
+}
+
 static void chipmem_setindirect (void)
 {
 	if (currprefs.z3chipmem_size) {
@@ -735,6 +764,88 @@ static void chipmem_setindirect (void)
 	}
 }
 
+/* Rewind dirty page tracking of the RAM banks savestate.c captures */
+
+static int memory_dirty_pages (addrbank *ab)
+{
+	uae_u32 size = ab->mask + 1;
+
+	/* agnus writes are masked with chipmem_full_mask, not the bank mask */
+	if (ab == &chipmem_bank && chipmem_full_size > size)
+		size = chipmem_full_size;
+	/* + 1 for the last byte of a long write at the end of the bank */
+	return (size >> RAM_DIRTY_SHIFT) + 2;
+}
+
+bool memory_dirty_alloc (addrbank *ab)
+{
+	xfree (ab->dirty);
+	ab->dirty = NULL;
+	if (ab->baseaddr && ab->allocated)
+		ab->dirty = xcalloc (uae_u8, memory_dirty_pages (ab));
+	/* drop the direct write pointers (and MMU TLB entries) of the bank */
+	memory_direct_refresh ();
+	return ab->dirty != NULL;
+}
+
+void memory_dirty_free (addrbank *ab)
+{
+	if (!ab->dirty)
+		return;
+	xfree (ab->dirty);
+	ab->dirty = NULL;
+	memory_direct_refresh ();
+}
+
+/* RAM written without going through the put handlers: JIT direct memory
+ * access, chip RAM that is really Z3 chip RAM, and the 1M chip ECS Agnus
+ * setup where Agnus writes past the chip bank into slow RAM */
+bool memory_dirty_untracked (void)
+{
+#ifdef JIT
+	if (currprefs.cachesize && canbang)
+		return true;
+#endif
+	if (currprefs.z3chipmem_size)
+		return true;
+	if (chipmem_full_size > chipmem_bank.allocated)
+		return true;
+	return false;
+}
+
+#define DIRTY_BANKS 4
+static addrbank *const dirty_banks[DIRTY_BANKS] = {
+	&chipmem_bank, &bogomem_bank, &fastmem_bank, &z3fastmem_bank
+};
+
+static void memory_dirty_bank (addrbank *ab, uaecptr addr, uae_u32 size)
+{
+	uae_u32 first, last;
+
+	if (!ab->dirty || addr + size <= ab->start || addr >= ab->start + ab->allocated)
+		return;
+	first = addr > ab->start ? addr - ab->start : 0;
+	last = addr + size - ab->start;
+	if (last > ab->allocated)
+		last = ab->allocated;
+	memset (ab->dirty + (first >> RAM_DIRTY_SHIFT), 1, ((last - 1) >> RAM_DIRTY_SHIFT) - (first >> RAM_DIRTY_SHIFT) + 1);
+}
+
+/* Amiga memory written through its host pointer (DMA, filesystem and
+ * device transfers) */
+void memory_dirty_address (uaecptr addr, uae_u32 size)
+{
+	int i;
+
+	if (!size)
+		return;
+	for (i = 0; i < DIRTY_BANKS; i++)
+		memory_dirty_bank (dirty_banks[i], addr, size);
+#ifdef PICASSO96
+	picasso_dirty_address (addr, size);
+#endif
+}
+
 /* Slow memory */
 
 MEMORY_FUNCTIONS(bogomem)
@@ -1781,6 +1892,68 @@ uae_u8 *mapped_malloc (size_t s, const TCHAR *file)
 
 #endif
 
+/* Banks whose handlers only mask the address and access baseaddr.
+ * Anything with side effects (custom chips, chip ram in 68020 'ce'
+ * mode, RTG memory, debugger memwatch copies) must not be listed. */
+static addrbank *const direct_ram_banks[] = {
+	&chipmem_bank, &bogomem_bank, &cardmem_bank,
+	&a3000lmem_bank, &a3000hmem_bank, &custmem1_bank, &custmem2_bank,
+	&fastmem_bank, &z3fastmem_bank, &z3fastmem2_bank, &z3chipmem_bank,
+	NULL
+};
+static addrbank *const direct_rom_banks[] = {
+	&kickmem_bank, &extendedkickmem_bank, &extendedkickmem2_bank,
+	NULL
+};
+
+/* 0 = handlers only, 1 = direct reads, 2 = direct reads and writes */
+static int direct_bank_type (addrbank *b)
+{
+	int i;
+
+	/* enforcer and action replay replace chip ram handlers in place */
+	if (b == &chipmem_bank &&
+		(b->lget != chipmem_lget || b->wget != chipmem_wget || b->bget != chipmem_bget ||
+		b->lput != chipmem_lput || b->wput != chipmem_wput || b->bput != chipmem_bput))
+		return 0;
+	for (i = 0; direct_ram_banks[i]; i++) {
+		if (direct_ram_banks[i] == b)
+			return 2;
+	}
+	for (i = 0; direct_rom_banks[i]; i++) {
+		if (direct_rom_banks[i] == b)
+			return 1;
+	}
+	return 0;
+}
+
+void mem_direct_set (int bnr, addrbank *b)
+{
+	uae_u8 *p = NULL;
+	int type = direct_bank_type (b);
+
+	/* same offset calculation as MEMORY_LGET () */
+	if (type && b->baseaddr && (b->mask & 0xffff) == 0xffff)
+		p = b->baseaddr + ((((uae_u32)bnr << 16) - (b->start & b->mask)) & b->mask);
+	mem_direct_r[bnr] = p;
+	/* while rewind tracks the bank, writes must go through the put
+	 * handlers, they mark the dirty pages */
+	mem_direct_w[bnr] = type == 2 && !b->dirty ? p : NULL;
+}
+
+void memory_direct_refresh (void)
+{
+	int i;
+
+	for (i = 0; i < MEMORY_BANKS; i++) {
+		if (mem_banks[i])
+			mem_direct_set (i, mem_banks[i]);
+	}
+#ifdef FULLMMU
+	mmu_tlb_flush ();
+#endif
+}
+
 static void init_mem_banks (void)
 {
 	uae_u32 i;
@@ -2126,6 +2299,8 @@ ULONG getz2endaddr (void)
 
 void memory_clear (void)
 {
+	int i;
+
 	mem_hardreset = 0;
 	if (savestate_state == STATE_RESTORE)
 		return;
@@ -2138,6 +2313,8 @@ void memory_clear (void)
 	if (a3000hmem_bank.baseaddr)
 		memset (a3000hmem_bank.baseaddr, 0, a3000hmem_bank.allocated);
 	expansion_clear ();
+	for (i = 0; i < DIRTY_BANKS; i++)
+		memory_dirty_bank (dirty_banks[i], dirty_banks[i]->start, dirty_banks[i]->allocated);
 }
 
 void memory_reset (void)
@@ -2444,6 +2621,8 @@ void memory_reset (void)
 	if (mem_hardreset) {
 		memory_clear ();
 	}
+	/* banks that were reallocated but not remapped */
+	memory_direct_refresh ();
 	write_log (_T("memory init end\n"));
 }
 
@@ -2623,10 +2802,16 @@ static void map_banks2 (addrbank *bank, int start, int size, int realsize, int q
 void map_banks (addrbank *bank, int start, int size, int realsize)
 {
 	map_banks2 (bank, start, size, realsize, 0);
+#ifdef FULLMMU
+	mmu_tlb_flush ();
+#endif
 }
 void map_banks_quick (addrbank *bank, int start, int size, int realsize)
 {
 	map_banks2 (bank, start, size, realsize, 1);
+#ifdef FULLMMU
+	mmu_tlb_flush ();
+#endif
 }
 
 
@@ -36,6 +36,7 @@
 #include "inputrecord.h"
 #include "inputdevice.h"
 #include "misc.h"
+#include "benchmark.h"
 #include "md-fpp.h"
 
 #define f_out write_log
@@ -1348,6 +1349,9 @@ void check_prefs_changed_cpu(void)
 	if (currprefs.cpu_idle != changed_prefs.cpu_idle) {
 		currprefs.cpu_idle = changed_prefs.cpu_idle;
 	}
+	if (currprefs.fpu_fast != changed_prefs.fpu_fast) {
+		currprefs.fpu_fast = changed_prefs.fpu_fast;
+	}
 	if (check_prefs_changed_cpu2()) {
 		set_special(SPCFLAG_MODE_CHANGE);
 		reset_frame_rate_hack();
@@ -3405,6 +3409,7 @@ static void m68k_run_1 (void)
 #endif
 		do_cycles (cpu_cycles);
 		r->instruction_pc = m68k_getpc ();
+		BENCH_INSN ();
 		cpu_cycles = (*cpufunctbl[opcode])(opcode);
 		cpu_cycles = adjust_cycles (cpu_cycles);
 		if (r->spcflags) {
@@ -3497,6 +3502,7 @@ static void m68k_run_1_ce (void)
 		}
 
 		r->instruction_pc = m68k_getpc ();
+		BENCH_INSN ();
 		(*cpufunctbl[opcode])(opcode);
 		if (cpu_tracer) {
 			cputrace.state = 0;
@@ -3573,6 +3579,7 @@ void exec_nostats (void)
 	for (;;)
 	{
 		uae_u16 opcode = get_diword (0);
+		BENCH_INSN ();
 		cpu_cycles = (*cpufunctbl[opcode])(opcode);
 		cpu_cycles = adjust_cycles (cpu_cycles);
 		do_cycles (cpu_cycles);
@@ -3612,6 +3619,7 @@ void execute_normal (void)
 		special_mem = DISTRUST_CONSISTENT_MEM;
 		pc_hist[blocklen].location = (uae_u16*)r->pc_p;
 
+		BENCH_INSN ();
 		cpu_cycles = (*cpufunctbl[opcode])(opcode);
 		cpu_cycles = adjust_cycles (cpu_cycles);
 		do_cycles (cpu_cycles);
@@ -3731,6 +3739,7 @@ retry:
 			mmu060_state = 1;
 
 			count_instr (opcode);
+			BENCH_INSN ();
 			cpu_cycles = (*cpufunctbl[opcode])(opcode);
 
 			cpu_cycles = adjust_cycles (cpu_cycles);
@@ -3789,6 +3798,7 @@ retry:
 			mmu_opcode = -1;
 			mmu_opcode = opcode = x_prefetch (0);
 			count_instr (opcode);
+			BENCH_INSN ();
 			cpu_cycles = (*cpufunctbl[opcode])(opcode);
 			cpu_cycles = adjust_cycles (cpu_cycles);
 
@@ -3862,6 +3872,7 @@ insretry:
 				count_instr (opcode);
 				do_cycles (cpu_cycles);
 				mmu030_retry = false;
+				BENCH_INSN ();
 				cpu_cycles = (*cpufunctbl[opcode])(opcode);
 				cnt--; // so that we don't get in infinite loop if things go horribly wrong
 				if (!mmu030_retry)
@@ -4015,6 +4026,7 @@ static void m68k_run_2ce (void)
 				inprec_playdebug_cpu (1);
 		}
 
+		BENCH_INSN ();
 		(*cpufunctbl[opcode])(opcode);
 
 cont:
@@ -4052,6 +4064,7 @@ static void m68k_run_2pf (void)
 
 		count_instr (opcode);
 
+		BENCH_INSN ();
 		cpu_cycles = (*cpufunctbl[opcode])(opcode);
 		cpu_cycles = adjust_cycles (cpu_cycles);
 		if (r->spcflags) {
@@ -4080,6 +4093,7 @@ static void m68k_run_2p (void)
 		opcode = regs.irc;
 		count_instr (opcode);
 
+		BENCH_INSN ();
 		cpu_cycles = (*cpufunctbl[opcode])(opcode);
 		cpu_cycles = adjust_cycles (cpu_cycles);
 		if (r->spcflags) {
@@ -4120,6 +4134,7 @@ static void m68k_run_2 (void)
 //			write_log (_T("%08x %04X %d "), r->instruction_pc, opcode, cpu_cycles);
 
 		do_cycles (cpu_cycles);
+		BENCH_INSN ();
 		cpu_cycles = (*cpufunctbl[opcode])(opcode);
 		cpu_cycles = adjust_cycles (cpu_cycles);
 		if (r->spcflags) {
@@ -4137,6 +4152,7 @@ static void m68k_run_mmu (void)
 		uae_u16 opcode = get_iiword (0);
 		do_cycles (cpu_cycles);
 		mmu_backup_regs = regs;
+		BENCH_INSN ();
 		cpu_cycles = (*cpufunctbl[opcode])(opcode);
 		cpu_cycles = adjust_cycles (cpu_cycles);
 #ifdef DEBUGGER
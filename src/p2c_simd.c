@@ -0,0 +1,313 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Vectorized planar to chunky conversion for pfield_doline ()
+  *
+  * Same merge network as pfield_doline_1 () in drawing.c, but each
+  * vector lane converts a different longword (32 pixels) of the line,
+  * followed by a transpose so that every lane's eight result longs end
+  * up next to each other. Output is bit-identical to the scalar code.
+  *
+  * Kernels: SSE2, SSSE3 (byteswap with pshufb), AVX2 (8 longs per step)
+  * and NEON, selected at runtime. Leftover longs at the end of a line
+  * are converted by the scalar code.
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include "options.h"
+#include "memory_uae.h"
+#include "custom.h"
+#include "xwin.h"
+#include "drawing.h"
+
+#if defined (__x86_64__) || (defined (__i386__) && defined (__SSE2__))
+#define P2CSIMD_SSE2 1
+#include <emmintrin.h>
+#if defined (__GNUC__) && (__GNUC__ >= 5 || defined (__clang__))
+#define P2CSIMD_SSSE3 1
+#define P2CSIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+#if defined (__ARM_NEON) && defined (__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define P2CSIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef int (*p2c_kernel)(uae_u32 *pixels, uae_u8 **bplpt, int planes, int wordcount);
+
+static p2c_kernel kernel;
+
+/* b7 = plane 0 ... b0 = plane 7, like pfield_doline_1 () */
+#define P2C_NETWORK \
+	VMERGE (b0, b1, 0x55555555, 1); \
+	VMERGE (b2, b3, 0x55555555, 1); \
+	VMERGE (b4, b5, 0x55555555, 1); \
+	VMERGE (b6, b7, 0x55555555, 1); \
+	VMERGE (b0, b2, 0x33333333, 2); \
+	VMERGE (b1, b3, 0x33333333, 2); \
+	VMERGE (b4, b6, 0x33333333, 2); \
+	VMERGE (b5, b7, 0x33333333, 2); \
+	VMERGE (b0, b4, 0x0f0f0f0f, 4); \
+	VMERGE (b1, b5, 0x0f0f0f0f, 4); \
+	VMERGE (b2, b6, 0x0f0f0f0f, 4); \
+	VMERGE (b3, b7, 0x0f0f0f0f, 4); \
+	VMERGE (b0, b1, 0x00ff00ff, 8); \
+	VMERGE (b2, b3, 0x00ff00ff, 8); \
+	VMERGE (b4, b5, 0x00ff00ff, 8); \
+	VMERGE (b6, b7, 0x00ff00ff, 8); \
+	VMERGE (b0, b2, 0x0000ffff, 16); \
+	VMERGE (b1, b3, 0x0000ffff, 16); \
+	VMERGE (b4, b6, 0x0000ffff, 16); \
+	VMERGE (b5, b7, 0x0000ffff, 16);
+
+/* load 'bytes' bytes of every enabled plane, missing planes are zero */
+#define P2C_LOAD(LOAD, ZERO, bytes) \
+	b0 = b1 = b2 = b3 = b4 = b5 = b6 = b7 = ZERO; \
+	if (planes >= 8) { b0 = LOAD (bplpt[7]); bplpt[7] += bytes; } \
+	if (planes >= 7) { b1 = LOAD (bplpt[6]); bplpt[6] += bytes; } \
+	if (planes >= 6) { b2 = LOAD (bplpt[5]); bplpt[5] += bytes; } \
+	if (planes >= 5) { b3 = LOAD (bplpt[4]); bplpt[4] += bytes; } \
+	if (planes >= 4) { b4 = LOAD (bplpt[3]); bplpt[3] += bytes; } \
+	if (planes >= 3) { b5 = LOAD (bplpt[2]); bplpt[2] += bytes; } \
+	if (planes >= 2) { b6 = LOAD (bplpt[1]); bplpt[1] += bytes; } \
+	if (planes >= 1) { b7 = LOAD (bplpt[0]); bplpt[0] += bytes; }
+
+#ifdef P2CSIMD_SSE2
+
+#define VMERGE(a,b,mask,shift) do { \
+	__m128i tmp = _mm_and_si128 (_mm_set1_epi32 (mask), _mm_xor_si128 (a, _mm_srli_epi32 (b, shift))); \
+	a = _mm_xor_si128 (a, tmp); \
+	b = _mm_xor_si128 (b, _mm_slli_epi32 (tmp, shift)); \
+} while (0)
+
+#define LOAD128(p) _mm_loadu_si128 ((const __m128i*)(p))
+
+/* rows r0-r3 (one vector per result long) to columns (one vector per source long) */
+#define TRANSPOSE4(r0, r1, r2, r3) do { \
+	__m128i t0 = _mm_unpacklo_epi32 (r0, r1); \
+	__m128i t1 = _mm_unpacklo_epi32 (r2, r3); \
+	__m128i t2 = _mm_unpackhi_epi32 (r0, r1); \
+	__m128i t3 = _mm_unpackhi_epi32 (r2, r3); \
+	r0 = _mm_unpacklo_epi64 (t0, t1); \
+	r1 = _mm_unpackhi_epi64 (t0, t1); \
+	r2 = _mm_unpacklo_epi64 (t2, t3); \
+	r3 = _mm_unpackhi_epi64 (t2, t3); \
+} while (0)
+
+/* do_put_mem_long () byte order */
+static inline __m128i bswap_sse2 (__m128i v)
+{
+	v = _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8));
+	return _mm_shufflehi_epi16 (_mm_shufflelo_epi16 (v, 0xb1), 0xb1);
+}
+
+static int p2c_sse2 (uae_u32 *pixels, uae_u8 **bplpt, int planes, int wordcount)
+{
+	int done;
+
+	for (done = 0; done + 4 <= wordcount; done += 4) {
+		__m128i b0, b1, b2, b3, b4, b5, b6, b7;
+		P2C_LOAD (LOAD128, _mm_setzero_si128 (), 16)
+		P2C_NETWORK
+		TRANSPOSE4 (b0, b4, b1, b5);
+		TRANSPOSE4 (b2, b6, b3, b7);
+		_mm_storeu_si128 ((__m128i*)(pixels + 0), bswap_sse2 (b0));
+		_mm_storeu_si128 ((__m128i*)(pixels + 4), bswap_sse2 (b2));
+		_mm_storeu_si128 ((__m128i*)(pixels + 8), bswap_sse2 (b4));
+		_mm_storeu_si128 ((__m128i*)(pixels + 12), bswap_sse2 (b6));
+		_mm_storeu_si128 ((__m128i*)(pixels + 16), bswap_sse2 (b1));
+		_mm_storeu_si128 ((__m128i*)(pixels + 20), bswap_sse2 (b3));
+		_mm_storeu_si128 ((__m128i*)(pixels + 24), bswap_sse2 (b5));
+		_mm_storeu_si128 ((__m128i*)(pixels + 28), bswap_sse2 (b7));
+		pixels += 32;
+	}
+	return done;
+}
+
+#ifdef P2CSIMD_SSSE3
+
+__attribute__((target("ssse3")))
+static int p2c_ssse3 (uae_u32 *pixels, uae_u8 **bplpt, int planes, int wordcount)
+{
+	const __m128i swap = _mm_setr_epi8 (3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	int done;
+
+	for (done = 0; done + 4 <= wordcount; done += 4) {
+		__m128i b0, b1, b2, b3, b4, b5, b6, b7;
+		P2C_LOAD (LOAD128, _mm_setzero_si128 (), 16)
+		P2C_NETWORK
+		TRANSPOSE4 (b0, b4, b1, b5);
+		TRANSPOSE4 (b2, b6, b3, b7);
+		_mm_storeu_si128 ((__m128i*)(pixels + 0), _mm_shuffle_epi8 (b0, swap));
+		_mm_storeu_si128 ((__m128i*)(pixels + 4), _mm_shuffle_epi8 (b2, swap));
+		_mm_storeu_si128 ((__m128i*)(pixels + 8), _mm_shuffle_epi8 (b4, swap));
+		_mm_storeu_si128 ((__m128i*)(pixels + 12), _mm_shuffle_epi8 (b6, swap));
+		_mm_storeu_si128 ((__m128i*)(pixels + 16), _mm_shuffle_epi8 (b1, swap));
+		_mm_storeu_si128 ((__m128i*)(pixels + 20), _mm_shuffle_epi8 (b3, swap));
+		_mm_storeu_si128 ((__m128i*)(pixels + 24), _mm_shuffle_epi8 (b5, swap));
+		_mm_storeu_si128 ((__m128i*)(pixels + 28), _mm_shuffle_epi8 (b7, swap));
+		pixels += 32;
+	}
+	return done;
+}
+
+#endif
+
+#undef VMERGE
+#undef TRANSPOSE4
+
+#endif /* P2CSIMD_SSE2 */
+
+#ifdef P2CSIMD_AVX2
+
+#define VMERGE(a,b,mask,shift) do { \
+	__m256i tmp = _mm256_and_si256 (_mm256_set1_epi32 (mask), _mm256_xor_si256 (a, _mm256_srli_epi32 (b, shift))); \
+	a = _mm256_xor_si256 (a, tmp); \
+	b = _mm256_xor_si256 (b, _mm256_slli_epi32 (tmp, shift)); \
+} while (0)
+
+#define LOAD256(p) _mm256_loadu_si256 ((const __m256i*)(p))
+
+/* in-lane transpose: low half holds longs 0-3, high half longs 4-7 */
+#define TRANSPOSE4(r0, r1, r2, r3) do { \
+	__m256i t0 = _mm256_unpacklo_epi32 (r0, r1); \
+	__m256i t1 = _mm256_unpacklo_epi32 (r2, r3); \
+	__m256i t2 = _mm256_unpackhi_epi32 (r0, r1); \
+	__m256i t3 = _mm256_unpackhi_epi32 (r2, r3); \
+	r0 = _mm256_unpacklo_epi64 (t0, t1); \
+	r1 = _mm256_unpackhi_epi64 (t0, t1); \
+	r2 = _mm256_unpacklo_epi64 (t2, t3); \
+	r3 = _mm256_unpackhi_epi64 (t2, t3); \
+} while (0)
+
+#define STORE2(n, lo, hi) do { \
+	_mm256_storeu_si256 ((__m256i*)(pixels + 8 * (n)), _mm256_shuffle_epi8 (_mm256_permute2x128_si256 (lo, hi, 0x20), swap)); \
+	_mm256_storeu_si256 ((__m256i*)(pixels + 8 * (n) + 32), _mm256_shuffle_epi8 (_mm256_permute2x128_si256 (lo, hi, 0x31), swap)); \
+} while (0)
+
+__attribute__((target("avx2")))
+static int p2c_avx2 (uae_u32 *pixels, uae_u8 **bplpt, int planes, int wordcount)
+{
+	const __m256i swap = _mm256_setr_epi8 (
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	int done;
+
+	for (done = 0; done + 8 <= wordcount; done += 8) {
+		__m256i b0, b1, b2, b3, b4, b5, b6, b7;
+		P2C_LOAD (LOAD256, _mm256_setzero_si256 (), 32)
+		P2C_NETWORK
+		TRANSPOSE4 (b0, b4, b1, b5);
+		TRANSPOSE4 (b2, b6, b3, b7);
+		STORE2 (0, b0, b2);
+		STORE2 (1, b4, b6);
+		STORE2 (2, b1, b3);
+		STORE2 (3, b5, b7);
+		pixels += 64;
+	}
+	return done;
+}
+
+#undef VMERGE
+#undef TRANSPOSE4
+#undef STORE2
+
+#endif /* P2CSIMD_AVX2 */
+
+#ifdef P2CSIMD_NEON
+
+#define VMERGE(a,b,mask,shift) do { \
+	uint32x4_t tmp = vandq_u32 (vdupq_n_u32 (mask), veorq_u32 (a, vshrq_n_u32 (b, shift))); \
+	a = veorq_u32 (a, tmp); \
+	b = veorq_u32 (b, vshlq_n_u32 (tmp, shift)); \
+} while (0)
+
+#define LOADNEON(p) vreinterpretq_u32_u8 (vld1q_u8 (p))
+
+#define TRANSPOSE4(r0, r1, r2, r3) do { \
+	uint32x4x2_t t01 = vtrnq_u32 (r0, r1); \
+	uint32x4x2_t t23 = vtrnq_u32 (r2, r3); \
+	r0 = vcombine_u32 (vget_low_u32 (t01.val[0]), vget_low_u32 (t23.val[0])); \
+	r1 = vcombine_u32 (vget_low_u32 (t01.val[1]), vget_low_u32 (t23.val[1])); \
+	r2 = vcombine_u32 (vget_high_u32 (t01.val[0]), vget_high_u32 (t23.val[0])); \
+	r3 = vcombine_u32 (vget_high_u32 (t01.val[1]), vget_high_u32 (t23.val[1])); \
+} while (0)
+
+#define STORENEON(p, v) vst1q_u8 ((uae_u8*)(p), vrev32q_u8 (vreinterpretq_u8_u32 (v)))
+
+static int p2c_neon (uae_u32 *pixels, uae_u8 **bplpt, int planes, int wordcount)
+{
+	int done;
+
+	for (done = 0; done + 4 <= wordcount; done += 4) {
+		uint32x4_t b0, b1, b2, b3, b4, b5, b6, b7;
+		P2C_LOAD (LOADNEON, vdupq_n_u32 (0), 16)
+		P2C_NETWORK
+		TRANSPOSE4 (b0, b4, b1, b5);
+		TRANSPOSE4 (b2, b6, b3, b7);
+		STORENEON (pixels + 0, b0);
+		STORENEON (pixels + 4, b2);
+		STORENEON (pixels + 8, b4);
+		STORENEON (pixels + 12, b6);
+		STORENEON (pixels + 16, b1);
+		STORENEON (pixels + 20, b3);
+		STORENEON (pixels + 24, b5);
+		STORENEON (pixels + 28, b7);
+		pixels += 32;
+	}
+	return done;
+}
+
+#undef VMERGE
+#undef TRANSPOSE4
+
+#endif /* P2CSIMD_NEON */
+
+/* level: 0 = scalar only, 1 = SSE2/NEON, 2 = SSSE3, 3 = AVX2 */
+void p2c_simd_init (int level)
+{
+	const TCHAR *name = _T("scalar");
+
+	kernel = NULL;
+#ifdef P2CSIMD_NEON
+	if (level > 0) {
+		kernel = p2c_neon;
+		name = _T("NEON");
+	}
+#endif
+#ifdef P2CSIMD_SSE2
+	if (level > 0) {
+		kernel = p2c_sse2;
+		name = _T("SSE2");
+	}
+#endif
+#if defined (P2CSIMD_SSSE3) || defined (P2CSIMD_AVX2)
+	if (level > 1)
+		__builtin_cpu_init ();
+#endif
+#ifdef P2CSIMD_SSSE3
+	if (level > 1 && __builtin_cpu_supports ("ssse3")) {
+		kernel = p2c_ssse3;
+		name = _T("SSSE3");
+	}
+#endif
+#ifdef P2CSIMD_AVX2
+	if (level > 2 && __builtin_cpu_supports ("avx2")) {
+		kernel = p2c_avx2;
+		name = _T("AVX2");
+	}
+#endif
+	write_log (_T("Planar to chunky: %s\n"), name);
+}
+
+/* Converts as many whole vectors of longs as possible and advances
+ * bplpt[], returns number of longs converted. */
+int p2c_simd (uae_u32 *pixels, uae_u8 **bplpt, int planes, int wordcount)
+{
+	if (!kernel || planes <= 0)
+		return 0;
+	return kernel (pixels, bplpt, planes, wordcount);
+}
@@ -320,9 +320,46 @@ static void ShowSupportedResolutions (void)
 #endif
 
 static void **gwwbuf;
-static int gwwbufsize, gwwpagesize, gwwpagemask;
+static int gwwbufsize, gwwpagesize, gwwpagemask, gwwpageshift;
 extern uae_u8 *natmem_offset;
 
+/*
+ * VRAM dirty tracking: one byte per host page of gfxmem, set by the
+ * gfxmem_bank put handlers and by the RTG blitter functions below,
+ * cleared once picasso_flushpixels () has converted the page.
+ */
+static uae_u8 *gwwdirty;
+
+STATIC_INLINE void picasso_dirty (uae_u32 offset)
+{
+	uae_u32 page = offset >> gwwpageshift;
+	if (page < (uae_u32)gwwbufsize)
+		gwwdirty[page] = 1;
+}
+
+/* host pointer range, anything outside gfxmem is ignored */
+static void picasso_dirty_range (uae_u8 *p, int size)
+{
+	uae_u8 *base = gfxmem_bank.baseaddr;
+	uae_u32 start, end;
+
+	if (!gwwdirty || !base || size <= 0 || p < base || p >= base + gfxmem_bank.allocated)
+		return;
+	start = (p - base) >> gwwpageshift;
+	end = (p - base + size - 1) >> gwwpageshift;
+	if (end >= (uae_u32)gwwbufsize)
+		end = gwwbufsize - 1;
+	memset (gwwdirty + start, 1, end - start + 1);
+}
+
+static void picasso_dirty_rect (struct RenderInfo *ri, int X, int Y, int Width, int Height, int Bpp)
+{
+	if (Width <= 0 || Height <= 0)
+		return;
+	picasso_dirty_range (ri->Memory + Y * ri->BytesPerRow + X * Bpp,
+		(Height - 1) * ri->BytesPerRow + Width * Bpp);
+}
+
 static uae_u8 GetBytesPerPixel (uae_u32 RGBfmt)
 {
 	switch (RGBfmt)
@@ -548,6 +585,7 @@ static void do_fillrect_frame_buffer (struct RenderInfo *ri, int X, int Y,
 	int lines;
 	int bpr = ri->BytesPerRow;
 
+	picasso_dirty_rect (ri, X, Y, Width, Height, Bpp);
 	dst = ri->Memory + X * Bpp + Y * ri->BytesPerRow;
 	endianswap (&Pen, Bpp);
 	switch (Bpp)
@@ -558,19 +596,18 @@ static void do_fillrect_frame_buffer (struct RenderInfo *ri, int X, int Y,
 		}
 		break;
 	case 2:
-		Pen |= Pen << 16;
 		for (lines = 0; lines < Height; lines++, dst += bpr) {
-			uae_u32 *p = (uae_u32*)dst;
-			for (cols = 0; cols < Width / 2; cols++)
+			int done = rtg_simd_fill (dst, Pen, 2, Width * 2) / 2;
+			uae_u16 *p = (uae_u16*)dst + done;
+			for (cols = done; cols < Width; cols++)
 				*p++ = Pen;
-			if (Width & 1)
-				((uae_u16*)p)[0] = Pen;
 		}
 		break;
 	case 3:
 		for (lines = 0; lines < Height; lines++, dst += bpr) {
-			uae_u8 *p = (uae_u8*)dst;
-			for (cols = 0; cols < Width; cols++) {
+			int done = rtg_simd_fill (dst, Pen, 3, Width * 3) / 3;
+			uae_u8 *p = (uae_u8*)dst + done * 3;
+			for (cols = done; cols < Width; cols++) {
 				*p++ = Pen >> 0;
 				*p++ = Pen >> 8;
 				*p++ = Pen >> 16;
@@ -579,8 +616,9 @@ static void do_fillrect_frame_buffer (struct RenderInfo *ri, int X, int Y,
 		break;
 	case 4:
 		for (lines = 0; lines < Height; lines++, dst += bpr) {
-			uae_u32 *p = (uae_u32*)dst;
-			for (cols = 0; cols < Width; cols++)
+			int done = rtg_simd_fill (dst, Pen, 4, Width * 4) / 4;
+			uae_u32 *p = (uae_u32*)dst + done;
+			for (cols = done; cols < Width; cols++)
 				*p++ = Pen;
 		}
 		break;
@@ -1231,6 +1269,7 @@ static int do_blitrect_frame_buffer (struct RenderInfo *ri, struct
 	uae_u8 Bpp = GetBytesPerPixel (ri->RGBFormat);
 	unsigned long total_width = width * Bpp;
 
+	picasso_dirty_rect (dstri, dstx, dsty, width, height, Bpp);
 	src = ri->Memory + srcx * Bpp + srcy * ri->BytesPerRow;
 	dst = dstri->Memory + dstx * Bpp + dsty * dstri->BytesPerRow;
 	if (mask != 0xFF && Bpp > 1) {
@@ -1259,6 +1298,10 @@ static int do_blitrect_frame_buffer (struct RenderInfo *ri, struct
 			}
 			return 1;
 
+		} else if (rtg_simd_blit (opcode, src, dst, total_width, height, ri->BytesPerRow, dstri->BytesPerRow)) {
+
+			return 1;
+
 		} else if (Bpp == 4) {
 
 			/* 32-bit optimized */
@@ -1798,36 +1841,88 @@ static void CopyLibResolutionStructureU2A (struct LibResolution *libres, uaecptr
 void picasso_allocatewritewatch (int gfxmemsize)
 {
 	xfree (gwwbuf);
+	xfree (gwwdirty);
 	gwwpagesize = getpagesize();
 	gwwbufsize = gfxmemsize / gwwpagesize + 1;
 	gwwpagemask = gwwpagesize - 1;
+	for (gwwpageshift = 0; (1 << gwwpageshift) < gwwpagesize; gwwpageshift++);
 	gwwbuf = xmalloc (void*, gwwbufsize);
+	gwwdirty = xcalloc (uae_u8, gwwbufsize);
+	full_refresh = 1;
 }
 
-static unsigned long writewatchcount;
-void picasso_getwritewatch (void)
+/* Writes that bypass gfxmem_bank: JIT direct memory access, and hardware
+ * boards (gfxboard.c) whose VRAM is written by the board emulation. */
+static bool picasso_dirty_untracked (void)
 {
-	ULONG ps;
-	writewatchcount = gwwbufsize;
-/*	if (GetWriteWatch (WRITE_WATCH_FLAG_RESET, p96ram_start + natmem_offset, (gwwbufsize - 1) * gwwpagesize, gwwbuf, &writewatchcount, &ps)) {
-		write_log (_T("picasso_getwritewatch %d\n"), GetLastError ());
-		writewatchcount = 0;
+	if (currprefs.rtgmem_type >= GFXBOARD_HARDWARE)
+		return true;
+#ifdef JIT
+	if (currprefs.cachesize && canbang)
+		return true;
+#endif
+	return false;
+}
+
+/* pages of src_start..src_end that were written since the last reset */
+static int picasso_getdirtypages (uae_u8 *src, uae_u8 *src_start, uae_u8 *src_end)
+{
+	int i, cnt = 0;
+	int last = (src_end - src) >> gwwpageshift;
+	bool all = picasso_dirty_untracked ();
+
+	if (last > gwwbufsize)
+		last = gwwbufsize;
+	for (i = (src_start - src) >> gwwpageshift; i < last; i++) {
+		if (all || gwwdirty[i])
+			gwwbuf[cnt++] = src + (i << gwwpageshift);
+	}
+	return cnt;
+}
+
+static void picasso_resetdirtypages (uae_u8 *src, uae_u8 *src_start, uae_u8 *src_end)
+{
+	int first = (src_start - src) >> gwwpageshift;
+	int last = (src_end - src) >> gwwpageshift;
+
+	if (last > gwwbufsize)
+		last = gwwbufsize;
+	if (first < last)
+		memset (gwwdirty + first, 0, last - first);
+}
+
+/* the dirty bits are always current, nothing to collect */
+void picasso_getwritewatch (int offset)
+{
+}
+
+/* Amiga memory written through its host pointer (filesystem and device
+ * transfers), mark whatever part of it is gfxmem */
+void picasso_dirty_address (uaecptr addr, uae_u32 size)
+{
+	uae_u32 offset;
+
+	if (!gwwdirty || !size || addr < gfxmem_bank.start)
+		return;
+	offset = addr - gfxmem_bank.start;
+	if (offset >= gfxmem_bank.allocated)
 		return;
-	}*/
+	if (size > gfxmem_bank.allocated - offset)
+		size = gfxmem_bank.allocated - offset;
+	picasso_dirty_range (gfxmem_bank.baseaddr + offset, size);
 }
+
 bool picasso_is_vram_dirty (uaecptr addr, int size)
 {
-	uae_u8 *a = addr + natmem_offset;
-	int s = size;
-	int ms = gwwpagesize;
-	for (unsigned long i = 0; i < writewatchcount; i++) {
-		uae_u8 *ma = (uae_u8*)gwwbuf[i];
-		if (
-			(a < ma && a + s >= ma) ||
-			(a < ma + ms && a + s >= ma + ms) ||
-			(a >= ma && a < ma + ms)) {
+	uae_u32 start, end;
+
+	if (!gwwdirty || picasso_dirty_untracked ())
+		return true;
+	start = (addr - gfxmem_bank.start) >> gwwpageshift;
+	end = (addr - gfxmem_bank.start + size) >> gwwpageshift;
+	for (; start <= end && start < (uae_u32)gwwbufsize; start++) {
+		if (gwwdirty[start])
 			return true;
-		}
 	}
 	return false;
 }
@@ -2473,6 +2568,9 @@ static uae_u32 REGPARAM2 picasso_SetPanning (TrapContext *ctx)
 #ifdef __x86_64__
 static void do_xor8 (uae_u8 *p, int w, uae_u32 v)
 {
+	int done = rtg_simd_xor (p, v, w);
+	p += done;
+	w -= done;
 	while (ALIGN_POINTER_TO32 (p) != 7 && w) {
 		*p ^= v;
 		p++;
@@ -2502,6 +2600,9 @@ static void do_xor8 (uae_u8 *p, int w, uae_u32 v)
 #else
 static void do_xor8 (uae_u8 *p, int w, uae_u32 v)
 {
+	int done = rtg_simd_xor (p, v, w);
+	p += done;
+	w -= done;
 	while (ALIGN_POINTER_TO32 (p) != 3 && w) {
 		*p ^= v;
 		p++;
@@ -2569,6 +2670,7 @@ static uae_u32 REGPARAM2 picasso_InvertRect (TrapContext *ctx)
 
 		for (lines = 0; lines < Height; lines++, uae_mem += ri.BytesPerRow)
 			do_xor8 (uae_mem, width_in_bytes, xorval);
+		picasso_dirty_rect (&ri, X, Y, Width, Height, Bpp);
 		result = 1;
 	}
 
@@ -2631,6 +2733,7 @@ static uae_u32 REGPARAM2 picasso_FillRect (TrapContext *ctx)
 			} else {
 				Pen &= Mask;
 				Mask = ~Mask;
+				picasso_dirty_rect (&ri, X, Y, Width, Height, Bpp);
 				oldstart = ri.Memory + Y * ri.BytesPerRow + X * Bpp;
 				{
 					uae_u8 *start = oldstart;
@@ -2904,6 +3007,7 @@ static uae_u32 REGPARAM2 picasso_BlitPattern (TrapContext *ctx)
 			return 1;
 
 		Bpp = GetBytesPerPixel(ri.RGBFormat);
+		picasso_dirty_rect (&ri, X, Y, W, H, Bpp);
 		uae_mem = ri.Memory + Y * ri.BytesPerRow + X * Bpp; /* offset with address */
 
 		if (pattern.DrawMode & INVERS)
@@ -3067,6 +3171,7 @@ static uae_u32 REGPARAM2 picasso_BlitTemplate (TrapContext *ctx)
 			return 1;
 
 		Bpp = GetBytesPerPixel (ri.RGBFormat);
+		picasso_dirty_rect (&ri, X, Y, W, H, Bpp);
 		uae_mem = ri.Memory + Y * ri.BytesPerRow + X * Bpp; /* offset into address */
 
 		if (tmp.DrawMode & INVERS)
@@ -3350,6 +3455,7 @@ static uae_u32 REGPARAM2 picasso_BlitPlanar2Chunky (TrapContext *ctx)
 			srcx, srcy, dstx, dsty, width, height, minterm, mask, local_bm.Depth));
 		P96TRACE((_T("P2C - BitMap has %d BPR, %d rows\n"), local_bm.BytesPerRow, local_bm.Rows));
 		PlanarToChunky (&local_ri, &local_bm, srcx, srcy, dstx, dsty, width, height, mask);
+		picasso_dirty_rect (&local_ri, dstx, dsty, width, height, 1);
 		result = 1;
 	}
 	return result;
@@ -3493,6 +3599,7 @@ static uae_u32 REGPARAM2 picasso_BlitPlanar2Direct (TrapContext *ctx)
 		P96TRACE((_T("BlitPlanar2Direct(%d, %d, %d, %d, %d, %d) Minterm 0x%x, Mask 0x%x, Depth %d\n"),
 			srcx, srcy, dstx, dsty, width, height, minterm, Mask, local_bm.Depth));
 		PlanarToDirect (&local_ri, &local_bm, srcx, srcy, dstx, dsty, width, height, Mask, &local_cim);
+		picasso_dirty_rect (&local_ri, dstx, dsty, width, height, GetBytesPerPixel (local_ri.RGBFormat));
 		result = 1;
 	}
 	return result;
@@ -3557,12 +3664,14 @@ static void copyrow (uae_u8 *src, uae_u8 *dst, int x, int y, int width, int srcb
 	{
 		/* 24bit->32bit */
 	case RGBFB_R8G8B8_32:
+		x += rtg_simd_swizzle ((uae_u32*)dst2 + x, src2 + x * 3, 3, 0, 1, 2, width);
 		while (x < endx) {
 			((uae_u32*)dst2)[x] = (src2[x * 3 + 0] << 16) | (src2[x * 3 + 1] << 8) | (src2[x * 3 + 2] << 0);
 			x++;
 		}
 		break;
 	case RGBFB_B8G8R8_32:
+		x += rtg_simd_swizzle ((uae_u32*)dst2 + x, src2 + x * 3, 3, 2, 1, 0, width);
 		while (x < endx) {
 			((uae_u32*)dst2)[x] = ((uae_u32*)(src2 + x * 3))[0] & 0x00ffffff;
 			x++;
@@ -3571,18 +3680,21 @@ static void copyrow (uae_u8 *src, uae_u8 *dst, int x, int y, int width, int srcb
 
 		/* 32bit->32bit */
 	case RGBFB_R8G8B8A8_32:
+		x += rtg_simd_swizzle ((uae_u32*)dst2 + x, src2 + x * 4, 4, 0, 1, 2, width);
 		while (x < endx) {
 			((uae_u32*)dst2)[x] = (src2[x * 4 + 0] << 16) | (src2[x * 4 + 1] << 8) | (src2[x * 4 + 2] << 0);
 			x++;
 		}
 		break;
 	case RGBFB_A8R8G8B8_32:
+		x += rtg_simd_swizzle ((uae_u32*)dst2 + x, src2 + x * 4, 4, 1, 2, 3, width);
 		while (x < endx) {
 			((uae_u32*)dst2)[x] = (src2[x * 4 + 1] << 16) | (src2[x * 4 + 2] << 8) | (src2[x * 4 + 3] << 0);
 			x++;
 		}
 		break;
 	case RGBFB_A8B8G8R8_32:
+		x += rtg_simd_swizzle ((uae_u32*)dst2 + x, src2 + x * 4, 4, 3, 2, 1, width);
 		while (x < endx) {
 			((uae_u32*)dst2)[x] = ((uae_u32*)src2)[x] >> 8;
 			x++;
@@ -3597,6 +3709,7 @@ static void copyrow (uae_u8 *src, uae_u8 *dst, int x, int y, int width, int srcb
 	case RGBFB_B5G6R5PC_32:
 	case RGBFB_B5G5R5PC_32:
 		{
+			x += rtg_simd_rgb16to32 ((uae_u32*)dst2 + x, (uae_u16*)src2 + x, p96_rgbx16, width);
 			while ((x & 3) && x < endx) {
 				((uae_u32*)dst2)[x] = p96_rgbx16[((uae_u16*)src2)[x]];
 				x++;
@@ -3704,6 +3817,7 @@ static void copyrow (uae_u8 *src, uae_u8 *dst, int x, int y, int width, int srcb
 		/* 8bit->32bit */
 	case RGBFB_CLUT_RGBFB_32:
 		{
+			x += rtg_simd_clut32 ((uae_u32*)dst2 + x, src2 + x, picasso_vidinfo.clut, width);
 			while ((x & 3) && x < endx) {
 				((uae_u32*)dst2)[x] = picasso_vidinfo.clut[src2[x]];
 				x++;
@@ -3757,6 +3871,8 @@ static void copyallinvert (uae_u8 *src, uae_u8 *dst, int pwidth, int pheight, in
 
 	w = pwidth * dstpixbytes;
 	if (direct) {
+		if (rtg_simd_blit (BLIT_NOTSRC, src, dst, w, pheight, srcbytesperrow, dstbytesperrow))
+			return;
 		for (y = 0; y < pheight; y++) {
 			for (x = 0; x < w; x++)
 				dst[x] = src[x] ^ 0xff;
@@ -3766,11 +3882,9 @@ static void copyallinvert (uae_u8 *src, uae_u8 *dst, int pwidth, int pheight, in
 	} else {
 		uae_u8 *src2 = src;
 		for (y = 0; y < pheight; y++) {
-			for (x = 0; x < w; x++)
-				src2[x] ^= 0xff;
+			do_xor8 (src2, w, 0xffffffff);
 			copyrow (src, dst, 0, y, pwidth, srcbytesperrow, srcpixbytes, dstbytesperrow, dstpixbytes, direct, mode_convert);
-			for (x = 0; x < w; x++)
-				src2[x] ^= 0xff;
+			do_xor8 (src2, w, 0xffffffff);
 			src2 += srcbytesperrow;
 		}
 	}
@@ -3872,7 +3986,7 @@ bool picasso_flushpixels (uae_u8 *src, int off)
 		picasso_vidinfo.width, picasso_vidinfo.height,
 		pwidth, pheight);
 #endif
-	if (!picasso_vidinfo.extra_mem || !gwwbuf || src_start >= src_end)
+	if (!picasso_vidinfo.extra_mem || !gwwbuf || !gwwdirty || src_start >= src_end)
 		return false;
 
 	if (flashscreen) {
@@ -3895,10 +4009,7 @@ bool picasso_flushpixels (uae_u8 *src, int off)
 			for (i = 0; (ULONG)i < gwwcnt; i++)
 				gwwbuf[i] = src_start + i * gwwpagesize;
 		} else {
-			/*ULONG ps;*/
-			gwwcnt = gwwbufsize;
-			/*if (mman_GetWriteWatch (src_start, src_end - src_start, gwwbuf, &gwwcnt, &ps))
-				break;*/
+			gwwcnt = picasso_getdirtypages (src, src_start, src_end);
 		}
 
 		if (gwwcnt == 0)
@@ -4006,14 +4117,45 @@ bool picasso_flushpixels (uae_u8 *src, int off)
 		if (doskip () && p96skipmode == 3) {
 			;
 		} else {
-			;//mman_ResetWatch (src_start, src_end - src_start);
+			picasso_resetdirtypages (src, src_start, src_end);
 		}
 		full_refresh = 0;
 	}
 	return lock != 0;
 }
 
-MEMORY_FUNCTIONS(gfxmem);
+MEMORY_LGET(gfxmem)
+MEMORY_WGET(gfxmem)
+MEMORY_BGET(gfxmem)
+MEMORY_CHECK(gfxmem)
+MEMORY_XLATE(gfxmem)
+
+static void REGPARAM3 gfxmem_lput (uaecptr, uae_u32) REGPARAM;
+static void REGPARAM2 gfxmem_lput (uaecptr addr, uae_u32 l)
+{
+	addr -= gfxmem_bank.start & gfxmem_bank.mask;
+	addr &= gfxmem_bank.mask;
+	do_put_mem_long ((uae_u32 *)(gfxmem_bank.baseaddr + addr), l);
+	picasso_dirty (addr);
+	picasso_dirty (addr + 3);
+}
+static void REGPARAM3 gfxmem_wput (uaecptr, uae_u32) REGPARAM;
+static void REGPARAM2 gfxmem_wput (uaecptr addr, uae_u32 w)
+{
+	addr -= gfxmem_bank.start & gfxmem_bank.mask;
+	addr &= gfxmem_bank.mask;
+	do_put_mem_word ((uae_u16 *)(gfxmem_bank.baseaddr + addr), w);
+	picasso_dirty (addr);
+	picasso_dirty (addr + 1);
+}
+static void REGPARAM3 gfxmem_bput (uaecptr, uae_u32) REGPARAM;
+static void REGPARAM2 gfxmem_bput (uaecptr addr, uae_u32 b)
+{
+	addr -= gfxmem_bank.start & gfxmem_bank.mask;
+	addr &= gfxmem_bank.mask;
+	gfxmem_bank.baseaddr[addr] = b;
+	picasso_dirty (addr);
+}
 
 addrbank gfxmem_bank = {
 	gfxmem_lget, gfxmem_wget, gfxmem_bget,
@@ -4033,6 +4175,7 @@ void InitPicasso96 (void)
 	oldscr = 0;
 	//fastscreen
 	memset (&picasso96_state, 0, sizeof (struct picasso96_state_struct));
+	rtg_simd_init (3);
 
 	for (i = 0; i < 256; i++) {
 		p2ctab[i][0] = (((i & 128) ? 0x01000000 : 0)
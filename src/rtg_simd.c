@@ -0,0 +1,512 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Vectorized RTG pixel conversion, fills and blits for picasso96.c
+  *
+  * Conversions to the 32-bit host format: 8-bit CLUT and 15/16-bit
+  * through their lookup tables (AVX2 gathers), 24/32-bit byte order
+  * swizzles. Rectangle fill and XOR and the BlitRect minterms work on
+  * bytes, so any pixel size. Kernels: SSE2, SSSE3, AVX2 and NEON,
+  * selected at runtime. Row functions do as many whole vectors as they
+  * can and return how much they did, the caller finishes the row with
+  * the scalar code. Results are identical to the scalar code.
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include "gfxdep/gfx.h"
+#include "options.h"
+#include "memory_uae.h"
+#include "picasso96.h"
+
+#ifdef PICASSO96
+
+#if defined (__x86_64__) || (defined (__i386__) && defined (__SSE2__))
+#define RTGSIMD_SSE2 1
+#include <emmintrin.h>
+#if defined (__GNUC__) && (__GNUC__ >= 5 || defined (__clang__))
+#define RTGSIMD_SSSE3 1
+#define RTGSIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+#if defined (__ARM_NEON) && defined (__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define RTGSIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef int (*clut32_kernel)(uae_u32 *dst, const uae_u8 *src, const uae_u32 *clut, int width);
+typedef int (*rgb16_kernel)(uae_u32 *dst, const uae_u16 *src, const uae_u32 *table, int width);
+typedef int (*swizzle_kernel)(uae_u32 *dst, const uae_u8 *src, int r, int g, int b, int width);
+typedef int (*fill_kernel)(uae_u8 *dst, const uae_u8 *pattern, int bytes);
+typedef int (*xor_kernel)(uae_u8 *dst, uae_u32 v, int bytes);
+typedef int (*rop_kernel)(BLIT_OPCODE opcode, uae_u8 *dst, const uae_u8 *src, int bytes);
+
+static clut32_kernel clut32;
+static rgb16_kernel rgb16;
+static swizzle_kernel swizzle3, swizzle4;
+static fill_kernel fill;
+static xor_kernel xor8;
+static rop_kernel rop;
+
+/* d = dst, s = src, n = all ones; everything except SRC, DST and SWAP */
+#define ROP_SWITCH(AND, OR, XOR, ANDNOT, ZERO) \
+	switch (opcode) { \
+	case BLIT_FALSE: ROP_LOOP (ZERO); break; \
+	case BLIT_NOR: ROP_LOOP (XOR (OR (s, d), n)); break; \
+	case BLIT_ONLYDST: ROP_LOOP (ANDNOT (s, d)); break; \
+	case BLIT_NOTSRC: ROP_LOOP (XOR (s, n)); break; \
+	case BLIT_ONLYSRC: ROP_LOOP (ANDNOT (d, s)); break; \
+	case BLIT_NOTDST: ROP_LOOP (XOR (d, n)); break; \
+	case BLIT_EOR: ROP_LOOP (XOR (s, d)); break; \
+	case BLIT_NAND: ROP_LOOP (XOR (AND (s, d), n)); break; \
+	case BLIT_AND: ROP_LOOP (AND (s, d)); break; \
+	case BLIT_NEOR: ROP_LOOP (XOR (XOR (s, d), n)); break; \
+	case BLIT_NOTONLYSRC: ROP_LOOP (OR (XOR (s, n), d)); break; \
+	case BLIT_NOTONLYDST: ROP_LOOP (OR (XOR (d, n), s)); break; \
+	case BLIT_OR: ROP_LOOP (OR (s, d)); break; \
+	case BLIT_TRUE: ROP_LOOP (n); break; \
+	default: return 0; \
+	}
+
+#ifdef RTGSIMD_SSE2
+
+/* 32-bit pixels, any byte order, with shifts */
+static int swizzle4_sse2 (uae_u32 *dst, const uae_u8 *src, int r, int g, int b, int width)
+{
+	const __m128i sr = _mm_cvtsi32_si128 (r * 8);
+	const __m128i sg = _mm_cvtsi32_si128 (g * 8);
+	const __m128i sb = _mm_cvtsi32_si128 (b * 8);
+	const __m128i ff = _mm_set1_epi32 (0xff);
+	int done;
+
+	for (done = 0; done + 4 <= width; done += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i*)(src + done * 4));
+		__m128i o = _mm_and_si128 (_mm_srl_epi32 (v, sb), ff);
+		o = _mm_or_si128 (o, _mm_slli_epi32 (_mm_and_si128 (_mm_srl_epi32 (v, sg), ff), 8));
+		o = _mm_or_si128 (o, _mm_slli_epi32 (_mm_and_si128 (_mm_srl_epi32 (v, sr), ff), 16));
+		_mm_storeu_si128 ((__m128i*)(dst + done), o);
+	}
+	return done;
+}
+
+static int fill_sse2 (uae_u8 *dst, const uae_u8 *pattern, int bytes)
+{
+	__m128i p0 = _mm_loadu_si128 ((const __m128i*)(pattern + 0));
+	__m128i p1 = _mm_loadu_si128 ((const __m128i*)(pattern + 16));
+	__m128i p2 = _mm_loadu_si128 ((const __m128i*)(pattern + 32));
+	int done;
+
+	for (done = 0; done + 48 <= bytes; done += 48) {
+		_mm_storeu_si128 ((__m128i*)(dst + done + 0), p0);
+		_mm_storeu_si128 ((__m128i*)(dst + done + 16), p1);
+		_mm_storeu_si128 ((__m128i*)(dst + done + 32), p2);
+	}
+	return done;
+}
+
+static int xor_sse2 (uae_u8 *dst, uae_u32 v, int bytes)
+{
+	const __m128i x = _mm_set1_epi32 (v);
+	int done;
+
+	for (done = 0; done + 16 <= bytes; done += 16) {
+		__m128i *p = (__m128i*)(dst + done);
+		_mm_storeu_si128 (p, _mm_xor_si128 (_mm_loadu_si128 (p), x));
+	}
+	return done;
+}
+
+#define ANDNOT128(a, b) _mm_andnot_si128 (a, b)
+#define ROP_LOOP(expr) \
+	for (done = 0; done + 16 <= bytes; done += 16) { \
+		__m128i s = _mm_loadu_si128 ((const __m128i*)(src + done)); \
+		__m128i d = _mm_loadu_si128 ((const __m128i*)(dst + done)); \
+		_mm_storeu_si128 ((__m128i*)(dst + done), expr); \
+	}
+
+static int rop_sse2 (BLIT_OPCODE opcode, uae_u8 *dst, const uae_u8 *src, int bytes)
+{
+	const __m128i n = _mm_set1_epi32 (-1);
+	int done = 0;
+
+	ROP_SWITCH (_mm_and_si128, _mm_or_si128, _mm_xor_si128, ANDNOT128, _mm_setzero_si128 ())
+	return done;
+}
+
+#undef ROP_LOOP
+
+#endif /* RTGSIMD_SSE2 */
+
+#ifdef RTGSIMD_SSSE3
+
+/* dst pixel p = bytes b, g, r of source pixel p, top byte zero */
+static __m128i swizzle_mask (int srcbytes, int r, int g, int b)
+{
+	uae_u8 m[16];
+	int p;
+
+	for (p = 0; p < 4; p++) {
+		m[p * 4 + 0] = p * srcbytes + b;
+		m[p * 4 + 1] = p * srcbytes + g;
+		m[p * 4 + 2] = p * srcbytes + r;
+		m[p * 4 + 3] = 0x80;
+	}
+	return _mm_loadu_si128 ((__m128i*)m);
+}
+
+__attribute__((target("ssse3")))
+static int swizzle4_ssse3 (uae_u32 *dst, const uae_u8 *src, int r, int g, int b, int width)
+{
+	const __m128i mask = swizzle_mask (4, r, g, b);
+	int done;
+
+	for (done = 0; done + 4 <= width; done += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i*)(src + done * 4));
+		_mm_storeu_si128 ((__m128i*)(dst + done), _mm_shuffle_epi8 (v, mask));
+	}
+	return done;
+}
+
+/* 4 pixels from a 16 byte load of which 12 are used, stops early
+ * enough not to read past the end of the row */
+__attribute__((target("ssse3")))
+static int swizzle3_ssse3 (uae_u32 *dst, const uae_u8 *src, int r, int g, int b, int width)
+{
+	const __m128i mask = swizzle_mask (3, r, g, b);
+	int done;
+
+	for (done = 0; done + 6 <= width; done += 4) {
+		__m128i v = _mm_loadu_si128 ((const __m128i*)(src + done * 3));
+		_mm_storeu_si128 ((__m128i*)(dst + done), _mm_shuffle_epi8 (v, mask));
+	}
+	return done;
+}
+
+#endif /* RTGSIMD_SSSE3 */
+
+#ifdef RTGSIMD_AVX2
+
+__attribute__((target("avx2")))
+static int clut32_avx2 (uae_u32 *dst, const uae_u8 *src, const uae_u32 *clut, int width)
+{
+	int done;
+
+	for (done = 0; done + 8 <= width; done += 8) {
+		__m256i idx = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i*)(src + done)));
+		_mm256_storeu_si256 ((__m256i*)(dst + done), _mm256_i32gather_epi32 ((const int*)clut, idx, 4));
+	}
+	return done;
+}
+
+__attribute__((target("avx2")))
+static int rgb16_avx2 (uae_u32 *dst, const uae_u16 *src, const uae_u32 *table, int width)
+{
+	int done;
+
+	for (done = 0; done + 8 <= width; done += 8) {
+		__m256i idx = _mm256_cvtepu16_epi32 (_mm_loadu_si128 ((const __m128i*)(src + done)));
+		_mm256_storeu_si256 ((__m256i*)(dst + done), _mm256_i32gather_epi32 ((const int*)table, idx, 4));
+	}
+	return done;
+}
+
+__attribute__((target("avx2")))
+static int swizzle4_avx2 (uae_u32 *dst, const uae_u8 *src, int r, int g, int b, int width)
+{
+	const __m256i mask = _mm256_broadcastsi128_si256 (swizzle_mask (4, r, g, b));
+	int done;
+
+	for (done = 0; done + 8 <= width; done += 8) {
+		__m256i v = _mm256_loadu_si256 ((const __m256i*)(src + done * 4));
+		_mm256_storeu_si256 ((__m256i*)(dst + done), _mm256_shuffle_epi8 (v, mask));
+	}
+	return done + swizzle4_ssse3 (dst + done, src + done * 4, r, g, b, width - done);
+}
+
+__attribute__((target("avx2")))
+static int fill_avx2 (uae_u8 *dst, const uae_u8 *pattern, int bytes)
+{
+	__m256i p0 = _mm256_loadu_si256 ((const __m256i*)(pattern + 0));
+	__m256i p1 = _mm256_loadu_si256 ((const __m256i*)(pattern + 32));
+	__m256i p2 = _mm256_loadu_si256 ((const __m256i*)(pattern + 64));
+	int done;
+
+	for (done = 0; done + 96 <= bytes; done += 96) {
+		_mm256_storeu_si256 ((__m256i*)(dst + done + 0), p0);
+		_mm256_storeu_si256 ((__m256i*)(dst + done + 32), p1);
+		_mm256_storeu_si256 ((__m256i*)(dst + done + 64), p2);
+	}
+	return done + fill_sse2 (dst + done, pattern, bytes - done);
+}
+
+__attribute__((target("avx2")))
+static int xor_avx2 (uae_u8 *dst, uae_u32 v, int bytes)
+{
+	const __m256i x = _mm256_set1_epi32 (v);
+	int done;
+
+	for (done = 0; done + 32 <= bytes; done += 32) {
+		__m256i *p = (__m256i*)(dst + done);
+		_mm256_storeu_si256 (p, _mm256_xor_si256 (_mm256_loadu_si256 (p), x));
+	}
+	return done + xor_sse2 (dst + done, v, bytes - done);
+}
+
+#define ANDNOT256(a, b) _mm256_andnot_si256 (a, b)
+#define ROP_LOOP(expr) \
+	for (done = 0; done + 32 <= bytes; done += 32) { \
+		__m256i s = _mm256_loadu_si256 ((const __m256i*)(src + done)); \
+		__m256i d = _mm256_loadu_si256 ((const __m256i*)(dst + done)); \
+		_mm256_storeu_si256 ((__m256i*)(dst + done), expr); \
+	}
+
+__attribute__((target("avx2")))
+static int rop_avx2 (BLIT_OPCODE opcode, uae_u8 *dst, const uae_u8 *src, int bytes)
+{
+	const __m256i n = _mm256_set1_epi32 (-1);
+	int done = 0;
+
+	ROP_SWITCH (_mm256_and_si256, _mm256_or_si256, _mm256_xor_si256, ANDNOT256, _mm256_setzero_si256 ())
+	return done + rop_sse2 (opcode, dst + done, src + done, bytes - done);
+}
+
+#undef ROP_LOOP
+
+#endif /* RTGSIMD_AVX2 */
+
+#ifdef RTGSIMD_NEON
+
+static int swizzle4_neon (uae_u32 *dst, const uae_u8 *src, int r, int g, int b, int width)
+{
+	int done;
+
+	for (done = 0; done + 16 <= width; done += 16) {
+		uint8x16x4_t v = vld4q_u8 (src + done * 4);
+		uint8x16x4_t o;
+		o.val[0] = v.val[b];
+		o.val[1] = v.val[g];
+		o.val[2] = v.val[r];
+		o.val[3] = vdupq_n_u8 (0);
+		vst4q_u8 ((uae_u8*)(dst + done), o);
+	}
+	return done;
+}
+
+static int swizzle3_neon (uae_u32 *dst, const uae_u8 *src, int r, int g, int b, int width)
+{
+	int done;
+
+	for (done = 0; done + 16 <= width; done += 16) {
+		uint8x16x3_t v = vld3q_u8 (src + done * 3);
+		uint8x16x4_t o;
+		o.val[0] = v.val[b];
+		o.val[1] = v.val[g];
+		o.val[2] = v.val[r];
+		o.val[3] = vdupq_n_u8 (0);
+		vst4q_u8 ((uae_u8*)(dst + done), o);
+	}
+	return done;
+}
+
+static int fill_neon (uae_u8 *dst, const uae_u8 *pattern, int bytes)
+{
+	uint8x16_t p0 = vld1q_u8 (pattern + 0);
+	uint8x16_t p1 = vld1q_u8 (pattern + 16);
+	uint8x16_t p2 = vld1q_u8 (pattern + 32);
+	int done;
+
+	for (done = 0; done + 48 <= bytes; done += 48) {
+		vst1q_u8 (dst + done + 0, p0);
+		vst1q_u8 (dst + done + 16, p1);
+		vst1q_u8 (dst + done + 32, p2);
+	}
+	return done;
+}
+
+static int xor_neon (uae_u8 *dst, uae_u32 v, int bytes)
+{
+	const uint8x16_t x = vreinterpretq_u8_u32 (vdupq_n_u32 (v));
+	int done;
+
+	for (done = 0; done + 16 <= bytes; done += 16)
+		vst1q_u8 (dst + done, veorq_u8 (vld1q_u8 (dst + done), x));
+	return done;
+}
+
+#define ANDNOTNEON(a, b) vbicq_u8 (b, a)
+#define ROP_LOOP(expr) \
+	for (done = 0; done + 16 <= bytes; done += 16) { \
+		uint8x16_t s = vld1q_u8 (src + done); \
+		uint8x16_t d = vld1q_u8 (dst + done); \
+		vst1q_u8 (dst + done, expr); \
+	}
+
+static int rop_neon (BLIT_OPCODE opcode, uae_u8 *dst, const uae_u8 *src, int bytes)
+{
+	const uint8x16_t n = vdupq_n_u8 (0xff);
+	int done = 0;
+
+	ROP_SWITCH (vandq_u8, vorrq_u8, veorq_u8, ANDNOTNEON, vdupq_n_u8 (0))
+	return done;
+}
+
+#undef ROP_LOOP
+
+#endif /* RTGSIMD_NEON */
+
+/* level: 0 = scalar only, 1 = SSE2/NEON, 2 = SSSE3, 3 = AVX2 */
+void rtg_simd_init (int level)
+{
+	const TCHAR *name = _T("scalar");
+
+	clut32 = NULL;
+	rgb16 = NULL;
+	swizzle3 = swizzle4 = NULL;
+	fill = NULL;
+	xor8 = NULL;
+	rop = NULL;
+#ifdef RTGSIMD_NEON
+	if (level > 0) {
+		swizzle3 = swizzle3_neon;
+		swizzle4 = swizzle4_neon;
+		fill = fill_neon;
+		xor8 = xor_neon;
+		rop = rop_neon;
+		name = _T("NEON");
+	}
+#endif
+#ifdef RTGSIMD_SSE2
+	if (level > 0) {
+		swizzle4 = swizzle4_sse2;
+		fill = fill_sse2;
+		xor8 = xor_sse2;
+		rop = rop_sse2;
+		name = _T("SSE2");
+	}
+#endif
+#if defined (RTGSIMD_SSSE3) || defined (RTGSIMD_AVX2)
+	if (level > 1)
+		__builtin_cpu_init ();
+#endif
+#ifdef RTGSIMD_SSSE3
+	if (level > 1 && __builtin_cpu_supports ("ssse3")) {
+		swizzle3 = swizzle3_ssse3;
+		swizzle4 = swizzle4_ssse3;
+		name = _T("SSSE3");
+	}
+#endif
+#ifdef RTGSIMD_AVX2
+	if (level > 2 && __builtin_cpu_supports ("avx2")) {
+		clut32 = clut32_avx2;
+		rgb16 = rgb16_avx2;
+		swizzle4 = swizzle4_avx2;
+		fill = fill_avx2;
+		xor8 = xor_avx2;
+		rop = rop_avx2;
+		name = _T("AVX2");
+	}
+#endif
+	write_log (_T("RTG conversion and blits: %s\n"), name);
+}
+
+/* 8-bit CLUT to 32-bit, returns pixels done */
+int rtg_simd_clut32 (uae_u32 *dst, const uae_u8 *src, const uae_u32 *clut, int width)
+{
+	if (!clut32 || width <= 0)
+		return 0;
+	return clut32 (dst, src, clut, width);
+}
+
+/* 15/16-bit to 32-bit through p96_rgbx16[], returns pixels done */
+int rtg_simd_rgb16to32 (uae_u32 *dst, const uae_u16 *src, const uae_u32 *table, int width)
+{
+	if (!rgb16 || width <= 0)
+		return 0;
+	return rgb16 (dst, src, table, width);
+}
+
+/* 24 or 32-bit pixels (srcbytes) with red, green and blue at byte
+ * offsets r, g and b to host 0x00RRGGBB, returns pixels done */
+int rtg_simd_swizzle (uae_u32 *dst, const uae_u8 *src, int srcbytes, int r, int g, int b, int width)
+{
+	swizzle_kernel k = srcbytes == 4 ? swizzle4 : swizzle3;
+
+	if (!k || width <= 0)
+		return 0;
+	return k (dst, src, r, g, b, width);
+}
+
+/* pen in memory byte order, bpp 1-4, returns bytes done (whole pixels) */
+int rtg_simd_fill (uae_u8 *dst, uae_u32 pen, int bpp, int bytes)
+{
+	uae_u8 pattern[96];
+	int i;
+
+	if (!fill || bytes < 48)
+		return 0;
+	for (i = 0; i < 96; i++)
+		pattern[i] = pen >> ((i % bpp) * 8);
+	return fill (dst, pattern, bytes);
+}
+
+/* returns bytes done */
+int rtg_simd_xor (uae_u8 *dst, uae_u32 v, int bytes)
+{
+	if (!xor8 || bytes <= 0)
+		return 0;
+	return xor8 (dst, v, bytes);
+}
+
+static void rop_row (BLIT_OPCODE opcode, uae_u8 *dst, const uae_u8 *src, int bytes)
+{
+	int i;
+
+	for (i = 0; i < bytes; i++) {
+		uae_u8 s = src[i], d = dst[i];
+		switch (opcode) {
+		case BLIT_FALSE: d = 0; break;
+		case BLIT_NOR: d = ~(s | d); break;
+		case BLIT_ONLYDST: d = d & ~s; break;
+		case BLIT_NOTSRC: d = ~s; break;
+		case BLIT_ONLYSRC: d = s & ~d; break;
+		case BLIT_NOTDST: d = ~d; break;
+		case BLIT_EOR: d = s ^ d; break;
+		case BLIT_NAND: d = ~(s & d); break;
+		case BLIT_AND: d = s & d; break;
+		case BLIT_NEOR: d = ~(s ^ d); break;
+		case BLIT_NOTONLYSRC: d = ~s | d; break;
+		case BLIT_NOTONLYDST: d = ~d | s; break;
+		case BLIT_OR: d = s | d; break;
+		case BLIT_TRUE: d = 0xff; break;
+		default: break;
+		}
+		dst[i] = d;
+	}
+}
+
+/* Whole BlitRect () rectangle with minterm opcode, bytes per row, rows
+ * top to bottom like p96_blit.c. Returns false if the opcode is not
+ * handled here (SRC, DST and SWAP) or if a destination row overlaps
+ * the end of its source row, p96_blit.c then reads source it already
+ * overwrote and the result depends on its word size. */
+bool rtg_simd_blit (BLIT_OPCODE opcode, uae_u8 *src, uae_u8 *dst, int bytes, int height, int srcpitch, int dstpitch)
+{
+	int y;
+
+	if (!rop || opcode == BLIT_SRC || opcode == BLIT_DST || opcode == BLIT_SWAP || opcode > BLIT_TRUE)
+		return false;
+	for (y = 0; y < height; y++) {
+		uae_u8 *s = src + y * srcpitch, *d = dst + y * dstpitch;
+		if (d > s && d < s + bytes)
+			return false;
+	}
+	for (y = 0; y < height; y++, src += srcpitch, dst += dstpitch) {
+		int done = rop (opcode, dst, src, bytes);
+		rop_row (opcode, dst + done, src + done, bytes - done);
+	}
+	return true;
+}
+
+#endif /* PICASSO96 */
@@ -65,6 +65,8 @@
 #include "inputrecord.h"
 #include "disk.h"
 #include "misc.h"
+#include "threaddep/thread.h"
+#include "sleep.h"
 
 int savestate_state = 0;
 static int savestate_first_capture;
@@ -87,14 +89,28 @@ struct staterecord
 {
 	int len;
 	int inuse;
+	int keyframe;
+	int serial;
 	uae_u8 *cpu;
 	uae_u8 *data;
+	uae_u8 *ram;
 	uae_u8 *end;
 	int inprecoffset;
 };
 
 static struct staterecord **staterecords;
 
+/* Rewind buffer RAM is stored in STATERECORD_PAGE sized pages. Keyframe
+ * records contain every page, other records only the pages written since
+ * the previous capture, as marked by the memory bank put handlers in the
+ * bank's dirty page map (memory_dirty ()).
+ */
+#define STATERECORD_PAGE RAM_DIRTY_PAGE
+#define STATERECORD_RAMS 4
+static int staterecord_dirtylen[STATERECORD_RAMS];
+static int staterecords_sincekey;
+static int staterecords_serial;
+
 static void state_incompatible_warn (void)
 {
 	static int warned;
@@ -302,7 +318,8 @@ TCHAR *restore_path_func (uae_u8 **dstp, int type)
 #ifdef SAVESTATE
 /* read and write IFF-style hunks */
 
-static void save_chunk (struct zfile *f, uae_u8 *chunk, size_t len, TCHAR *name, int compress)
+/* returns false if the file could not be written */
+static bool save_chunk_data (struct zfile *f, uae_u8 *chunk, size_t len, TCHAR *name, int compress)
 {
 	uae_u8 tmp[8], *dst;
 	uae_u8 zero[4]= { 0, 0, 0, 0 };
@@ -310,30 +327,32 @@ static void save_chunk (struct zfile *f, uae_u8 *chunk, size_t len, TCHAR *name,
 	size_t pos;
 	size_t chunklen, len2;
 	char *s;
+	bool ok = true;
 
 	if (!chunk)
-		return;
+		return true;
 
-	if (compress < 0) {
-		zfile_fwrite (chunk, 1, len, f);
-		return;
-	}
+	if (compress < 0)
+		return zfile_fwrite (chunk, 1, len, f) == len;
 
 	/* chunk name */
 	s = ua (name);
-	zfile_fwrite (s, 1, 4, f);
+	if (zfile_fwrite (s, 1, 4, f) != 4)
+		ok = false;
 	xfree (s);
 	pos = zfile_ftell (f);
 	/* chunk size */
 	dst = &tmp[0];
 	chunklen = len + 4 + 4 + 4;
 	save_u32 (chunklen);
-	zfile_fwrite (&tmp[0], 1, 4, f);
+	if (zfile_fwrite (&tmp[0], 1, 4, f) != 4)
+		ok = false;
 	/* chunk flags */
 	flags = 0;
 	dst = &tmp[0];
 	save_u32 (flags | compress);
-	zfile_fwrite (&tmp[0], 1, 4, f);
+	if (zfile_fwrite (&tmp[0], 1, 4, f) != 4)
+		ok = false;
 	/* chunk data */
 	if (compress) {
 		int tmplen = len;
@@ -341,13 +360,15 @@ static void save_chunk (struct zfile *f, uae_u8 *chunk, size_t len, TCHAR *name,
 		dst = &tmp[0];
 		save_u32 (len);
 		opos = zfile_ftell (f);
-		zfile_fwrite (&tmp[0], 1, 4, f);
+		if (zfile_fwrite (&tmp[0], 1, 4, f) != 4)
+			ok = false;
 		len = zfile_zcompress (f, chunk, len);
 		if (len > 0) {
 			zfile_fseek (f, pos, SEEK_SET);
 			dst = &tmp[0];
 			save_u32 (len + 4 + 4 + 4 + 4);
-			zfile_fwrite (&tmp[0], 1, 4, f);
+			if (zfile_fwrite (&tmp[0], 1, 4, f) != 4)
+				ok = false;
 			zfile_fseek (f, 0, SEEK_END);
 		} else {
 			len = tmplen;
@@ -355,17 +376,181 @@ static void save_chunk (struct zfile *f, uae_u8 *chunk, size_t len, TCHAR *name,
 			zfile_fseek (f, opos, SEEK_SET);
 			dst = &tmp[0];
 			save_u32 (flags);
-			zfile_fwrite (&tmp[0], 1, 4, f);
+			if (zfile_fwrite (&tmp[0], 1, 4, f) != 4)
+				ok = false;
 		}
 	}
-	if (!compress)
-		zfile_fwrite (chunk, 1, len, f);
+	if (!compress && zfile_fwrite (chunk, 1, len, f) != len)
+		ok = false;
 	/* alignment */
 	len2 = 4 - (len & 3);
-	if (len2)
-		zfile_fwrite (zero, 1, len2, f);
+	if (len2 && zfile_fwrite (zero, 1, len2, f) != len2)
+		ok = false;
 
 	write_log (_T("Chunk '%s' chunk size %ld (%ld)\n"), name, (long) chunklen, (long) len);
+	return ok;
+}
+
+#ifdef SUPPORT_THREADS
+
+/* Background state saving (quicksave)
+ *
+ * State is snapshotted into memory on the emulation thread. Chunks that
+ * would be compressed are copied and queued, everything else is written to
+ * a memory file. Compression and file writes are done by savestate_thread,
+ * savestate_async_poll() reports completion at vsync.
+ */
+
+struct savestate_chunk
+{
+	struct savestate_chunk *next;
+	uae_s64 pos;
+	TCHAR name[5];
+	uae_u8 *data;
+	size_t len;
+};
+
+struct savestate_job
+{
+	TCHAR filename[MAX_DPATH];
+	struct zfile *f;
+	uae_u8 *data;
+	uae_s64 len;
+	struct savestate_chunk *chunks;
+	bool failed;
+};
+
+static smp_comm_pipe savestate_requests;
+static uae_sem_t savestate_done_sem;
+static volatile int savestate_thread_running;
+static struct savestate_job *savestate_job_active;
+static struct savestate_chunk **savestate_queue_tail;
+
+static void savestate_job_free (struct savestate_job *job)
+{
+	struct savestate_chunk *c;
+
+	while ((c = job->chunks)) {
+		job->chunks = c->next;
+		xfree (c->data);
+		xfree (c);
+	}
+	xfree (job->data);
+	xfree (job);
+}
+
+static void *savestate_thread (void *v)
+{
+	struct savestate_job *job;
+	struct savestate_chunk *c;
+	uae_s64 pos;
+
+	for (;;) {
+		job = (struct savestate_job*)read_comm_pipe_pvoid_blocking (&savestate_requests);
+		if (!job)
+			break;
+		pos = 0;
+		for (c = job->chunks; c; c = c->next) {
+			if (zfile_fwrite (job->data + pos, 1, c->pos - pos, job->f) != (size_t)(c->pos - pos))
+				job->failed = true;
+			if (!save_chunk_data (job->f, c->data, c->len, c->name, 1))
+				job->failed = true;
+			pos = c->pos;
+		}
+		if (zfile_fwrite (job->data + pos, 1, job->len - pos, job->f) != (size_t)(job->len - pos))
+			job->failed = true;
+		if (zfile_fflush (job->f))
+			job->failed = true;
+		uae_sem_post (&savestate_done_sem);
+	}
+	savestate_thread_running = -1;
+	return 0;
+}
+
+static void savestate_async_finish (void)
+{
+	struct savestate_job *job = savestate_job_active;
+
+	savestate_job_active = NULL;
+	gui_data.statesave = 0;
+	zfile_fclose (job->f);
+	if (job->failed) {
+		write_log (_T("Save of '%s' failed, write error\n"), job->filename);
+		notify_user (NUMSG_STATESAVEFAIL, job->filename);
+	} else {
+		write_log (_T("Save of '%s' complete\n"), job->filename);
+	}
+	savestate_job_free (job);
+}
+
+/* called at vsync, cleans up finished background save */
+static void savestate_async_poll (void)
+{
+	if (savestate_job_active && uae_sem_trywait (&savestate_done_sem) == 0)
+		savestate_async_finish ();
+}
+
+/* wait until background save has been written */
+static void savestate_async_wait (void)
+{
+	if (!savestate_job_active)
+		return;
+	uae_sem_wait (&savestate_done_sem);
+	savestate_async_finish ();
+}
+
+static void savestate_async_free (void)
+{
+	savestate_async_wait ();
+	if (savestate_thread_running > 0) {
+		savestate_thread_running = 0;
+		write_comm_pipe_pvoid (&savestate_requests, NULL, 1);
+		while (savestate_thread_running == 0)
+			sleep_millis (10);
+		savestate_thread_running = 0;
+		destroy_comm_pipe (&savestate_requests);
+		uae_sem_destroy (&savestate_done_sem);
+	}
+}
+
+static bool savestate_queue_chunk (struct zfile *f, uae_u8 *chunk, size_t len, TCHAR *name)
+{
+	struct savestate_chunk *c;
+
+	c = xcalloc (struct savestate_chunk, 1);
+	if (!c)
+		return false;
+	c->data = xmalloc (uae_u8, len);
+	if (!c->data) {
+		xfree (c);
+		return false;
+	}
+	memcpy (c->data, chunk, len);
+	c->len = len;
+	c->pos = zfile_ftell (f);
+	_tcsncpy (c->name, name, 4);
+	*savestate_queue_tail = c;
+	savestate_queue_tail = &c->next;
+	return true;
+}
+
+#else
+
+#define savestate_async_poll()
+#define savestate_async_wait()
+#define savestate_async_free()
+
+#endif
+
+static void save_chunk (struct zfile *f, uae_u8 *chunk, size_t len, TCHAR *name, int compress)
+{
+#ifdef SUPPORT_THREADS
+	if (chunk && compress > 0 && savestate_queue_tail) {
+		if (savestate_queue_chunk (f, chunk, len, name))
+			return;
+	}
+#endif
+	save_chunk_data (f, chunk, len, name, compress);
 }
 
 static uae_u8 *restore_chunk (struct zfile *f, TCHAR *name, size_t *len, size_t *totallen, size_t *filepos)
@@ -501,6 +686,7 @@ void restore_state (const TCHAR *filename)
 	size_t filepos, filesize;
 	int z3num;
 
+	savestate_async_wait ();
 	chunk = 0;
 	f = zfile_fopen (filename, _T("rb"), ZFD_NORMAL);
 	if (!f)
@@ -1070,7 +1256,7 @@ static int save_state_internal (struct zfile *f, const TCHAR *description, int c
 	return 1;
 }
 
-int save_state (const TCHAR *filename, const TCHAR *description)
+static int save_state_2 (const TCHAR *filename, const TCHAR *description, bool async)
 {
 	struct zfile *f;
 	int comp = savestate_docompress;
@@ -1084,6 +1270,7 @@ int save_state (const TCHAR *filename, const TCHAR *description)
 		}
 #endif
 	}
+	savestate_async_wait ();
 	new_blitter = false;
 	savestate_nodialogs = 0;
 	custom_prepare_savestate ();
@@ -1112,14 +1299,62 @@ int save_state (const TCHAR *filename, const TCHAR *description)
 		zfile_fclose (f);
 		return 1;
 	}
+#ifdef SUPPORT_THREADS
+	if (async && !savestate_thread_running) {
+		init_comm_pipe (&savestate_requests, 10, 1);
+		uae_sem_init (&savestate_done_sem, 0, 0);
+		savestate_thread_running = 1;
+		if (!uae_start_thread (_T("savestate"), savestate_thread, NULL, NULL)) {
+			savestate_thread_running = 0;
+			destroy_comm_pipe (&savestate_requests);
+			uae_sem_destroy (&savestate_done_sem);
+		}
+	}
+	if (async && savestate_thread_running > 0) {
+		struct savestate_job *job = xcalloc (struct savestate_job, 1);
+		struct zfile *mf = zfile_fopen_empty (NULL, filename, 0);
+		if (job && mf) {
+			savestate_queue_tail = &job->chunks;
+			int v = save_state_internal (mf, description, comp, true);
+			savestate_queue_tail = NULL;
+			job->len = zfile_size (mf);
+			job->data = zfile_getdata (mf, 0, job->len);
+			zfile_fclose (mf);
+			savestate_state = 0;
+			if (!v || !job->data) {
+				savestate_job_free (job);
+				zfile_fclose (f);
+				return 0;
+			}
+			_tcscpy (job->filename, filename);
+			job->f = f;
+			savestate_job_active = job;
+			gui_data.statesave = 1;
+			write_comm_pipe_pvoid (&savestate_requests, job, 1);
+			return v;
+		}
+		xfree (job);
+		zfile_fclose (mf);
+	}
+#endif
 	int v = save_state_internal (f, description, comp, true);
-	if (v)
+	if (v && zfile_fflush (f)) {
+		write_log (_T("Save of '%s' failed, write error\n"), filename);
+		notify_user (NUMSG_STATESAVEFAIL, filename);
+		v = 0;
+	} else if (v) {
 		write_log (_T("Save of '%s' complete\n"), filename);
+	}
 	zfile_fclose (f);
 	savestate_state = 0;
 	return v;
 }
 
+int save_state (const TCHAR *filename, const TCHAR *description)
+{
+	return save_state_2 (filename, description, false);
+}
+
 void savestate_quick (int slot, int save)
 {
 	int i, len = _tcslen (savestate_fname);
@@ -1141,8 +1376,9 @@ void savestate_quick (int slot, int save)
 	if (save) {
 		write_log (_T("saving '%s'\n"), savestate_fname);
 		savestate_docompress = 1;
-		save_state (savestate_fname, _T(""));
+		save_state_2 (savestate_fname, _T(""), true);
 	} else {
+		savestate_async_wait ();
 		if (!zfile_exists (savestate_fname)) {
 			write_log (_T("staterestore, file '%s' not found\n"), savestate_fname);
 			return;
@@ -1154,6 +1390,7 @@ void savestate_quick (int slot, int save)
 
 bool savestate_check (void)
 {
+	savestate_async_poll ();
 	if (vpos == 0 && !savestate_state) {
 		if (hsync_counter == 0 && input_play == INPREC_PLAY_NORMAL)
 			savestate_memorysave ();
@@ -1171,6 +1408,168 @@ bool savestate_check (void)
 
 static int rewindmode;
 
+static uae_u8 *staterecord_getram (int num, int *len)
+{
+	*len = 0;
+	switch (num)
+	{
+	case 0:
+		return save_cram (len);
+	case 1:
+		return save_bram (len);
+#ifdef AUTOCONFIG
+	case 2:
+		return save_fram (len);
+	case 3:
+		return save_zram (len, 0);
+#endif
+	}
+	return NULL;
+}
+
+static addrbank *staterecord_getbank (int num)
+{
+	switch (num)
+	{
+	case 0:
+		return &chipmem_bank;
+	case 1:
+		return &bogomem_bank;
+#ifdef AUTOCONFIG
+	case 2:
+		return &fastmem_bank;
+	case 3:
+		return &z3fastmem_bank;
+#endif
+	}
+	return NULL;
+}
+
+static bool staterecord_delta (void)
+{
+	return currprefs.statecapturekeyframe > 1;
+}
+
+static void staterecord_freedirty (void)
+{
+	int i;
+
+	for (i = 0; i < STATERECORD_RAMS; i++) {
+		if (staterecord_getbank (i))
+			memory_dirty_free (staterecord_getbank (i));
+		staterecord_dirtylen[i] = 0;
+	}
+	staterecords_sincekey = -1;
+}
+
+/* start or restart dirty page tracking, returns true if next capture must be a keyframe */
+static bool staterecord_checkdirty (void)
+{
+	bool keyframe = staterecords_sincekey < 0;
+	int i, len;
+
+	if (!staterecord_delta () || memory_dirty_untracked ()) {
+		if (staterecords_sincekey >= 0 || staterecord_dirtylen[0])
+			staterecord_freedirty ();
+		return true;
+	}
+	for (i = 0; i < STATERECORD_RAMS; i++) {
+		staterecord_getram (i, &len);
+		if (staterecord_dirtylen[i] == len)
+			continue;
+		staterecord_dirtylen[i] = len;
+		if (!memory_dirty_alloc (staterecord_getbank (i)) && len) {
+			staterecord_freedirty ();
+			return true;
+		}
+		keyframe = true;
+	}
+	if (staterecords_sincekey + 1 >= currprefs.statecapturekeyframe)
+		keyframe = true;
+	return keyframe;
+}
+
+/* RAM now matches the restored record, capture after this is delta against it */
+static void staterecord_cleardirty (void)
+{
+	addrbank *ab;
+	int i;
+
+	for (i = 0; i < STATERECORD_RAMS; i++) {
+		ab = staterecord_getbank (i);
+		if (ab && ab->dirty)
+			memset (ab->dirty, 0, (staterecord_dirtylen[i] >> RAM_DIRTY_SHIFT) + 1);
+	}
+}
+
+static uae_u8 *staterecord_save_ram (uae_u8 *p, int num, bool keyframe)
+{
+	uae_u8 *mem, *dirty, *pcnt;
+	int len, offset, size, cnt;
+
+	mem = staterecord_getram (num, &len);
+	dirty = len ? staterecord_getbank (num)->dirty : NULL;
+	if (!dirty)
+		keyframe = true;
+	save_u32_func (&p, len);
+	pcnt = p;
+	save_u32_func (&p, 0);
+	cnt = 0;
+	for (offset = 0; offset < len; offset += STATERECORD_PAGE) {
+		size = len - offset > STATERECORD_PAGE ? STATERECORD_PAGE : len - offset;
+		if (!keyframe && !dirty[offset >> RAM_DIRTY_SHIFT])
+			continue;
+		save_u32_func (&p, offset);
+		memcpy (p, mem + offset, size);
+		p += size;
+		if (dirty)
+			dirty[offset >> RAM_DIRTY_SHIFT] = 0;
+		cnt++;
+	}
+	save_u32_func (&pcnt, cnt);
+	return p;
+}
+
+static uae_u8 *staterecord_restore_ram (uae_u8 *p, int num)
+{
+	uae_u8 *mem;
+	uae_u32 len, offset, size;
+	int mlen, cnt;
+
+	mem = staterecord_getram (num, &mlen);
+	len = restore_u32_func (&p);
+	cnt = restore_u32_func (&p);
+	while (cnt-- > 0) {
+		offset = restore_u32_func (&p);
+		size = len - offset > STATERECORD_PAGE ? STATERECORD_PAGE : len - offset;
+		if (offset + size <= (uae_u32)mlen)
+			memcpy (mem + offset, p, size);
+		p += size;
+	}
+	return p;
+}
+
+/* find keyframe that record pos depends on, -1 if it has already been overwritten */
+static int staterecord_keyframe (int pos)
+{
+	struct staterecord *st;
+	int i, serial = 0;
+
+	for (i = 0; i < staterecords_max; i++) {
+		st = staterecords[pos];
+		if (st == NULL || st->inuse == 0)
+			return -1;
+		if (i > 0 && st->serial != serial - 1)
+			return -1;
+		if (st->keyframe)
+			return pos;
+		serial = st->serial;
+		pos--;
+		if (pos < 0)
+			pos += staterecords_max;
+	}
+	return -1;
+}
 
 static struct staterecord *canrewind (int pos)
 {
@@ -1184,6 +1583,8 @@ static struct staterecord *canrewind (int pos)
 		return NULL;
 	if ((pos + 1) % staterecords_max  == staterecords_first)
 		return NULL;
+	if (staterecord_keyframe (pos) < 0)
+		return NULL;
 	return staterecords[pos];
 }
 
@@ -1202,9 +1603,8 @@ int savestate_dorewind (int pos)
 
 void savestate_rewind (void)
 {
-	uae_u32 len;
-	int i, dummy;
-	uae_u8 *p, *p2;
+	int i, j, keydist;
+	uae_u8 *p, *p2, *p3;
 	struct staterecord *st;
 	int pos;
 	bool rewind = false;
@@ -1225,6 +1625,7 @@ void savestate_rewind (void)
 	}
 	p = st->data;
 	p2 = st->end;
+	keydist = 0;
 	write_log (_T("rewinding %d -> %d\n"), replaycounter - 1, pos);
 	hsync_counter = restore_u32_func (&p);
 	vsync_counter = restore_u32_func (&p);
@@ -1266,20 +1667,15 @@ void savestate_rewind (void)
 	if (restore_u32_func (&p))
 		p = restore_p96 (p);
 #endif
-	len = restore_u32_func (&p);
-	memcpy (chipmem_bank.baseaddr, p, currprefs.chipmem_size > len ? len : currprefs.chipmem_size);
-	p += len;
-	len = restore_u32_func (&p);
-	memcpy (save_bram (&dummy), p, currprefs.bogomem_size > len ? len : currprefs.bogomem_size);
-	p += len;
-#ifdef AUTOCONFIG
-	len = restore_u32_func (&p);
-	memcpy (save_fram (&dummy), p, currprefs.fastmem_size > len ? len : currprefs.fastmem_size);
-	p += len;
-	len = restore_u32_func (&p);
-	memcpy (save_zram (&dummy, 0), p, currprefs.z3fastmem_size > len ? len : currprefs.z3fastmem_size);
-	p += len;
-#endif
+	// apply keyframe and all following deltas up to this record
+	for (j = staterecord_keyframe (pos); j != pos; j = (j + 1) % staterecords_max) {
+		p3 = staterecords[j]->ram;
+		for (i = 0; i < STATERECORD_RAMS; i++)
+			p3 = staterecord_restore_ram (p3, i);
+		keydist++;
+	}
+	for (i = 0; i < STATERECORD_RAMS; i++)
+		p = staterecord_restore_ram (p, i);
 #ifdef ACTION_REPLAY
 	if (restore_u32_func (&p))
 		p = restore_action_replay (p);
@@ -1315,6 +1711,11 @@ void savestate_rewind (void)
 		return;
 	}
 	inprec_setposition (st->inprecoffset, pos);
+	staterecords_serial = st->serial + 1;
+	if (staterecord_delta ()) {
+		staterecords_sincekey = keydist;
+		staterecord_cleardirty ();
+	}
 	write_log (_T("state %d restored.  (%010ld/%03ld)\n"), pos, hsync_counter, vsync_counter);
 	if (rewind) {
 		replaycounter--;
@@ -1335,6 +1736,34 @@ STATIC_INLINE int bufcheck (struct staterecord *sr, uae_u8 *p, int len)
 	return 0;
 }
 
+/* drop oldest records until rewind buffer fits in state_replay_memory */
+static void staterecords_trim (void)
+{
+	size_t total, limit;
+	int i, pos;
+
+	limit = (size_t)currprefs.statecapturememory * 1024 * 1024;
+	if (!limit)
+		return;
+	total = 0;
+	for (i = 0; i < staterecords_max; i++) {
+		if (staterecords[i])
+			total += staterecords[i]->len;
+	}
+	// newest record (replaycounter - 1) is always kept
+	pos = replaycounter;
+	for (i = 0; i < staterecords_max - 1 && total > limit; i++) {
+		if (staterecords[pos]) {
+			total -= staterecords[pos]->len;
+			xfree (staterecords[pos]);
+			staterecords[pos] = NULL;
+		}
+		pos++;
+		if (pos >= staterecords_max)
+			pos -= staterecords_max;
+	}
+}
+
 void savestate_memorysave (void)
 {
 	new_blitter = true;
@@ -1347,10 +1776,11 @@ void savestate_memorysave (void)
 
 void savestate_capture (int force)
 {
-	uae_u8 *p, *p2, *p3, *dst;
-	int i, len, tlen, retrycnt;
+	uae_u8 *p, *p2, *p3;
+	int i, len, tlen, retrycnt, grow;
 	struct staterecord *st;
 	bool firstcapture = false;
+	bool keyframe, ramdone;
 
 #ifdef FILESYS
 	if (nr_units ())
@@ -1376,20 +1806,30 @@ void savestate_capture (int force)
 	}
 	savestate_first_capture = false;
 
+	keyframe = staterecord_checkdirty ();
 	retrycnt = 0;
+	grow = 0;
+	ramdone = false;
 retry2:
 	st = staterecords[replaycounter];
 	if (st == NULL) {
 		st = (struct staterecord*)xmalloc (uae_u8, statefile_alloc);
 		st->len = statefile_alloc;
 	} else if (retrycnt > 0) {
-		write_log (_T("realloc %d -> %d\n"), st->len, st->len + STATEFILE_ALLOC_SIZE);
-		st->len += STATEFILE_ALLOC_SIZE;
+		if (grow < STATEFILE_ALLOC_SIZE)
+			grow = STATEFILE_ALLOC_SIZE;
+		write_log (_T("realloc %d -> %d\n"), st->len, st->len + grow);
+		st->len += grow;
 		st = (struct staterecord*)xrealloc (uae_u8, st, st->len);
+		grow = 0;
 	}
-	if (st->len > statefile_alloc)
+	if (st->len > statefile_alloc && !staterecord_delta ())
 		statefile_alloc = st->len;
+	// dirty pages were already partially cleared, a delta would be incomplete
+	if (ramdone)
+		keyframe = true;
 	st->inuse = 0;
+	st->keyframe = keyframe;
 	st->data = (uae_u8*)(st + 1);
 	staterecords[replaycounter] = st;
 	retrycnt++;
@@ -1558,36 +1998,22 @@ retry2:
 	}
 #endif
 
-	dst = save_cram (&len);
-	if (bufcheck (st, p, len))
-		goto retry;
-	save_u32_func (&p, len);
-	memcpy (p, dst, len);
-	tlen += len + 4;
-	p += len;
-	dst = save_bram (&len);
-	if (bufcheck (st, p, len))
-		goto retry;
-	save_u32_func (&p, len);
-	memcpy (p, dst, len);
-	tlen += len + 4;
-	p += len;
-#ifdef AUTOCONFIG
-	dst = save_fram (&len);
-	if (bufcheck (st, p, len))
-		goto retry;
-	save_u32_func (&p, len);
-	memcpy (p, dst, len);
-	tlen += len + 4;
-	p += len;
-	dst = save_zram (&len, 0);
-	if (bufcheck (st, p, len))
+	// worst case is a keyframe: every page plus its offset
+	len = 0;
+	for (i = 0; i < STATERECORD_RAMS; i++) {
+		int ramlen;
+		staterecord_getram (i, &ramlen);
+		len += 8 + ramlen + (ramlen + STATERECORD_PAGE - 1) / STATERECORD_PAGE * 4;
+	}
+	if (bufcheck (st, p, len)) {
+		grow = len;
 		goto retry;
-	save_u32_func (&p, len);
-	memcpy (p, dst, len);
-	tlen += len + 4;
-	p += len;
-#endif
+	}
+	st->ram = p;
+	for (i = 0; i < STATERECORD_RAMS; i++)
+		p = staterecord_save_ram (p, i, keyframe);
+	tlen += p - st->ram;
+	ramdone = true;
 #ifdef ACTION_REPLAY
 	if (bufcheck (st, p, 0))
 		goto retry;
@@ -1683,7 +2109,26 @@ retry2:
 	save_u32_func (&p, tlen);
 	st->end = p;
 	st->inuse = 1;
+	st->serial = staterecords_serial++;
 	st->inprecoffset = inprec_getposition ();
+	staterecords_sincekey = keyframe ? 0 : staterecords_sincekey + 1;
+
+	if (staterecord_delta ()) {
+		// delta records are much smaller than keyframes, don't keep keyframe sized buffers around
+		struct staterecord *st2;
+		int ramoffset = st->ram - (uae_u8*)st;
+		int endoffset = st->end - (uae_u8*)st;
+		st2 = (struct staterecord*)xrealloc (uae_u8, st, endoffset);
+		if (st2) {
+			st = st2;
+			st->len = endoffset;
+			st->data = (uae_u8*)(st + 1);
+			st->cpu = NULL;
+			st->ram = (uae_u8*)st + ramoffset;
+			st->end = (uae_u8*)st + endoffset;
+			staterecords[replaycounter] = st;
+		}
+	}
 
 	replaycounter++;
 	if (replaycounter >= staterecords_max)
@@ -1694,8 +2139,10 @@ retry2:
 			staterecords_first -= staterecords_max;
 	}
 
-	write_log (_T("state capture %d (%010ld/%03ld,%ld/%d) (%ld bytes, alloc %d)\n"),
-		replaycounter, hsync_counter, vsync_counter,
+	staterecords_trim ();
+
+	write_log (_T("state capture %d%s (%010ld/%03ld,%ld/%d) (%ld bytes, alloc %d)\n"),
+		replaycounter, keyframe ? _T(" key") : _T(""), hsync_counter, vsync_counter,
 		hsync_counter % current_maxvpos (), current_maxvpos (),
 		st->end - st->data, statefile_alloc);
 
@@ -1721,8 +2168,16 @@ retry:
 
 void savestate_free (void)
 {
+	int i;
+
+	if (staterecords) {
+		for (i = 0; i < staterecords_max; i++)
+			xfree (staterecords[i]);
+	}
 	xfree (staterecords);
 	staterecords = NULL;
+	staterecord_freedirty ();
+	savestate_async_free ();
 }
 
 void savestate_capture_request (void)
@@ -1734,6 +2189,7 @@ void savestate_init (void)
 {
 	savestate_free ();
 	replaycounter = 0;
+	staterecords_serial = 0;
 	staterecords_max = currprefs.statecapturebuffersize;
 	staterecords = xcalloc (struct staterecord*, staterecords_max);
 	statefile_alloc = STATEFILE_ALLOC_SIZE;
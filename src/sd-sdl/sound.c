@@ -32,19 +32,63 @@ uae_u16 *paula_sndbufpt;
 int paula_sndbufsize;
 static SDL_AudioSpec spec;
 
+#define SOUND_STATUS_PERIODS 100
+
 static smp_comm_pipe to_sound_pipe;
-static uae_sem_t data_available_sem, callback_done_sem, sound_init_sem;
+static uae_sem_t sound_init_sem;
 
 static struct sound_data sdpaula;
 static struct sound_data *sdp = &sdpaula;
 
-static int in_callback, closing_sound;
+static int closing_sound;
+
+/* Output ring buffer
+ *
+ * finish_sound_buffer () appends each finished paula_sndbuffer period,
+ * sound_callback () drains it from SDL's audio thread. ring_wr is only
+ * written by the emulation side and ring_rd only by the callback, so
+ * neither side ever waits for the other: a full ring drops the period
+ * (overrun), an empty one plays silence (underrun).
+ * The emulation side keeps the fill level near sound_latency ms by
+ * adjusting the Paula output rate slightly, see sound_setadjust ().
+ */
+#define SOUND_ADJUST_MAX 0.005
+
+static uae_u8 *sndring;
+static int sndring_size, sndring_target;
+static volatile int ring_rd, ring_wr;
+static volatile int ring_underruns, ring_primed;
+static double sound_adjust_avg;
+
+static int ring_fill (void)
+{
+	int fill = __atomic_load_n (&ring_wr, __ATOMIC_ACQUIRE) - __atomic_load_n (&ring_rd, __ATOMIC_ACQUIRE);
+	if (fill < 0)
+		fill += sndring_size;
+	return fill;
+}
 
 static void clearbuffer (void)
 {
     memset (paula_sndbuffer, 0, sizeof (paula_sndbuffer));
 }
 
+/* only while callback can't run */
+static void clearring (void)
+{
+	ring_rd = ring_wr = 0;
+	ring_primed = 0;
+}
+
+void sound_setadjust (double v)
+{
+	if (v < -SOUND_ADJUST_MAX)
+		v = -SOUND_ADJUST_MAX;
+	if (v > SOUND_ADJUST_MAX)
+		v = SOUND_ADJUST_MAX;
+	scaled_sample_evtime = scaled_sample_evtime_orig * (1.0 + v);
+}
+
 /* This shouldn't be necessary . . . */
 static void dummy_callback (void *userdata, Uint8 *stream, int len)
 {
@@ -53,24 +97,52 @@ static void dummy_callback (void *userdata, Uint8 *stream, int len)
 
 static void sound_callback (void *userdata, Uint8 *stream, int len)
 {
-	if (closing_sound)
-		return;
-	in_callback = 1;
+	int rd, fill, size;
 
-	/* Wait for data to finish.  */
-	uae_sem_wait (&data_available_sem);
+	if (closing_sound || !sndring)
+		return;
+	rd = ring_rd;
+	fill = ring_fill ();
+	if (!ring_primed) {
+		// (re)starting, wait until buffer is at target level
+		if (fill < sndring_target) {
+			memset (stream, 0, len);
+			return;
+		}
+		ring_primed = 1;
+	}
+	size = fill < len ? fill : len;
+	if (rd + size > sndring_size) {
+		memcpy (stream, sndring + rd, sndring_size - rd);
+		memcpy (stream + sndring_size - rd, sndring, size - (sndring_size - rd));
+	} else {
+		memcpy (stream, sndring + rd, size);
+	}
+	if (size < len) {
+		memset (stream + size, 0, len - size);
+		ring_underruns++;
+		ring_primed = 0;
+	}
+	rd += size;
+	if (rd >= sndring_size)
+		rd -= sndring_size;
+	__atomic_store_n (&ring_rd, rd, __ATOMIC_RELEASE);
+}
 
-	if (!closing_sound) {
-		memcpy (stream, paula_sndbuffer, paula_sndbufsize);
+/* keep fill level centred on sndring_target by nudging Paula's output rate */
+static void sound_adjust_rate (int fill)
+{
+	double dev = (double)(fill - sndring_target) / sndring_target;
 
-		/* Notify writer that we're done.  */
-		uae_sem_post (&callback_done_sem);
-	}
-	in_callback = 0;
+	sound_adjust_avg = sound_adjust_avg * 0.95 + dev * 0.05;
+	sound_setadjust (sound_adjust_avg * SOUND_ADJUST_MAX);
+	gui_data.sndbuf = (int)(dev * 1000);
 }
 
 void finish_sound_buffer (void)
 {
+	int wr, fill, underruns;
+
 	if (currprefs.turbo_emulation)
 		return;
 #ifdef DRIVESOUND
@@ -85,8 +157,33 @@ void finish_sound_buffer (void)
 	}
 	if (gui_data.sndbuf_status == 3)
 		gui_data.sndbuf_status = 0;
-	uae_sem_post (&data_available_sem);
-	uae_sem_wait (&callback_done_sem);
+
+	underruns = ring_underruns;
+	if (underruns != gui_data.sndbuf_underruns) {
+		gui_data.sndbuf_underruns = underruns;
+		gui_data.sndbuf_status = -1;
+		statuscnt = SOUND_STATUS_PERIODS;
+	}
+	fill = ring_fill ();
+	sound_adjust_rate (fill);
+	if (sndring_size - fill <= paula_sndbufsize) {
+		// no room, drop this period
+		gui_data.sndbuf_overruns++;
+		gui_data.sndbuf_status = 1;
+		statuscnt = SOUND_STATUS_PERIODS;
+		return;
+	}
+	wr = ring_wr;
+	if (wr + paula_sndbufsize > sndring_size) {
+		memcpy (sndring + wr, paula_sndbuffer, sndring_size - wr);
+		memcpy (sndring, (uae_u8*)paula_sndbuffer + sndring_size - wr, paula_sndbufsize - (sndring_size - wr));
+	} else {
+		memcpy (sndring + wr, paula_sndbuffer, paula_sndbufsize);
+	}
+	wr += paula_sndbufsize;
+	if (wr >= sndring_size)
+		wr -= sndring_size;
+	__atomic_store_n (&ring_wr, wr, __ATOMIC_RELEASE);
 }
 
 /* Try to determine whether sound is available. */
@@ -118,14 +215,24 @@ int setup_sound (void)
 
 static int open_sound (void)
 {
+	int latency, frames, framesize;
+
 	if (!currprefs.produce_sound)
 		return 0;
 	config_changed = 1;
 
+	latency = currprefs.sound_latency;
+	if (latency < 20)
+		latency = 20;
+	if (latency > 500)
+		latency = 500;
+	/* SDL period: largest power of two up to half the target latency */
+	frames = currprefs.sound_freq * latency / 1000 / 2;
+	for (spec.samples = 256; spec.samples * 2 <= frames && spec.samples < 8192; spec.samples *= 2);
+
 	spec.freq = currprefs.sound_freq;
 	spec.format = AUDIO_S16SYS;
 	spec.channels = currprefs.sound_stereo ? 2 : 1;
-	spec.samples  = 0; //spec.freq; //* currprefs.sound_latency / 1000;
 	spec.callback = sound_callback;
 	spec.userdata = 0;
 
@@ -138,12 +245,28 @@ static int open_sound (void)
 	sample_handler = currprefs.sound_stereo ? sample16s_handler : sample16_handler;
 
 	obtainedfreq = currprefs.sound_freq;
-	write_log ("SDL: sound driver found and configured at %d Hz, buffer is %d ms (%d bytes).\n", spec.freq, spec.samples * 1000 / spec.freq, paula_sndbufsize);
+
+	/* emulation side produces ~5ms periods, ring holds twice the target */
+	framesize = 2 * spec.channels;
+	paula_sndbufsize = (spec.freq / 200) * framesize;
+	sndring_target = spec.freq * latency / 1000 * framesize;
+	if (sndring_target < spec.samples * framesize + paula_sndbufsize)
+		sndring_target = spec.samples * framesize + paula_sndbufsize;
+	sndring_size = sndring_target * 2;
+	sndring = xcalloc (uae_u8, sndring_size);
+	if (!sndring) {
+		SDL_CloseAudio ();
+		return 0;
+	}
+	clearring ();
+	ring_underruns = 0;
+	sound_adjust_avg = 0;
+	gui_data.sndbuf_underruns = gui_data.sndbuf_overruns = 0;
+	write_log ("SDL: sound driver found and configured at %d Hz, buffer is %d ms (%d bytes), ring %d ms.\n",
+		spec.freq, spec.samples * 1000 / spec.freq, spec.samples * framesize, sndring_target * 1000 / (spec.freq * framesize));
 
 	have_sound = 1;
 	sound_available = 1;
-	//update_sound (fake_vblank_hz);
-	paula_sndbufsize = spec.samples * 2 * spec.channels;
 	paula_sndbufpt = paula_sndbuffer;
 #ifdef DRIVESOUND
 	driveclick_init();
@@ -169,17 +292,13 @@ static void *sound_thread (void *dummy)
 	}
 }
 
-/* We need a thread for this, since communication between finish_sound_buffer
- * and the callback works through semaphores.  In theory, this is unnecessary,
- * since SDL uses a sound thread internally, and the callback runs in its
- * context.  But we don't want to depend on SDL's internals too much.  */
+/* Audio device is opened and closed from a separate thread so we don't
+ * depend on which thread SDL expects this to happen in. */
 static void init_sound_thread (void)
 {
 	uae_thread_id tid;
 
 	init_comm_pipe (&to_sound_pipe, 20, 1);
-	uae_sem_init (&data_available_sem, 0, 0);
-	uae_sem_init (&callback_done_sem, 0, 0);
 	uae_sem_init (&sound_init_sem, 0, 0);
 	uae_start_thread ("Sound", sound_thread, NULL, &tid);
 }
@@ -193,18 +312,16 @@ void close_sound (void)
 		return;
 
 	SDL_PauseAudio (1);
+	closing_sound = 1;
 	clearbuffer();
-	if (in_callback) {
-		closing_sound = 1;
-		uae_sem_post (&data_available_sem);
-	}
 
 	write_comm_pipe_int (&to_sound_pipe, 1, 1);
 	uae_sem_wait (&sound_init_sem);
 	SDL_CloseAudio ();
-	uae_sem_destroy (&data_available_sem);
 	uae_sem_destroy (&sound_init_sem);
-	uae_sem_destroy (&callback_done_sem);
+	write_log ("SDL: %d sound buffer underruns, %d overruns\n", ring_underruns, gui_data.sndbuf_overruns);
+	xfree (sndring);
+	sndring = NULL;
 	have_sound = 0;
 }
 
@@ -219,7 +336,6 @@ int init_sound (void)
 	if (have_sound)
 		return 1;
 
-	in_callback = 0;
 	closing_sound = 0;
 
 	init_sound_thread ();
@@ -244,6 +360,9 @@ void resume_sound (void)
 	if (!have_sound)
 		return;
 	clearbuffer();
+	SDL_LockAudio ();
+	clearring ();
+	SDL_UnlockAudio ();
 	SDL_PauseAudio (0);
 }
 
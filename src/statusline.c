@@ -150,6 +150,14 @@ void draw_status_line_single (uae_u8 *buf, int bpp, int y, int totalwidth, uae_u
 			num2 = 11;
 			num3 = 12;
 			}
+			if (gui_data.statesave) {
+				on = 1;
+				on_rgb = 0xcccc00;
+				off_rgb = 0x000033;
+				num1 = -1;
+				num2 = 11;
+				num3 = 12;
+			}
 		} else if (led == LED_FPS) {
 			int fps = (gui_data.fps + 5) / 10;
 			pos = 2;
@@ -189,7 +197,15 @@ void draw_status_line_single (uae_u8 *buf, int bpp, int y, int totalwidth, uae_u
 				snd = 99;
 			pos = 0;
 			on = gui_data.sndbuf_status;
-			if (on < 3) {
+			if (on < 0 || on == 1) {
+				// show underrun/overrun count while lit
+				snd = on < 0 ? gui_data.sndbuf_underruns : gui_data.sndbuf_overruns;
+				if (snd > 99)
+					snd = 99;
+				num1 = -1;
+				num2 = snd / 10;
+				num3 = snd % 10;
+			} else if (on < 3) {
 				num1 = gui_data.sndbuf < 0 ? 15 : 14;
 				num2 = snd / 10;
 				num3 = snd % 10;
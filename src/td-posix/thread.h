@@ -82,9 +82,16 @@ typedef pthread_t uae_thread_id;
 STATIC_INLINE int uae_start_thread (char *name, void *(*f) (void *), void *arg, uae_thread_id *foo)
 {
 	int result;
-	result = pthread_create (foo, 0, f, arg);
-
-	return 0 == result;
+	pthread_t tid;
+
+	result = pthread_create (&tid, 0, f, arg);
+	if (result)
+		return 0;
+	if (foo)
+		*foo = tid;
+	else
+		pthread_detach (tid);
+	return 1;
 }
 
 STATIC_INLINE int uae_wait_thread (uae_thread_id thread)
@@ -0,0 +1,77 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Round-trip latency of smp_comm_pipe.
+  *
+  * bench_commpipe uses the lock-free pipe, bench_commpipe_locked is the
+  * same program built with COMMPIPE_LOCKED (semaphore based pipe).
+  *
+  * Usage: bench_commpipe [round trips] [chunks]
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "threaddep/thread.h"
+
+static smp_comm_pipe ping, pong;
+
+static void *echo_thread (void *v)
+{
+	for (;;) {
+		int n = read_comm_pipe_int_blocking (&ping);
+		write_comm_pipe_int (&pong, n, 1);
+		if (n < 0)
+			break;
+	}
+	return 0;
+}
+
+static double now (void)
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main (int argc, char **argv)
+{
+	int count = argc > 1 ? atoi (argv[1]) : 1000000;
+	int chunks = argc > 2 ? atoi (argv[2]) : 1;
+	int i, errors = 0;
+	double t;
+
+	init_comm_pipe (&ping, 100, chunks);
+	init_comm_pipe (&pong, 100, chunks);
+	if (!uae_start_thread ("echo", echo_thread, NULL, NULL)) {
+		fprintf (stderr, "thread start failed\n");
+		return 1;
+	}
+	/* warm up */
+	for (i = 0; i < 1000; i++) {
+		write_comm_pipe_int (&ping, i, 1);
+		read_comm_pipe_int_blocking (&pong);
+	}
+	t = now ();
+	for (i = 0; i < count; i++) {
+		write_comm_pipe_int (&ping, i, 1);
+		if (read_comm_pipe_int_blocking (&pong) != i)
+			errors++;
+	}
+	t = now () - t;
+	write_comm_pipe_int (&ping, -1, 1);
+	read_comm_pipe_int_blocking (&pong);
+
+	printf ("%s: %d round trips, %.3f s, %.0f ns/round trip, %d errors\n",
+#ifdef COMMPIPE_LOCKED
+		"locked",
+#else
+		"lock-free",
+#endif
+		count, t, t * 1000000000.0 / count, errors);
+	return errors != 0;
+}
@@ -0,0 +1,121 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * event2 scheduler throughput. Keeps <pending> event2's queued, each
+  * one reschedules itself with a random delay when it fires, and the
+  * clock is advanced through do_cycles () like the CPU emulation does.
+  * Also checks that every event fires exactly on its cycle and none
+  * are lost.
+  *
+  * Usage: bench_events [dispatches]
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/time.h>
+
+#include "options.h"
+#include "events.h"
+#include "benchmark.h"
+
+struct ev eventtab[ev_max];
+struct ev2 eventtab2[ev2_max];
+int pissoff_value = 15000 * CYCLE_UNIT;
+signed long pissoff;
+int syncbase;
+bool bench_running;
+
+void bench_enter (int section) { }
+void bench_leave (void) { }
+extern frame_time_t linux_get_tsc_freq (void);
+frame_time_t linux_get_tsc_freq (void) { return 0; }
+void compute_vsynctime (void) { }
+
+void write_log (const TCHAR *format, ...)
+{
+	va_list ap;
+	va_start (ap, format);
+	vprintf (format, ap);
+	va_end (ap);
+}
+
+void gui_message (const TCHAR *format, ...)
+{
+	va_list ap;
+	va_start (ap, format);
+	vprintf (format, ap);
+	va_end (ap);
+}
+
+#define MAXPENDING 4096
+
+static evt due[MAXPENDING];
+static int fired, target, errors;
+
+static void handler (uae_u32 n)
+{
+	if (get_cycles () != due[n]) {
+		if (errors++ < 10)
+			printf ("event %u fired at %lu, expected %lu\n", n, get_cycles (), due[n]);
+	}
+	due[n] = 0;
+	if (++fired >= target)
+		return;
+	/* keep it queued */
+	evt t = 1 + rand () % 1000;
+	due[n] = get_cycles () + t * CYCLE_UNIT;
+	event2_newevent2 (t, n, handler);
+}
+
+static double now (void)
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main (int argc, char **argv)
+{
+	static const int pendings[] = { 1, 4, 10, 64, 512, MAXPENDING };
+	int dispatches = argc > 1 ? atoi (argv[1]) : 2000000;
+	int p, i;
+
+	for (p = 0; p < (int)(sizeof pendings / sizeof *pendings); p++) {
+		int pending = pendings[p];
+		double t;
+
+		srand (1);
+		memset (eventtab, 0, sizeof eventtab);
+		eventtab[ev_misc].handler = MISC_handler;
+		event2_reset ();
+		events_schedule ();
+		fired = 0;
+		target = dispatches;
+		for (i = 0; i < pending; i++) {
+			evt d = 1 + rand () % 1000;
+			due[i] = get_cycles () + d * CYCLE_UNIT;
+			event2_newevent2 (d, i, handler);
+		}
+		t = now ();
+		while (fired < target)
+			do_cycles (4 * CYCLE_UNIT);
+		t = now () - t;
+		printf ("%5d pending: %10.0f events/s, %6.1f ns/event\n",
+			pending, fired / t, t * 1000000000.0 / fired);
+		/* the rest are not rescheduled, run them out and check none got lost */
+		while (event2_count)
+			do_cycles (1000 * CYCLE_UNIT);
+		for (i = 0; i < pending; i++) {
+			if (due[i]) {
+				if (errors++ < 10)
+					printf ("event %d never fired\n", i);
+			}
+		}
+	}
+	printf ("%d errors\n", errors);
+	return errors != 0;
+}
@@ -0,0 +1,210 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * 68040 MMU data access speed through cpummu.h, with the software TLB
+  * (RAM visible through mem_direct_r/w) and without it (mem_direct_*
+  * cleared, every access goes through the ATC and the bank handlers).
+  * Working sets from a few pages to more than the ATC and TLB hold.
+  * Also checks that every access lands on the right physical address.
+  *
+  * Usage: bench_mmu [accesses]
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/time.h>
+
+#include "options.h"
+#include "memory_uae.h"
+#include "newcpu.h"
+#include "cpummu.h"
+
+#define RAMSIZE (16 * 1024 * 1024)
+#define ROOTPTR 0x10000
+#define PTRTABLE 0x10200
+#define PAGETABLES 0x11000
+#define LOGBASE 0x40000000
+#define PHYSBASE 0x200000
+#define MAXPAGES 2048
+
+struct uae_prefs currprefs;
+struct regstruct regs;
+addrbank *mem_banks[MEMORY_BANKS];
+uae_u8 *mem_direct_r[MEMORY_BANKS];
+uae_u8 *mem_direct_w[MEMORY_BANKS];
+
+static uae_u8 *ram;
+
+void write_log (const TCHAR *format, ...)
+{
+	va_list ap;
+	va_start (ap, format);
+	vprintf (format, ap);
+	va_end (ap);
+}
+
+uae_u32 REGPARAM2 op_illg (uae_u32 opcode)
+{
+	printf ("op_illg %04x\n", opcode);
+	exit (1);
+}
+
+static uae_u32 REGPARAM2 ram_lget (uaecptr addr)
+{
+	return do_get_mem_long ((uae_u32 *)(ram + (addr & (RAMSIZE - 1))));
+}
+static uae_u32 REGPARAM2 ram_wget (uaecptr addr)
+{
+	return do_get_mem_word ((uae_u16 *)(ram + (addr & (RAMSIZE - 1))));
+}
+static uae_u32 REGPARAM2 ram_bget (uaecptr addr)
+{
+	return ram[addr & (RAMSIZE - 1)];
+}
+static void REGPARAM2 ram_lput (uaecptr addr, uae_u32 v)
+{
+	do_put_mem_long ((uae_u32 *)(ram + (addr & (RAMSIZE - 1))), v);
+}
+static void REGPARAM2 ram_wput (uaecptr addr, uae_u32 v)
+{
+	do_put_mem_word ((uae_u16 *)(ram + (addr & (RAMSIZE - 1))), v);
+}
+static void REGPARAM2 ram_bput (uaecptr addr, uae_u32 v)
+{
+	ram[addr & (RAMSIZE - 1)] = v;
+}
+
+static addrbank ram_bank = {
+	ram_lget, ram_wget, ram_bget,
+	ram_lput, ram_wput, ram_bput,
+	NULL, NULL, NULL, _T("RAM"),
+	ram_lget, ram_wget, ABFLAG_RAM,
+	RAMSIZE - 1, 0, RAMSIZE, NULL
+};
+
+static void setdirect (bool direct)
+{
+	int i;
+
+	for (i = 0; i < MEMORY_BANKS; i++) {
+		mem_direct_r[i] = mem_direct_w[i] = NULL;
+		if (direct && i < (RAMSIZE >> 16))
+			mem_direct_r[i] = mem_direct_w[i] = ram + (i << 16);
+	}
+	mmu_tlb_flush ();
+}
+
+/* logical page n -> physical page n, in reverse order inside each 64k so
+ * that a missing translation shows up as a wrong value */
+static uaecptr physpage (int n)
+{
+	return PHYSBASE + ((n & ~15) | (15 - (n & 15))) * 4096;
+}
+
+static void maketables (void)
+{
+	int n;
+
+	memset (ram, 0, RAMSIZE);
+	for (n = 0; n < 128; n++)
+		do_put_mem_long ((uae_u32 *)(ram + ROOTPTR + n * 4), 0);
+	do_put_mem_long ((uae_u32 *)(ram + ROOTPTR + (LOGBASE >> 25) * 4), PTRTABLE | 3);
+	for (n = 0; n < MAXPAGES; n++) {
+		uaecptr log = LOGBASE + n * 4096;
+		uaecptr pt = PAGETABLES + ((n >> 6) * 256);
+		do_put_mem_long ((uae_u32 *)(ram + PTRTABLE + ((log >> 18) & 0x7f) * 4), pt | 3);
+		do_put_mem_long ((uae_u32 *)(ram + pt + ((log >> 12) & 0x3f) * 4), physpage (n) | 1);
+	}
+	regs.srp = regs.urp = ROOTPTR;
+	regs.s = 1;
+	mmu_set_super (true);
+	mmu_tt_modified ();
+	mmu_set_tc (0x8000);
+}
+
+static double now (void)
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* every access verified against the physical page it should hit */
+static int check (int pages)
+{
+	int n, i, errors = 0;
+
+	for (n = 0; n < pages; n++) {
+		for (i = 0; i < 4096; i += 1024)
+			put_long_mmu040 (LOGBASE + n * 4096 + i, n * 4096 + i);
+	}
+	for (n = 0; n < pages; n++) {
+		for (i = 0; i < 4096; i += 1024) {
+			uae_u32 v = do_get_mem_long ((uae_u32 *)(ram + physpage (n) + i));
+			if (v != (uae_u32)(n * 4096 + i) || get_long_mmu040 (LOGBASE + n * 4096 + i) != v) {
+				if (errors++ < 10)
+					printf ("page %d offset %d: %08x\n", n, i, v);
+			}
+		}
+	}
+	return errors;
+}
+
+static double run (int pages, int accesses, uae_u32 *sum)
+{
+	uae_u32 s = 0, off = 0;
+	int n, page = 0;
+	double t = now ();
+
+	for (n = 0; n < accesses; n++) {
+		uaecptr addr = LOGBASE + page * 4096 + off;
+		s += get_long_mmu040 (addr);
+		if ((n & 7) == 7)
+			put_long_mmu040 (addr, s);
+		/* a few longs per page, then the next page of the working set */
+		off = (off + 68) & 0xffc;
+		if ((n & 3) == 3)
+			page = (page * 5 + 1) % pages;
+	}
+	*sum = s;
+	return now () - t;
+}
+
+int main (int argc, char **argv)
+{
+	static const int sets[] = { 4, 16, 64, 256, 1024, MAXPAGES };
+	int accesses = argc > 1 ? atoi (argv[1]) : 20000000;
+	int i, direct, errors = 0;
+	uae_u32 sum;
+
+	ram = xcalloc (uae_u8, RAMSIZE);
+	currprefs.mmu_model = currprefs.cpu_model = 68040;
+	for (i = 0; i < MEMORY_BANKS; i++)
+		mem_banks[i] = &ram_bank;
+	maketables ();
+
+	printf ("pages   bank path M/s   TLB M/s   TLB hits\n");
+	for (i = 0; i < (int)(sizeof sets / sizeof *sets); i++) {
+		double t[2];
+		uae_u64 hits = 0, misses = 0;
+		for (direct = 0; direct < 2; direct++) {
+			setdirect (direct != 0);
+			mmu_flush_atc_all (true);
+			errors += check (sets[i]);
+			hits = mmu_tlb_hits;
+			misses = mmu_tlb_misses;
+			t[direct] = run (sets[i], accesses, &sum);
+			hits = mmu_tlb_hits - hits;
+			misses = mmu_tlb_misses - misses;
+		}
+		printf ("%5d %15.1f %9.1f %9.1f%%\n", sets[i],
+			accesses / t[0] / 1000000.0, accesses / t[1] / 1000000.0,
+			hits * 100.0 / (hits + misses));
+	}
+	printf ("%d errors\n", errors);
+	return errors != 0;
+}
@@ -0,0 +1,181 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Planar to chunky conversion speed, scalar pfield_doline_1 () vs
+  * p2c_simd.c kernels, for 1-8 planes and different line widths.
+  * Also checks that the output is bit-identical.
+  *
+  * Usage: bench_p2c [lines]
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/time.h>
+
+#include "options.h"
+#include "memory_uae.h"
+#include "custom.h"
+#include "xwin.h"
+#include "drawing.h"
+
+#define MAXLONGS 64
+
+static uae_u8 planes_data[8][MAXLONGS * 4];
+static uae_u32 out_ref[MAXLONGS * 8], out_simd[MAXLONGS * 8];
+static uae_u8 *real_bplpt[8];
+
+void write_log (const TCHAR *format, ...)
+{
+	va_list ap;
+	va_start (ap, format);
+	vprintf (format, ap);
+	va_end (ap);
+}
+
+#define MERGE(a,b,mask,shift) do {\
+	uae_u32 tmp = mask & (a ^ (b >> shift)); \
+	a ^= tmp; \
+	b ^= (tmp << shift); \
+} while (0)
+
+#define GETLONG(P) (*(uae_u32 *)P)
+
+/* copy of drawing.c */
+STATIC_INLINE void pfield_doline_1 (uae_u32 *pixels, int wordcount, int planes)
+{
+	while (wordcount-- > 0) {
+		uae_u32 b0, b1, b2, b3, b4, b5, b6, b7;
+
+		b0 = 0, b1 = 0, b2 = 0, b3 = 0, b4 = 0, b5 = 0, b6 = 0, b7 = 0;
+		switch (planes) {
+		case 8: b0 = GETLONG (real_bplpt[7]); real_bplpt[7] += 4;
+			/* fall through */
+		case 7: b1 = GETLONG (real_bplpt[6]); real_bplpt[6] += 4;
+			/* fall through */
+		case 6: b2 = GETLONG (real_bplpt[5]); real_bplpt[5] += 4;
+			/* fall through */
+		case 5: b3 = GETLONG (real_bplpt[4]); real_bplpt[4] += 4;
+			/* fall through */
+		case 4: b4 = GETLONG (real_bplpt[3]); real_bplpt[3] += 4;
+			/* fall through */
+		case 3: b5 = GETLONG (real_bplpt[2]); real_bplpt[2] += 4;
+			/* fall through */
+		case 2: b6 = GETLONG (real_bplpt[1]); real_bplpt[1] += 4;
+			/* fall through */
+		case 1: b7 = GETLONG (real_bplpt[0]); real_bplpt[0] += 4;
+		}
+
+		MERGE (b0, b1, 0x55555555, 1);
+		MERGE (b2, b3, 0x55555555, 1);
+		MERGE (b4, b5, 0x55555555, 1);
+		MERGE (b6, b7, 0x55555555, 1);
+
+		MERGE (b0, b2, 0x33333333, 2);
+		MERGE (b1, b3, 0x33333333, 2);
+		MERGE (b4, b6, 0x33333333, 2);
+		MERGE (b5, b7, 0x33333333, 2);
+
+		MERGE (b0, b4, 0x0f0f0f0f, 4);
+		MERGE (b1, b5, 0x0f0f0f0f, 4);
+		MERGE (b2, b6, 0x0f0f0f0f, 4);
+		MERGE (b3, b7, 0x0f0f0f0f, 4);
+
+		MERGE (b0, b1, 0x00ff00ff, 8);
+		MERGE (b2, b3, 0x00ff00ff, 8);
+		MERGE (b4, b5, 0x00ff00ff, 8);
+		MERGE (b6, b7, 0x00ff00ff, 8);
+
+		MERGE (b0, b2, 0x0000ffff, 16);
+		do_put_mem_long (pixels, b0);
+		do_put_mem_long (pixels + 4, b2);
+		MERGE (b1, b3, 0x0000ffff, 16);
+		do_put_mem_long (pixels + 2, b1);
+		do_put_mem_long (pixels + 6, b3);
+		MERGE (b4, b6, 0x0000ffff, 16);
+		do_put_mem_long (pixels + 1, b4);
+		do_put_mem_long (pixels + 5, b6);
+		MERGE (b5, b7, 0x0000ffff, 16);
+		do_put_mem_long (pixels + 3, b5);
+		do_put_mem_long (pixels + 7, b7);
+		pixels += 8;
+	}
+}
+
+static void NOINLINE doline_scalar (uae_u32 *data, int wordcount, int planes)
+{
+	switch (planes) {
+	case 1: pfield_doline_1 (data, wordcount, 1); break;
+	case 2: pfield_doline_1 (data, wordcount, 2); break;
+	case 3: pfield_doline_1 (data, wordcount, 3); break;
+	case 4: pfield_doline_1 (data, wordcount, 4); break;
+	case 5: pfield_doline_1 (data, wordcount, 5); break;
+	case 6: pfield_doline_1 (data, wordcount, 6); break;
+	case 7: pfield_doline_1 (data, wordcount, 7); break;
+	case 8: pfield_doline_1 (data, wordcount, 8); break;
+	}
+}
+
+/* same sequence as pfield_doline () */
+static void doline (uae_u32 *data, int wordcount, int planes)
+{
+	int i, done;
+
+	for (i = 0; i < 8; i++)
+		real_bplpt[i] = planes_data[i];
+	done = p2c_simd (data, real_bplpt, planes, wordcount);
+	doline_scalar (data + done * 8, wordcount - done, planes);
+}
+
+static double now (void)
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main (int argc, char **argv)
+{
+	static const int widths[] = { 1, 3, 4, 7, 10, 14, 20, 24, 40, MAXLONGS };
+	int lines = argc > 1 ? atoi (argv[1]) : 200000;
+	int level, planes, w, i, n, errors = 0;
+
+	for (i = 0; i < 8 * MAXLONGS * 4; i++)
+		planes_data[i / (MAXLONGS * 4)][i % (MAXLONGS * 4)] = rand ();
+
+	printf ("ns/line       ");
+	for (w = 0; w < (int)(sizeof widths / sizeof *widths); w++)
+		printf ("%7dpx", widths[w] * 32);
+	printf ("\n");
+	for (level = 0; level < 4; level++) {
+		p2c_simd_init (level);
+		for (planes = 1; planes <= 8; planes++) {
+			printf ("%d planes     ", planes);
+			for (w = 0; w < (int)(sizeof widths / sizeof *widths); w++) {
+				int wc = widths[w];
+				double t;
+
+				for (i = 0; i < 8; i++)
+					real_bplpt[i] = planes_data[i];
+				doline_scalar (out_ref, wc, planes);
+				memset (out_simd, 0, sizeof out_simd);
+				doline (out_simd, wc, planes);
+				if (memcmp (out_ref, out_simd, wc * 32)) {
+					printf ("\nMISMATCH level %d planes %d width %d\n", level, planes, wc);
+					errors++;
+				}
+				t = now ();
+				for (n = 0; n < lines; n++)
+					doline (out_simd, wc, planes);
+				t = now () - t;
+				printf ("%9.1f", t * 1000000000.0 / lines);
+			}
+			printf ("\n");
+		}
+	}
+	printf ("%d errors\n", errors);
+	return errors != 0;
+}
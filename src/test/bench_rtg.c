@@ -0,0 +1,191 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * RTG conversion and blit kernel speed, scalar picasso96.c loops vs
+  * rtg_simd.c at every level, one 1920 pixel row per call. Also checks
+  * that the output is bit-identical, including odd widths.
+  *
+  * Usage: bench_rtg [rows]
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <sys/time.h>
+
+#include "gfxdep/gfx.h"
+#include "options.h"
+#include "memory_uae.h"
+#include "picasso96.h"
+
+#define WIDTH 1920
+#define ROWBYTES (WIDTH * 4 + 64)
+
+static uae_u32 clut[256];
+static uae_u32 rgbx16[65536];
+static uae_u8 srcrow[ROWBYTES], ref[ROWBYTES], out[ROWBYTES];
+
+void write_log (const TCHAR *format, ...)
+{
+}
+
+/* scalar references, same as picasso96.c */
+
+static void clut32_ref (uae_u32 *dst, const uae_u8 *src, int w)
+{
+	int x;
+	for (x = 0; x < w; x++)
+		dst[x] = clut[src[x]];
+}
+
+static void rgb16_ref (uae_u32 *dst, const uae_u16 *src, int w)
+{
+	int x;
+	for (x = 0; x < w; x++)
+		dst[x] = rgbx16[src[x]];
+}
+
+static void swizzle_ref (uae_u32 *dst, const uae_u8 *src, int bytes, int r, int g, int b, int w)
+{
+	int x;
+	for (x = 0; x < w; x++)
+		dst[x] = (src[x * bytes + r] << 16) | (src[x * bytes + g] << 8) | src[x * bytes + b];
+}
+
+static void fill_ref (uae_u8 *dst, uae_u32 pen, int bpp, int w)
+{
+	int x, i;
+	for (x = 0; x < w; x++) {
+		for (i = 0; i < bpp; i++)
+			*dst++ = pen >> (i * 8);
+	}
+}
+
+static void xor_ref (uae_u8 *dst, uae_u32 v, int bytes)
+{
+	int i;
+	for (i = 0; i < bytes; i++)
+		dst[i] ^= v;
+}
+
+static void rop_ref (uae_u8 *dst, const uae_u8 *src, int bytes)
+{
+	int i;
+	for (i = 0; i < bytes; i++)
+		dst[i] = ~(src[i] & dst[i]);
+}
+
+enum { K_CLUT32, K_RGB16, K_SWIZ4, K_SWIZ3, K_FILL4, K_FILL3, K_XOR, K_NAND, K_MAX };
+static const char *names[K_MAX] = {
+	"CLUT->32", "16->32", "ARGB->32", "RGB24->32", "fill 32", "fill 24", "xor", "blit NAND"
+};
+
+/* full row with the simd function and the scalar tail, like picasso96.c */
+static void run (int k, int level, uae_u8 *dst, int w)
+{
+	uae_u32 *d = (uae_u32*)dst;
+	int done;
+
+	if (level < 0) {
+		switch (k) {
+		case K_CLUT32: clut32_ref (d, srcrow, w); break;
+		case K_RGB16: rgb16_ref (d, (uae_u16*)srcrow, w); break;
+		case K_SWIZ4: swizzle_ref (d, srcrow, 4, 1, 2, 3, w); break;
+		case K_SWIZ3: swizzle_ref (d, srcrow, 3, 0, 1, 2, w); break;
+		case K_FILL4: fill_ref (dst, 0x00123456, 4, w); break;
+		case K_FILL3: fill_ref (dst, 0x00abcdef, 3, w); break;
+		case K_XOR: xor_ref (dst, 0xffffffff, w * 4); break;
+		case K_NAND: rop_ref (dst, srcrow, w * 4); break;
+		}
+		return;
+	}
+	switch (k) {
+	case K_CLUT32:
+		done = rtg_simd_clut32 (d, srcrow, clut, w);
+		clut32_ref (d + done, srcrow + done, w - done);
+		break;
+	case K_RGB16:
+		done = rtg_simd_rgb16to32 (d, (uae_u16*)srcrow, rgbx16, w);
+		rgb16_ref (d + done, (uae_u16*)srcrow + done, w - done);
+		break;
+	case K_SWIZ4:
+		done = rtg_simd_swizzle (d, srcrow, 4, 1, 2, 3, w);
+		swizzle_ref (d + done, srcrow + done * 4, 4, 1, 2, 3, w - done);
+		break;
+	case K_SWIZ3:
+		done = rtg_simd_swizzle (d, srcrow, 3, 0, 1, 2, w);
+		swizzle_ref (d + done, srcrow + done * 3, 3, 0, 1, 2, w - done);
+		break;
+	case K_FILL4:
+		done = rtg_simd_fill (dst, 0x00123456, 4, w * 4);
+		fill_ref (dst + done, 0x00123456, 4, w - done / 4);
+		break;
+	case K_FILL3:
+		done = rtg_simd_fill (dst, 0x00abcdef, 3, w * 3);
+		fill_ref (dst + done, 0x00abcdef, 3, w - done / 3);
+		break;
+	case K_XOR:
+		done = rtg_simd_xor (dst, 0xffffffff, w * 4);
+		xor_ref (dst + done, 0xffffffff, w * 4 - done);
+		break;
+	case K_NAND:
+		if (!rtg_simd_blit (BLIT_NAND, srcrow, dst, w * 4, 1, ROWBYTES, ROWBYTES))
+			rop_ref (dst, srcrow, w * 4);
+		break;
+	}
+}
+
+static double now (void)
+{
+	struct timeval tv;
+	gettimeofday (&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main (int argc, char **argv)
+{
+	static const int widths[] = { 1, 3, 7, 13, 31, 100, 641, WIDTH };
+	int rows = argc > 1 ? atoi (argv[1]) : 100000;
+	int k, level, i, n, errors = 0;
+
+	for (i = 0; i < 256; i++)
+		clut[i] = rand ();
+	for (i = 0; i < 65536; i++)
+		rgbx16[i] = rand ();
+	for (i = 0; i < ROWBYTES; i++)
+		srcrow[i] = rand ();
+
+	printf ("ns/row (%d px)  scalar     SSE2    SSSE3     AVX2\n", WIDTH);
+	for (k = 0; k < K_MAX; k++) {
+		printf ("%-14s", names[k]);
+		for (level = -1; level < 4; level++) {
+			double t;
+
+			if (level == 0)
+				continue;
+			rtg_simd_init (level < 0 ? 0 : level);
+			for (i = 0; i < (int)(sizeof widths / sizeof *widths); i++) {
+				int w = widths[i];
+				memset (ref, 0x5a, sizeof ref);
+				memset (out, 0x5a, sizeof out);
+				run (k, -1, ref, w);
+				run (k, level, out, w);
+				if (memcmp (ref, out, sizeof ref)) {
+					printf ("\nMISMATCH %s level %d width %d\n", names[k], level, w);
+					errors++;
+				}
+			}
+			t = now ();
+			for (n = 0; n < rows; n++)
+				run (k, level, out, WIDTH);
+			t = now () - t;
+			printf ("%9.1f", t * 1000000000.0 / rows);
+		}
+		printf ("\n");
+	}
+	printf ("%d errors\n", errors);
+	return errors != 0;
+}
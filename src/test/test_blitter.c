@@ -0,0 +1,258 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Compares vectorized immediate blitter (blitter_simd.c) against the
+  * scalar blitter_dofast ()/blitter_dofast_desc () loops with random
+  * register sets.
+  *
+  * Usage: test_blitter [iterations] [seed]
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "options.h"
+#include "memory_uae.h"
+#include "blitter.h"
+#include "blit.h"
+
+#define MEMSIZE 0x20000
+
+static uae_u8 mem_ref[MEMSIZE], mem_simd[MEMSIZE];
+static uae_u8 filltable[256][4][2];
+static uae_u32 masktable[BLITTER_MAX_WORDS];
+
+void write_log (const TCHAR *format, ...)
+{
+	va_list ap;
+	va_start (ap, format);
+	vprintf (format, ap);
+	va_end (ap);
+}
+
+static void build_filltable (void)
+{
+	unsigned int d, fillmask;
+	int i;
+
+	for (d = 0; d < 256; d++) {
+		for (i = 0; i < 4; i++) {
+			int fc = i & 1;
+			uae_u8 data = d;
+			for (fillmask = 1; fillmask != 0x100; fillmask <<= 1) {
+				uae_u16 tmp = data;
+				if (fc) {
+					if (i & 2)
+						data |= fillmask;
+					else
+						data ^= fillmask;
+				}
+				if (tmp & fillmask) fc = !fc;
+			}
+			filltable[d][i][0] = data;
+			filltable[d][i][1] = fc;
+		}
+	}
+}
+
+static uae_u16 rw (uaecptr a)
+{
+	return do_get_mem_word ((uae_u16*)(mem_ref + a));
+}
+
+static void ww (uaecptr a, uae_u16 v)
+{
+	do_put_mem_word ((uae_u16*)(mem_ref + a), v);
+}
+
+/* same as the generic loops in blitter.c */
+static void ref_blit (uaecptr bltadatptr, uaecptr bltbdatptr, uaecptr bltcdatptr, uaecptr bltddatptr,
+	struct bltinfo *b, uae_u8 mt, int desc, int blitfill, int blitife, int *fcp)
+{
+	uae_u32 blitbhold = b->bltbhold;
+	uae_u32 preva = 0, prevb = 0;
+	uaecptr dstp = 0;
+	int dodst = 0, i, j, dir = desc ? -1 : 1;
+	int blitfc = *fcp;
+
+	for (i = 0; i < b->hblitsize; i++)
+		masktable[i] = 0xffff;
+	masktable[0] = b->bltafwm;
+	masktable[b->hblitsize - 1] &= b->bltalwm;
+
+	for (j = 0; j < b->vblitsize; j++) {
+		blitfc = *fcp;
+		for (i = 0; i < b->hblitsize; i++) {
+			uae_u32 bltadat, blitahold;
+			uae_u16 bltbdat;
+			if (bltadatptr) {
+				b->bltadat = bltadat = rw (bltadatptr);
+				bltadatptr += 2 * dir;
+			} else
+				bltadat = b->bltadat;
+			bltadat &= masktable[i];
+			if (desc)
+				blitahold = (((uae_u32)bltadat << 16) | preva) >> b->blitdownashift;
+			else
+				blitahold = (((uae_u32)preva << 16) | bltadat) >> b->blitashift;
+			preva = bltadat;
+
+			if (bltbdatptr) {
+				b->bltbdat = bltbdat = rw (bltbdatptr);
+				bltbdatptr += 2 * dir;
+				if (desc)
+					blitbhold = (((uae_u32)bltbdat << 16) | prevb) >> b->blitdownbshift;
+				else
+					blitbhold = (((uae_u32)prevb << 16) | bltbdat) >> b->blitbshift;
+				prevb = bltbdat;
+			}
+
+			if (bltcdatptr) {
+				b->bltcdat = rw (bltcdatptr);
+				if (desc)
+					b->bltbdat = b->bltcdat;
+				bltcdatptr += 2 * dir;
+			}
+			if (dodst)
+				ww (dstp, b->bltddat);
+			b->bltddat = blit_func (blitahold, blitbhold, b->bltcdat, mt) & 0xFFFF;
+			if (blitfill) {
+				uae_u16 d = b->bltddat;
+				int ifemode = blitife ? 2 : 0;
+				int fc1 = filltable[d & 255][ifemode + blitfc][1];
+				b->bltddat = (filltable[d & 255][ifemode + blitfc][0]
+					+ (filltable[d >> 8][ifemode + fc1][0] << 8));
+				blitfc = filltable[d >> 8][ifemode + fc1][1];
+			}
+			if (b->bltddat)
+				b->blitzero = 0;
+			if (bltddatptr) {
+				dodst = 1;
+				dstp = bltddatptr;
+				bltddatptr += 2 * dir;
+			}
+		}
+		if (bltadatptr)
+			bltadatptr += b->bltamod * dir;
+		if (bltbdatptr)
+			bltbdatptr += b->bltbmod * dir;
+		if (bltcdatptr)
+			bltcdatptr += b->bltcmod * dir;
+		if (bltddatptr)
+			bltddatptr += b->bltdmod * dir;
+	}
+	if (dodst)
+		ww (dstp, b->bltddat);
+	b->bltbhold = blitbhold;
+	*fcp = blitfc;
+}
+
+static int rnd (int n)
+{
+	return rand () % n;
+}
+
+static uaecptr rndptr (int w, int h, int mod, int desc)
+{
+	int span = h * (w * 2 + (mod > 0 ? mod : 0)) + 2;
+	uaecptr p;
+	if (span >= MEMSIZE / 2)
+		return 0;
+	p = (span + rnd (MEMSIZE - 2 * span)) & ~1;
+	return p;
+}
+
+static int rndmod (int w)
+{
+	switch (rnd (4))
+	{
+	case 0:
+		return 0;
+	case 1:
+		return rnd (40) * 2;
+	case 2:
+		return -rnd (w + 1) * 2;
+	default:
+		return (rnd (200) - 100) * 2;
+	}
+}
+
+int main (int argc, char **argv)
+{
+	int iterations = argc > 1 ? atoi (argv[1]) : 20000;
+	int seed = argc > 2 ? atoi (argv[2]) : 1;
+	static const uae_u8 minterms[] = { 0x00, 0xf0, 0xcc, 0xca, 0xff, 0x0f, 0x0a, 0x2a, 0x3a, 0xea, 0xfc, 0x5a };
+	int level, it, i, fails = 0, done = 0, skipped = 0;
+
+	build_filltable ();
+	srand (seed);
+	for (level = 0; level < 3; level++) {
+		blitter_simd_init (level);
+		for (it = 0; it < iterations; it++) {
+			struct bltinfo b1, b2;
+			uaecptr pta = 0, ptb = 0, ptc = 0, ptd = 0;
+			int desc = rnd (2), fill = rnd (4) == 0, ife = rnd (2);
+			int fc1 = rnd (2), fc2;
+			uae_u8 mt = rnd (3) ? minterms[rnd (sizeof minterms)] : rnd (256);
+			int w = rnd (8) == 0 ? 1 + rnd (400) : 1 + rnd (40);
+			int h = 1 + rnd (16);
+
+			for (i = 0; i < MEMSIZE; i++)
+				mem_ref[i] = rand ();
+			memset (&b1, 0, sizeof b1);
+			b1.hblitsize = w;
+			b1.vblitsize = h;
+			b1.blitashift = rnd (16);
+			b1.blitbshift = rnd (16);
+			b1.blitdownashift = 16 - b1.blitashift;
+			b1.blitdownbshift = 16 - b1.blitbshift;
+			b1.bltadat = rand ();
+			b1.bltbdat = rand ();
+			b1.bltcdat = rand ();
+			b1.bltbhold = rand ();
+			b1.bltafwm = rnd (2) ? 0xffff : rand ();
+			b1.bltalwm = rnd (2) ? 0xffff : rand ();
+			b1.bltamod = rndmod (w);
+			b1.bltbmod = rndmod (w);
+			b1.bltcmod = rndmod (w);
+			b1.bltdmod = rndmod (w);
+			b1.blitzero = 1;
+			if (rnd (4))
+				pta = rndptr (w, h, b1.bltamod, desc);
+			if (rnd (2))
+				ptb = rndptr (w, h, b1.bltbmod, desc);
+			if (rnd (2))
+				ptc = rndptr (w, h, b1.bltcmod, desc);
+			if (rnd (8))
+				ptd = rndptr (w, h, b1.bltdmod, desc);
+			if (ptc && ptd && rnd (3) == 0) {
+				// cookie-cut into the background
+				ptc = ptd;
+				b1.bltcmod = b1.bltdmod;
+			}
+			b2 = b1;
+			fc2 = fc1;
+			memcpy (mem_simd, mem_ref, MEMSIZE);
+
+			if (!blitter_simd_blit (mem_simd, MEMSIZE, pta, ptb, ptc, ptd, &b2, mt, desc, fill ? (ife ? 2 : 0) : -1, &fc2, filltable)) {
+				skipped++;
+				continue;
+			}
+			ref_blit (pta, ptb, ptc, ptd, &b1, mt, desc, fill, ife, &fc1);
+			done++;
+			if (memcmp (mem_ref, mem_simd, MEMSIZE) || b1.bltadat != b2.bltadat || b1.bltbdat != b2.bltbdat
+				|| b1.bltcdat != b2.bltcdat || b1.bltddat != b2.bltddat || b1.bltbhold != b2.bltbhold
+				|| b1.blitzero != b2.blitzero || fc1 != fc2) {
+				if (fails++ < 10)
+					printf ("FAIL level %d iteration %d: mt=%02x w=%d h=%d desc=%d fill=%d ife=%d A=%x B=%x C=%x D=%x\n",
+						level, it, mt, w, h, desc, fill, ife, pta, ptb, ptc, ptd);
+			}
+		}
+	}
+	printf ("%d blits compared, %d not eligible, %d failures\n", done, skipped, fails);
+	return fails != 0;
+}
@@ -0,0 +1,133 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Checks the fpu_fast FSIN/FCOS/FETOX code (include/fpp-fast.h) against
+  * the host long double libm: arguments right next to multiples of pi/2,
+  * where the argument reduction loses the most bits, random arguments
+  * over the whole fast range and signed zeros. Errors are in ulp of the
+  * double result. Hosts where long double is only a double get a less
+  * strict reference.
+  *
+  * Usage: test_fpp_fast [max ulp] [random arguments]
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "fpp-fast.h"
+
+/* the reference must stay libm: -ffast-math turns sinl/cosl into x87
+ * fsin/fcos, which are far off near multiples of pi */
+#if defined(__GNUC__) && !defined(__clang__)
+#define PRECISE __attribute__ ((noinline, optimize ("no-fast-math")))
+#else
+#define PRECISE
+#endif
+
+static PRECISE long double ref_sin (long double x)
+{
+	return sinl (x);
+}
+static PRECISE long double ref_cos (long double x)
+{
+	return cosl (x);
+}
+static PRECISE long double ref_exp (long double x)
+{
+	return expl (x);
+}
+
+static double maxerr;
+static double maxerr_x;
+static const char *maxerr_f;
+static int checked;
+
+static double ulperr (double v, long double ref)
+{
+	double r = (double)ref;
+	int e;
+
+	if (r == 0)
+		return v == 0 ? 0 : HUGE_VAL;
+	e = ilogb (r) - 52;
+	if (e < -1074)
+		e = -1074;
+	return (double)(fabsl ((long double)v - ref) / ldexpl (1.0L, e));
+}
+
+static void check (const char *name, double x, double v, long double ref)
+{
+	double err = ulperr (v, ref);
+
+	if (err > maxerr || isnan (v) != isnan ((double)ref)) {
+		maxerr = isnan (v) != isnan ((double)ref) ? HUGE_VAL : err;
+		maxerr_x = x;
+		maxerr_f = name;
+	}
+	checked++;
+}
+
+static void check_sincos (double x)
+{
+	check ("sin", x, fast_sin (x), ref_sin (x));
+	check ("cos", x, fast_cos (x), ref_cos (x));
+}
+
+static int check_zero (double x)
+{
+	double s = fast_sin (x), c = fast_cos (x);
+
+	if (s != 0 || signbit (s) != signbit (x) || c != 1.0) {
+		printf ("FAIL sin (%s0) = %g, cos = %g\n", signbit (x) ? "-" : "+", s, c);
+		return 1;
+	}
+	return 0;
+}
+
+int main (int argc, char **argv)
+{
+	double limit = argc > 1 ? atof (argv[1]) : 1.0;
+	int count = argc > 2 ? atoi (argv[2]) : 2000000;
+	int fails = 0;
+	int i, k, j;
+
+	fails += check_zero (0.0);
+	fails += check_zero (-0.0);
+
+	/* k * pi/2 and the doubles around it, up to the libm cutoff */
+	for (k = -63600; k <= 63600; k++) {
+		double x = k * 1.57079632679489661923;
+		double y = x;
+		for (j = 0; j < 8; j++) {
+			check_sincos (x);
+			check_sincos (-x);
+			x = nextafter (x, HUGE_VAL);
+			y = nextafter (y, -HUGE_VAL);
+			check_sincos (y);
+		}
+	}
+	/* arguments reported by earlier reviews */
+	check_sincos (91.106186954104004);
+	check_sincos (92133.49);
+
+	srand (1);
+	for (i = 0; i < count; i++) {
+		double x = ((double)rand () / RAND_MAX * 2 - 1) * 1.0e5;
+		double e = ((double)rand () / RAND_MAX * 2 - 1) * 700.0;
+		check_sincos (x);
+		check_sincos (ldexp (x, -(rand () % 40)));
+		check ("exp", e, fast_exp (e), ref_exp (e));
+	}
+
+	printf ("%d results checked, max error %.3f ulp (%s (%.17g))\n",
+		checked, maxerr, maxerr_f ? maxerr_f : "-", maxerr_x);
+	if (maxerr > limit) {
+		printf ("FAIL error above %.3f ulp\n", limit);
+		fails++;
+	}
+	return fails != 0;
+}
@@ -0,0 +1,243 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Checks rewind dirty page tracking (memory_dirty_alloc ()) against
+  * the CPU memory accessors. memory.c is linked with stubs for the rest
+  * of the emulator, chip and slow RAM are mapped by hand. While a bank
+  * has a dirty map put_long/put_word/put_byte must not write through
+  * mem_direct_w, every write must mark its page(s), and the MMU TLB
+  * must be flushed when tracking starts or stops.
+  *
+  * Usage: test_memory_dirty
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "options.h"
+#include "uae.h"
+#include "memory_uae.h"
+#include "rommgr.h"
+#include "zfile.h"
+#include "custom.h"
+#include "newcpu.h"
+#include "autoconf.h"
+#include "savestate.h"
+#include "ar.h"
+#include "crc32.h"
+#include "gui.h"
+#include "cdtv.h"
+#include "akiko.h"
+#include "enforcer.h"
+#include "a2091.h"
+#include "gayle.h"
+#include "debug.h"
+#include "gfxboard.h"
+#include "picasso96.h"
+#include "misc.h"
+
+#define CHIPSIZE 0x80000
+#define BOGOSIZE 0x80000
+#define BOGOSTART 0xc00000
+
+/* the parts of the emulator memory.c uses */
+struct uae_prefs currprefs, changed_prefs;
+struct regstruct regs;
+int quit_program, savestate_state, debugging;
+signed long pissoff;
+bool m68k_pc_indirect;
+bool cloanto_rom, kickstart_rom, uae_boot_rom;
+int uae_boot_rom_size;
+uae_u8 *rtarea;
+uaecptr rtarea_base;
+TCHAR start_path_data[MAX_DPATH];
+int gary_timeout, gary_toenb;
+unsigned char arosrom[1];
+unsigned int arosrom_len;
+addrbank custom_bank, cia_bank, clock_bank, expamem_bank, rtarea_bank;
+addrbank fastmem_bank, z3fastmem_bank, z3fastmem2_bank, z3chipmem_bank;
+#ifdef GAYLE
+addrbank gayle_bank, gayle2_bank, mbres_bank;
+#endif
+#ifdef CD32
+addrbank akiko_bank;
+#endif
+
+void write_log (const TCHAR *format, ...) { }
+void error_log (const TCHAR *format, ...) { }
+void gui_message (const char *format, ...) { }
+uae_u32 uaerand (void);
+uae_u32 uaerand (void) { return rand (); }
+TCHAR *au (const char *s) { return my_strdup (s); }
+void uae_restart (int opengui, const TCHAR *cfgfile) { }
+void cpu_halt (int id) { }
+void exception2 (uaecptr addr, bool read, int size, uae_u32 fc) { }
+void m68k_dumpstate (uaecptr *nextpc) { }
+uae_u32 wait_cpu_cycle_read (uaecptr addr, int mode) { return 0; }
+void free_fastmemory (void) { }
+void expansion_clear (void) { }
+uaecptr need_uae_boot_rom (void) { return 0; }
+void virtualdevice_init (void) { }
+int debug_bankchange (int mode) { return 0; }
+void memory_map_dump (void) { }
+void save_u32_func (uae_u8 **dstp, uae_u32 v) { }
+void save_string_func (uae_u8 **dstp, const TCHAR *from) { }
+uae_u32 restore_u32_func (uae_u8 **dstp) { return 0; }
+TCHAR *restore_string_func (uae_u8 **dstp) { return NULL; }
+void restore_ram (size_t filepos, uae_u8 *memory) { }
+uae_u32 get_crc32 (uae_u8 *buf, int len) { return 0; }
+int decode_rom (uae_u8 *mem, int size, int mode, int real_size) { return 0; }
+int kickstart_checksum (uae_u8 *mem, int size) { return 0; }
+void kickstart_fix_checksum (uae_u8 *mem, int size) { }
+struct romdata *getromdatabydata (uae_u8 *rom, int size) { return NULL; }
+struct romdata *getromdatabypath (const TCHAR *path) { return NULL; }
+struct romdata *getromdatabyzfile (struct zfile *f) { return NULL; }
+struct zfile *read_rom_name (const TCHAR *filename) { return NULL; }
+struct zfile *read_rom_name_guess (const TCHAR *filename) { return NULL; }
+struct zfile *rom_fopen (const TCHAR *name, const TCHAR *mode, int mask) { return NULL; }
+void addkeydir (const TCHAR *path) { }
+int romlist_count (void) { return 0; }
+struct romlist *romlist_getit (void) { return NULL; }
+int zfile_exists (const TCHAR *name) { return 0; }
+void zfile_fclose (struct zfile *f) { }
+uae_s64 zfile_fseek (struct zfile *z, uae_s64 offset, int mode) { return 0; }
+uae_s64 zfile_ftell (struct zfile *z) { return 0; }
+size_t zfile_fread (void *b, size_t l1, size_t l2, struct zfile *z) { return 0; }
+struct zfile *zfile_fopen_data (const TCHAR *name, uae_u64 size, const uae_u8 *data) { return NULL; }
+struct zfile *zfile_gunzip (struct zfile *z, int *retcode) { return NULL; }
+#ifdef ACTION_REPLAY
+int action_replay_load (void) { return 0; }
+int action_replay_unload (int in_memory_reset) { return 0; }
+void action_replay_memory_reset (void) { }
+void action_replay_init (int activate) { }
+void action_replay_cleanup (void) { }
+int hrtmon_load (void) { return 0; }
+#endif
+#ifdef CDTV
+void cdtv_check_banks (void) { }
+void cdtv_loadcardmem (uae_u8 *p, int size) { }
+void cdtv_savecardmem (uae_u8 *p, int size) { }
+#endif
+#ifdef ENFORCER
+int enforcer_disable (void) { return 1; }
+#endif
+#ifdef A2091
+void a3000scsi_reset (void) { }
+#endif
+#ifdef GAYLE
+void gayle_map_pcmcia (void) { }
+#endif
+bool gfxboard_is_z3 (int type) { return false; }
+#ifdef PICASSO96
+void picasso_dirty_address (uaecptr addr, uae_u32 size) { }
+#endif
+
+static int tlb_flushes;
+#ifdef FULLMMU
+void mmu_tlb_flush (void)
+{
+	tlb_flushes++;
+}
+#endif
+
+static int fails;
+
+static void check (bool ok, const char *what)
+{
+	if (!ok) {
+		printf ("FAIL %s\n", what);
+		fails++;
+	}
+}
+
+/* pages of ab that are dirty must be exactly first..last */
+static void check_pages (addrbank *ab, int first, int last, const char *what)
+{
+	int i;
+
+	for (i = 0; i < (int)(ab->allocated >> RAM_DIRTY_SHIFT); i++) {
+		if (ab->dirty[i] != (i >= first && i <= last)) {
+			printf ("FAIL %s: page %d is %s\n", what, i, ab->dirty[i] ? "dirty" : "clean");
+			fails++;
+		}
+	}
+	memset (ab->dirty, 0, ab->allocated >> RAM_DIRTY_SHIFT);
+}
+
+static void setbank (addrbank *ab, uaecptr start, uae_u32 size)
+{
+	ab->baseaddr = xcalloc (uae_u8, size);
+	ab->mask = size - 1;
+	ab->start = start;
+	ab->allocated = size;
+	map_banks (ab, start >> 16, size >> 16, 0);
+}
+
+int main (int argc, char **argv)
+{
+	int i, flushes;
+
+	currprefs.cpu_model = 68000;
+	currprefs.address_space_24 = true;
+	currprefs.chipmem_size = CHIPSIZE;
+	currprefs.bogomem_size = BOGOSIZE;
+	changed_prefs = currprefs;
+	for (i = 0; i < MEMORY_BANKS; i++)
+		mem_banks[i] = &dummy_bank;
+	setbank (&chipmem_bank, 0, CHIPSIZE);
+	setbank (&bogomem_bank, BOGOSTART, BOGOSIZE);
+
+	/* without tracking plain RAM is written through the host pointer */
+	check (mem_direct_wptr (0x1000) != NULL, "chip RAM has no direct write pointer");
+	check (mem_direct_wptr (BOGOSTART) != NULL, "slow RAM has no direct write pointer");
+
+	flushes = tlb_flushes;
+	check (memory_dirty_alloc (&chipmem_bank), "chip RAM dirty map");
+	check (memory_dirty_alloc (&bogomem_bank), "slow RAM dirty map");
+	check (mem_direct_wptr (0x1000) == NULL, "chip RAM written directly while tracked");
+	check (mem_direct_wptr (BOGOSTART + 0x70000) == NULL, "slow RAM written directly while tracked");
+	check (mem_direct_rptr (0x1000) != NULL, "chip RAM lost its direct read pointer");
+#ifdef FULLMMU
+	check (tlb_flushes > flushes, "MMU TLB not flushed when tracking started");
+#endif
+
+	put_long (0x4ffe, 0x12345678);
+	check (get_long (0x4ffe) == 0x12345678, "put_long data");
+	check_pages (&chipmem_bank, 4, 5, "put_long across a page");
+	put_word (0x8ffe, 0xabcd);
+	check (get_word (0x8ffe) == 0xabcd, "put_word data");
+	check_pages (&chipmem_bank, 8, 8, "put_word");
+	put_byte (0x7ffff, 0x5a);
+	check (get_byte (0x7ffff) == 0x5a, "put_byte data");
+	check_pages (&chipmem_bank, 0x7f, 0x7f, "put_byte");
+	put_long (BOGOSTART + 0x23000, 1);
+	check_pages (&bogomem_bank, 0x23, 0x23, "slow RAM put_long");
+	check_pages (&chipmem_bank, -1, -1, "slow RAM write marked chip RAM");
+
+	/* remapping must not bring the write pointers back */
+	map_banks (&chipmem_bank, 0, CHIPSIZE >> 16, 0);
+	check (mem_direct_wptr (0x1000) == NULL, "chip RAM written directly after map_banks");
+	put_long (0x30000, 2);
+	check_pages (&chipmem_bank, 0x30, 0x30, "put_long after map_banks");
+
+	memory_dirty_address (0x41000, 0x2000);
+	check_pages (&chipmem_bank, 0x41, 0x42, "memory_dirty_address");
+
+	flushes = tlb_flushes;
+	memory_dirty_free (&chipmem_bank);
+	memory_dirty_free (&bogomem_bank);
+	check (mem_direct_wptr (0x1000) != NULL, "chip RAM direct writes not restored");
+	check (mem_direct_wptr (BOGOSTART) != NULL, "slow RAM direct writes not restored");
+#ifdef FULLMMU
+	check (tlb_flushes > flushes, "MMU TLB not flushed when tracking stopped");
+#endif
+	put_long (0x1000, 3);
+	check (get_long (0x1000) == 3, "direct put_long data");
+
+	printf ("%d failures\n", fails);
+	return fails != 0;
+}
@@ -0,0 +1,259 @@
+ /*
+  * UAE - The Un*x Amiga Emulator
+  *
+  * Checks that frames drawn by the render threads (gfx_render_threads,
+  * configure --enable-render-threads) are identical to frames drawn by
+  * the emulation thread alone. drawing.c is linked against a stub
+  * chipset that feeds it random lines: bitplane data, resolutions,
+  * plane counts, HAM, doubled and black lines and mid line color
+  * changes, and frames that switch between lores, hires and superhires
+  * from line to line. Every frame is hashed and compared, then the threads are
+  * stopped the way reset and exit do it.
+  *
+  * Usage: test_render_threads [frames] [threads]
+  */
+
+#include "sysconfig.h"
+#include "sysdeps.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "options.h"
+#include "threaddep/thread.h"
+#include "uae.h"
+#include "memory_uae.h"
+#include "custom.h"
+#include "newcpu.h"
+#include "xwin.h"
+#include "gui.h"
+#include "picasso96.h"
+#include "drawing.h"
+#include "savestate.h"
+#include "statusline.h"
+#include "debug.h"
+
+#ifndef RENDER_THREADS
+#error test_render_threads needs RENDER_THREADS
+#endif
+
+extern void finish_drawing_frame (void);
+extern void reset_decision_table (void);
+
+/* the parts of custom.c and friends drawing.c uses */
+struct uae_prefs currprefs, changed_prefs;
+struct regstruct regs;
+struct color_entry *curr_color_tables;
+struct color_change *curr_color_changes;
+struct draw_info *curr_drawinfo;
+struct decision line_decisions[2 * (MAXVPOS + 2) + 1];
+struct sprite_entry *curr_sprite_entries;
+int maxvpos = 313, maxvpos_display = 313, minfirstline = 25;
+int first_planes_vpos = 44, last_planes_vpos = 300;
+int plffirstline_total = 44, plflastline_total = 300;
+int diwfirstword_total, diwlastword_total;
+int ddffirstword_total, ddflastword_total;
+bool vertical_changed, horizontal_changed;
+int lof_store, doublescan, debug_dma, sprite_buffer_res;
+int hsyncstartpos, hsyncendpos;
+uae_u16 htotal = 227;
+bool programmedmode;
+int quit_program, savestate_state;
+signed long pissoff;
+
+int check_prefs_changed_gfx (void) { return 0; }
+void check_prefs_changed_audio (void) { }
+void check_prefs_changed_cpu (void) { }
+void check_prefs_changed_custom (void) { }
+void init_hardware_for_drawing_frame (void) { }
+void notice_new_xcolors (void) { }
+void gui_flicker_led (int led, int unitnum, int status) { }
+void gfx_set_picasso_state (int on) { }
+void picasso_enablescreen (int on) { }
+void picasso_refresh (void) { }
+void set_config_changed (void) { }
+void savestate_initsave (const TCHAR *filename, int docompress, int nodialogs, bool save) { }
+int save_state (const TCHAR *filename, const TCHAR *description) { return 0; }
+void statusline_getpos (int *x, int *y, int width, int height) { *x = *y = 0; }
+void draw_status_line_single (uae_u8 *buf, int bpp, int y, int totalwidth, uae_u32 *rc, uae_u32 *gc, uae_u32 *bc, uae_u32 *alpha) { }
+void debug_draw_cycles (uae_u8 *buf, int bpp, int line, int width, int height, uae_u32 *xredcolors, uae_u32 *xgreencolors, uae_u32 *xbluescolors) { }
+
+void write_log (const TCHAR *format, ...)
+{
+	va_list ap;
+	va_start (ap, format);
+	vprintf (format, ap);
+	va_end (ap);
+}
+
+#define WIDTH 768
+#define HEIGHT 576
+#define LINES ((MAXVPOS + 2) * 2)
+#define MAX_CHANGES 8
+
+static void vid_flush_line (struct vidbuf_description *gfxinfo, int line_no) { }
+static void vid_flush_block (struct vidbuf_description *gfxinfo, int first_line, int end_line) { }
+static void vid_flush_screen (struct vidbuf_description *gfxinfo, int first_line, int end_line) { }
+static void vid_flush_clear_screen (struct vidbuf_description *gfxinfo) { }
+static int vid_lockscr (struct vidbuf_description *gfxinfo) { return 1; }
+static void vid_unlockscr (struct vidbuf_description *gfxinfo) { }
+
+static uae_u32 seed;
+
+static uae_u32 rnd (void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+/* one frame of random lines, what custom.c records during a field */
+static void make_frame (int frame)
+{
+	int v, i, changes = 0;
+
+	seed = frame * 7919 + 1;
+	for (v = minfirstline; v < maxvpos; v++) {
+		int lineno = v * 2;
+		struct decision *dp = &line_decisions[lineno];
+		struct draw_info *dip = &curr_drawinfo[lineno];
+		struct color_entry *ce = &curr_color_tables[lineno];
+		int n = rnd () % 16;
+
+		memset (dp, 0, sizeof *dp);
+		memset (dip, 0, sizeof *dip);
+		for (i = 0; i < 32; i++) {
+			color_reg_set (ce, i, rnd () & 0xfff);
+			ce->acolors[i] = getxcolor (color_reg_get (ce, i));
+		}
+		ce->borderblank = false;
+		ce->bordersprite = false;
+		dp->ctable = lineno;
+
+		if (v < first_planes_vpos || v >= last_planes_vpos || n == 0) {
+			dp->plfleft = -1;
+		} else {
+			/* odd frames cycle lores, hires and superhires line by line,
+			 * every band then stretches, copies and shrinks */
+			dp->bplres = (frame & 1) ? v % 3 : (int)(rnd () % 2);
+			if (dp->bplres == RES_SUPERHIRES)
+				dp->nr_planes = 1 + rnd () % 2;
+			else
+				dp->nr_planes = dp->bplres ? 1 + rnd () % 4 : 1 + rnd () % 6;
+			dp->ham_seen = dp->ham_at_start = dp->nr_planes == 6 && (n & 1);
+			dp->ehb_seen = dp->nr_planes == 6 && !dp->ham_seen;
+			dp->bplcon0 = (dp->bplres == RES_HIRES ? 0x8000 : 0) | (dp->bplres == RES_SUPERHIRES ? 0x0040 : 0)
+				| (dp->nr_planes << 12) | (dp->ham_seen ? 0x0800 : 0) | 0x0200;
+			dp->bplcon2 = 0x24;
+			dp->plfleft = 0x38 + (rnd () % 4) * 2;
+			dp->plflinelen = 320 >> (dp->bplres ? 1 : 2);
+			dp->plfright = dp->plfleft + dp->plflinelen;
+			dp->diwfirstword = coord_diw_to_window_x (0x81);
+			dp->diwlastword = coord_diw_to_window_x (0x1c1);
+			for (i = 0; i < MAX_PLANES * MAX_WORDS_PER_LINE * 2; i++)
+				line_data[lineno][i] = rnd ();
+		}
+
+		/* a few mid line color writes and a sentinel, like custom.c */
+		dip->first_color_change = changes;
+		for (i = rnd () % 4; i > 0 && changes < MAX_CHANGES * maxvpos - 1; i--) {
+			curr_color_changes[changes].linepos = 0x40 + rnd () % 0xa0;
+			curr_color_changes[changes].regno = rnd () % 32;
+			curr_color_changes[changes].value = rnd () & 0xfff;
+			if (changes > dip->first_color_change && curr_color_changes[changes].linepos < curr_color_changes[changes - 1].linepos)
+				curr_color_changes[changes].linepos = curr_color_changes[changes - 1].linepos;
+			changes++;
+		}
+		curr_color_changes[changes].regno = -1;
+		dip->last_color_change = changes++;
+		dip->nr_color_changes = dip->last_color_change - dip->first_color_change;
+
+		hsync_record_line_state (lineno, n == 15 ? nln_nblack : nln_doubled, 1);
+	}
+}
+
+static uae_u32 hash_frame (void)
+{
+	uae_u32 h = 2166136261u;
+	int i;
+
+	for (i = 0; i < gfxvidinfo.rowbytes * gfxvidinfo.height_allocated; i++)
+		h = (h ^ gfxvidinfo.bufmem[i]) * 16777619u;
+	return h;
+}
+
+static uae_u32 draw (int frame, int threads)
+{
+	currprefs.gfx_render_threads = threads;
+	/* the buffer is cleared, nothing may be remembered from the last draw */
+	reset_decision_table ();
+	memset (gfxvidinfo.bufmem, 0x55, gfxvidinfo.rowbytes * gfxvidinfo.height_allocated);
+	make_frame (frame);
+	finish_drawing_frame ();
+	return hash_frame ();
+}
+
+int main (int argc, char **argv)
+{
+	int frames = argc > 1 ? atoi (argv[1]) : 20;
+	int threads = argc > 2 ? atoi (argv[2]) : 3;
+	int i, t, fails = 0;
+	uae_u32 blank;
+
+	currprefs.chipset_mask = CSMASK_ECS_AGNUS | CSMASK_ECS_DENISE;
+	currprefs.gfx_resolution = RES_HIRES;
+	currprefs.gfx_vresolution = VRES_DOUBLE;
+	changed_prefs = currprefs;
+
+	curr_color_tables = xcalloc (struct color_entry, LINES);
+	curr_color_changes = xcalloc (struct color_change, MAX_CHANGES * LINES);
+	curr_drawinfo = xcalloc (struct draw_info, LINES);
+	curr_sprite_entries = xcalloc (struct sprite_entry, 1);
+	for (i = 0; i < 4096; i++)
+		xcolors[i] = ((i & 0xf00) << 12) | ((i & 0x0f0) << 8) | ((i & 0x00f) << 4) | 0xff000000;
+
+	gfxvidinfo.flush_line = vid_flush_line;
+	gfxvidinfo.flush_block = vid_flush_block;
+	gfxvidinfo.flush_screen = vid_flush_screen;
+	gfxvidinfo.flush_clear_screen = vid_flush_clear_screen;
+	gfxvidinfo.lockscr = vid_lockscr;
+	gfxvidinfo.unlockscr = vid_unlockscr;
+	gfxvidinfo.pixbytes = 4;
+	gfxvidinfo.rowbytes = WIDTH * 4;
+	gfxvidinfo.width_allocated = gfxvidinfo.outwidth = gfxvidinfo.inwidth = gfxvidinfo.inwidth2 = WIDTH;
+	gfxvidinfo.height_allocated = gfxvidinfo.outheight = gfxvidinfo.inheight = gfxvidinfo.inheight2 = HEIGHT;
+	gfxvidinfo.maxblocklines = 100;
+	gfxvidinfo.bufmem = xmalloc (uae_u8, gfxvidinfo.rowbytes * HEIGHT);
+	gfxvidinfo.emergmem = xmalloc (uae_u8, gfxvidinfo.rowbytes);
+	diwfirstword_total = coord_diw_to_window_x (0x81);
+	diwlastword_total = coord_diw_to_window_x (0x1c1);
+
+	drawing_init ();
+	memset (gfxvidinfo.bufmem, 0x55, gfxvidinfo.rowbytes * HEIGHT);
+	blank = hash_frame ();
+
+	for (i = 0; i < frames; i++) {
+		uae_u32 h0 = draw (i, 0);
+		if (h0 == blank) {
+			printf ("FAIL frame %d: nothing drawn\n", i);
+			fails++;
+		}
+		for (t = 1; t <= threads; t++) {
+			uae_u32 h = draw (i, t);
+			if (h != h0) {
+				printf ("FAIL frame %d: %d threads %08x, no threads %08x\n", i, t, h, h0);
+				fails++;
+			}
+		}
+	}
+	/* reset and exit */
+	drawing_init ();
+	if (draw (0, 0) != draw (0, threads)) {
+		printf ("FAIL after reset\n");
+		fails++;
+	}
+	drawing_free ();
+
+	printf ("%d frames, 0..%d render threads, %d mismatches\n", frames, threads, fails);
+	return fails != 0;
+}
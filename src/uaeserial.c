@@ -434,6 +434,7 @@ void uaeser_signal (void *vdev, int sigmask)
 							io_error = 0;
 							io_actual = io_length;
 							io_done = 1;
+							memory_dirty_address (io_data, io_length);
 						}
 					} else {
 						io_error = IOERR_BADADDRESS;
@@ -2171,6 +2171,15 @@ int zfile_ferror (struct zfile *z)
 	return 0;
 }
 
+/* writes out buffered data of a real file, nonzero if it or any earlier
+ * write failed */
+int zfile_fflush (struct zfile *z)
+{
+	if (!z->f)
+		return 0;
+	return fflush (z->f) || ferror (z->f);
+}
+
 uae_u8 *zfile_getdata (struct zfile *z, uae_s64 offset, int len)
 {
 	uae_s64 pos = zfile_ftell (z);